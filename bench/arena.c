@@ -0,0 +1,141 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ARENA_ROUNDS 20
+
+/* Allocate and free the outlines of all the glyphs of the font, from an arena
+ * if arena isn't NULL. The number of malloc and realloc calls done so far is
+ * returned in mallocs. */
+int arena_alloc_all(MTGlyph *glyphs, MTGlyph *outlines, size_t num,
+                    MTArena *arena, size_t *mallocs, double *time) {
+    size_t i;
+    double start;
+
+    start = bench_time();
+    for(i=0;i<num;i++){
+        if(mt_glyph_alloc(outlines+i, arena, glyphs[i].point_num,
+                          glyphs[i].contour_num)){
+            return 1;
+        }
+        if(arena == NULL && outlines[i].x != NULL) (*mallocs)++;
+    }
+    for(i=0;i<num;i++) mt_glyph_free(outlines+i);
+    *time += bench_time()-start;
+
+    /* Each chunk is a malloc and a realloc of the chunk table. */
+    if(arena != NULL) *mallocs = arena->chunk_num*2;
+
+    return 0;
+}
+
+int bench_arena(char *file) {
+    MTReader reader;
+    MTFont font;
+    MTArena arena;
+
+    MTGlyph *glyphs;
+    MTGlyph *outlines;
+    MTGlyph *glyph;
+
+    size_t i;
+    size_t num = 0;
+    size_t requested = 0;
+    size_t arena_mallocs = 0, heap_mallocs = 0;
+    int round;
+    int rc = 0;
+
+    double arena_time = 0, heap_time = 0;
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+
+    glyphs = malloc(font.metrics_num*sizeof(MTGlyph));
+    outlines = malloc(font.metrics_num*sizeof(MTGlyph));
+    if(glyphs == NULL || outlines == NULL){
+        free(glyphs);
+        free(outlines);
+        bench_font_free(&font, &reader);
+        return 1;
+    }
+
+    /* Decode every glyph once to know the sizes of their outlines. */
+    for(i=0;i<font.metrics_num;i++){
+        glyph = mt_font_get_glyph_by_id(&font, i);
+        if(glyph == &font.missing) continue;
+
+        glyphs[num++] = *glyph;
+        requested += glyph->point_num*2*sizeof(short int)+
+                     glyph->contour_num*sizeof(unsigned short int)+
+                     (glyph->point_num+7)/8;
+    }
+
+    printf("%lu glyphs, %lu bytes of outlines requested, %lu bytes charged "
+           "to the cache\n", (unsigned long int)num,
+           (unsigned long int)requested,
+           (unsigned long int)(font.stats.memory-num*sizeof(MTFontEntry)));
+
+    /* The arena is kept between the rounds, like the one of a font that
+     * evicts and reloads glyphs: the later rounds reuse the freed blocks. */
+    mt_arena_init(&arena, font.glyph_memory_max*MT_FONT_ARENA_GLYPHS);
+    for(round=0;round<ARENA_ROUNDS && !rc;round++){
+        rc = arena_alloc_all(glyphs, outlines, num, &arena, &arena_mallocs,
+                             &arena_time);
+
+        if(!rc){
+            rc = arena_alloc_all(glyphs, outlines, num, NULL, &heap_mallocs,
+                                 &heap_time);
+        }
+    }
+    mt_arena_free(&arena);
+
+    if(!rc){
+        printf("%d rounds of allocations:\n", ARENA_ROUNDS);
+        printf("arena : %6lu mallocs, %8.2f ns/outline\n",
+               (unsigned long int)arena_mallocs,
+               arena_time*1e9/((double)ARENA_ROUNDS*num));
+        printf("malloc: %6lu mallocs, %8.2f ns/outline\n",
+               (unsigned long int)heap_mallocs,
+               heap_time*1e9/((double)ARENA_ROUNDS*num));
+    }
+
+    free(glyphs);
+    free(outlines);
+    bench_font_free(&font, &reader);
+
+    return rc;
+}
@@ -0,0 +1,151 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <mibitype/batch.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Each batch is rendered for at least this long, in seconds. */
+#define BATCH_TIME 0.3
+
+/* The batches are made of the printable ASCII characters, repeated. Small
+ * batches are rendered on the calling thread alone, big ones on all the
+ * workers. */
+#define BATCH_CHARS ('~'-' '+1)
+#define BATCH_GLYPHS (BATCH_CHARS*8)
+
+size_t batch_lengths[] = {8, BATCH_GLYPHS};
+int batch_sizes[] = {32, 128};
+size_t batch_workers[] = {1, 2, 4, 8};
+
+#define BATCH_LENGTH_NUM (sizeof(batch_lengths)/sizeof(batch_lengths[0]))
+#define BATCH_SIZE_NUM (sizeof(batch_sizes)/sizeof(batch_sizes[0]))
+#define BATCH_WORKER_NUM (sizeof(batch_workers)/sizeof(batch_workers[0]))
+
+/* Render batches of num glyphs for BATCH_TIME seconds, and return the time
+ * per glyph in seconds, or a negative value on error. */
+double batch_run(MTBatch *batch, MTFont *font, size_t *ids, size_t num,
+                 int size, MTBatchSlot *slots) {
+    size_t i;
+    size_t glyphs = 0;
+    int rc;
+
+    double start;
+    double time = 0;
+
+    /* The first batch allocates the bitmaps, that are then reused. */
+    for(i=0;i<num;i++) slots[i].bitmap.data = NULL;
+    rc = mt_batch_render(batch, font, ids, num, size, slots);
+    for(i=0;i<num;i++){
+        slots[i].size = (size_t)slots[i].bitmap.pitch*slots[i].bitmap.height;
+    }
+
+    for(i=0;i<batch->worker_num;i++) batch->workers[i].steals = 0;
+
+    start = bench_time();
+    while(!rc && time < BATCH_TIME){
+        rc = mt_batch_render(batch, font, ids, num, size, slots);
+        glyphs += num;
+        time = bench_time()-start;
+    }
+
+    for(i=0;i<num;i++){
+        if(slots[i].rc) rc = 1;
+        mt_bitmap_free(&slots[i].bitmap);
+    }
+
+    return rc ? -1 : time/glyphs;
+}
+
+int bench_batch(char *file) {
+    MTReader reader;
+    MTFont font;
+    MTBatch batch;
+
+    MTBatchSlot slots[BATCH_GLYPHS];
+    size_t ids[BATCH_GLYPHS];
+
+    size_t i, l, s, w;
+    unsigned long int steals;
+
+    double time;
+    double single = 0;
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+
+    for(i=0;i<BATCH_GLYPHS;i++){
+        ids[i] = mt_font_get_glyph_id(&font, ' '+i%BATCH_CHARS);
+    }
+
+    for(l=0;l<BATCH_LENGTH_NUM;l++){
+        for(s=0;s<BATCH_SIZE_NUM;s++){
+            for(w=0;w<BATCH_WORKER_NUM;w++){
+                if(mt_batch_init(&batch, batch_workers[w])){
+                    fputs("mibitype-bench: Failed to start the workers!\n",
+                          stderr);
+                    bench_font_free(&font, &reader);
+                    return 1;
+                }
+
+                time = batch_run(&batch, &font, ids, batch_lengths[l],
+                                 batch_sizes[s], slots);
+
+                steals = 0;
+                for(i=0;i<batch.worker_num;i++){
+                    steals += batch.workers[i].steals;
+                }
+                mt_batch_free(&batch);
+
+                if(time < 0){
+                    bench_font_free(&font, &reader);
+                    return 1;
+                }
+                if(!w) single = time;
+
+                printf("%3lu glyphs, %3d px, %lu workers: %8.2f us/glyph, "
+                       "speedup %5.2f, %lu steals\n",
+                       (unsigned long int)batch_lengths[l], batch_sizes[s],
+                       (unsigned long int)batch_workers[w], time*1e6,
+                       single/time, steals);
+            }
+        }
+    }
+
+    bench_font_free(&font, &reader);
+
+    return 0;
+}
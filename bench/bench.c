@@ -0,0 +1,174 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* clock_gettime and sysconf are not part of ANSI C. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <bench.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define BENCH_POSIX 1
+#else
+#define BENCH_POSIX 0
+#endif
+
+typedef struct {
+    char *name;
+    int (*run)(char *file);
+    char *description;
+} Benchmark;
+
+Benchmark benchmarks[] = {
+    {"reader", bench_reader, "time to first glyph and RSS, fread vs mmap"},
+    {"cmap4", bench_cmap4, "cmap format 4 lookups over the whole BMP"},
+    {"cmap12", bench_cmap12, "cmap format 12 supplementary plane lookups"},
+    {"cache", bench_cache, "warming the glyph cache, hash table vs array"},
+    {"arena", bench_arena, "outline allocations, arena vs malloc"},
+    {"decode", bench_decode, "glyph decoding throughput"},
+    {"utf8", bench_utf8, "UTF-8 decoding of mixed Latin and CJK text"},
+    {"gsub", bench_gsub, "glyph substitutions per 1k glyphs"},
+    {"render", bench_render, "glyphs rendered per second from 8 to 200 px"},
+    {"kernels", bench_kernels, "Mpx/s of each sweep kernel"},
+    {"phases", bench_phases, "atlas hit rate per number of subpixel phases"},
+    {"sdf", bench_sdf, "time per glyph of the distance fields"},
+    {"batch", bench_batch, "speedup of the batch rasterizer per thread"}
+};
+
+#define BENCHMARK_NUM (sizeof(benchmarks)/sizeof(benchmarks[0]))
+
+double bench_time(void) {
+#if BENCH_POSIX
+    struct timespec now;
+
+    if(!clock_gettime(CLOCK_MONOTONIC, &now)){
+        return now.tv_sec+now.tv_nsec/1e9;
+    }
+#endif
+
+    return clock()/(double)CLOCKS_PER_SEC;
+}
+
+size_t bench_rss(void) {
+    unsigned long int pages = 0;
+
+#if BENCH_POSIX
+    FILE *fp;
+
+    /* Only available on Linux. */
+    fp = fopen("/proc/self/statm", "r");
+    if(fp == NULL) return 0;
+
+    if(fscanf(fp, "%*s %lu", &pages) != 1) pages = 0;
+    fclose(fp);
+
+    return pages*sysconf(_SC_PAGESIZE);
+#else
+    return pages;
+#endif
+}
+
+unsigned long int bench_random(unsigned long int *state) {
+    /* The LCG of the C standard, truncated to 32 bits. */
+    *state = (*state*1103515245UL+12345)&0xFFFFFFFFUL;
+
+    return *state>>8;
+}
+
+int bench_font_init(MTFont *font, MTReader *reader, char *file) {
+    int rc;
+
+    if((rc = mt_reader_init_mmap(reader, file))){
+        fprintf(stderr, "Failed to open %s (error %d)!\n", file, rc);
+        return rc;
+    }
+
+    if((rc = mt_font_init(font, reader, 96))){
+        fprintf(stderr, "Failed to load %s (error %d)!\n", file, rc);
+        mt_reader_free(reader);
+        return rc;
+    }
+
+    return 0;
+}
+
+void bench_font_free(MTFont *font, MTReader *reader) {
+    mt_font_free(font);
+    mt_reader_free(reader);
+}
+
+void usage(void) {
+    size_t i;
+
+    fputs("USAGE: mibitype-bench FILE [BENCHMARK...]\n"
+          "Runs all the benchmarks if none is given. Benchmarks:\n", stderr);
+    for(i=0;i<BENCHMARK_NUM;i++){
+        fprintf(stderr, "  %-10s %s\n", benchmarks[i].name,
+                benchmarks[i].description);
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t i;
+    int n;
+    int found;
+    int failed = 0;
+
+    if(argc < 2){
+        usage();
+
+        return EXIT_FAILURE;
+    }
+
+    for(i=0;i<BENCHMARK_NUM;i++){
+        found = argc == 2;
+        for(n=2;n<argc;n++){
+            if(!strcmp(argv[n], benchmarks[i].name)) found = 1;
+        }
+        if(!found) continue;
+
+        printf("-- %s: %s\n", benchmarks[i].name, benchmarks[i].description);
+        if(benchmarks[i].run(argv[1])){
+            printf("-- %s failed!\n", benchmarks[i].name);
+            failed = 1;
+        }
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
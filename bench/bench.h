@@ -0,0 +1,73 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <mibitype/font.h>
+
+#include <stddef.h>
+
+/* The time in seconds from an arbitrary origin, from a monotonic wall clock
+ * when there is one. */
+double bench_time(void);
+
+/* The resident set size of the process in bytes, or 0 if it is unknown. */
+size_t bench_rss(void);
+
+/* A small pseudo random number generator, so that the runs can be compared
+ * with each other. */
+unsigned long int bench_random(unsigned long int *state);
+
+/* Open a font from a file, printing an error if it fails. */
+int bench_font_init(MTFont *font, MTReader *reader, char *file);
+
+void bench_font_free(MTFont *font, MTReader *reader);
+
+/* Each benchmark gets the font file to use and returns 0 on success. */
+int bench_reader(char *file);
+int bench_cmap4(char *file);
+int bench_cmap12(char *file);
+int bench_cache(char *file);
+int bench_arena(char *file);
+int bench_decode(char *file);
+int bench_utf8(char *file);
+int bench_gsub(char *file);
+int bench_render(char *file);
+int bench_kernels(char *file);
+int bench_phases(char *file);
+int bench_sdf(char *file);
+int bench_batch(char *file);
+
+#endif
@@ -0,0 +1,151 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <mibitype/loaderlist.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The glyph cache used to be an array of glyphs sorted by character, grown by
+ * one glyph and shifted with memmove on every miss. It is emulated here to
+ * compare it with the hash table of MTFont. */
+typedef struct {
+    MTGlyph *glyphs;
+    size_t glyph_num;
+} CacheArray;
+
+MTGlyph *cache_array_get(CacheArray *array, MTFont *font, size_t c) {
+    size_t first = 0;
+    size_t last = array->glyph_num;
+    size_t selected;
+
+    MTGlyph tmp;
+    void *new;
+
+    while(first < last){
+        selected = (first+last)/2;
+        if(array->glyphs[selected].c == c) return array->glyphs+selected;
+        if(array->glyphs[selected].c < c) first = selected+1;
+        else last = selected;
+    }
+
+    if(MT_LOADERLIST_GET(font->loader, load_glyph)(font->data, font, &tmp,
+                         mt_font_get_glyph_id(font, c))){
+        mt_glyph_free(&tmp);
+        return &font->missing;
+    }
+    tmp.c = c;
+
+    new = realloc(array->glyphs, (array->glyph_num+1)*sizeof(MTGlyph));
+    if(new == NULL){
+        mt_glyph_free(&tmp);
+        return &font->missing;
+    }
+    array->glyphs = new;
+
+    memmove(array->glyphs+first+1, array->glyphs+first,
+            (array->glyph_num-first)*sizeof(MTGlyph));
+    array->glyphs[first] = tmp;
+    array->glyph_num++;
+
+    return array->glyphs+first;
+}
+
+void cache_array_free(CacheArray *array) {
+    size_t i;
+
+    for(i=0;i<array->glyph_num;i++) mt_glyph_free(array->glyphs+i);
+    free(array->glyphs);
+}
+
+int cache_warm(char *file, size_t num) {
+    MTReader reader;
+    MTFont font;
+    CacheArray array;
+
+    size_t i;
+    unsigned long int seed;
+
+    double start;
+    double table_time, array_time;
+
+    size_t point_sum = 0;
+    size_t check = 0;
+
+    /* Random BMP characters, most of them map to the missing glyph like
+     * they would for a font that doesn't cover the text. */
+    if(bench_font_init(&font, &reader, file)) return 1;
+    seed = num;
+    start = bench_time();
+    for(i=0;i<num;i++){
+        point_sum += mt_font_get_glyph(&font,
+                                       bench_random(&seed)&0xFFFF)->point_num;
+    }
+    table_time = bench_time()-start;
+    printf("%6lu characters: hash table %8.2f ms, %lu glyphs decoded\n",
+           (unsigned long int)num, table_time*1000, font.stats.misses);
+    bench_font_free(&font, &reader);
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+    array.glyphs = NULL;
+    array.glyph_num = 0;
+    seed = num;
+    start = bench_time();
+    for(i=0;i<num;i++){
+        check += cache_array_get(&array, &font,
+                                 bench_random(&seed)&0xFFFF)->point_num;
+    }
+    array_time = bench_time()-start;
+    printf("%6lu characters: array      %8.2f ms, %lu glyphs decoded\n",
+           (unsigned long int)num, array_time*1000,
+           (unsigned long int)array.glyph_num);
+    cache_array_free(&array);
+    bench_font_free(&font, &reader);
+
+    if(point_sum != check){
+        puts("the glyphs don't match!");
+        return 1;
+    }
+
+    return 0;
+}
+
+int bench_cache(char *file) {
+    if(cache_warm(file, 10000)) return 1;
+
+    return cache_warm(file, 50000);
+}
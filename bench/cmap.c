@@ -0,0 +1,252 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <mibitype/loaderlist.h>
+#include <mibitype/loaders/ttf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CMAP4_ROUNDS 20
+
+/* Emojis and the CJK extensions are in the first two supplementary
+ * planes. */
+#define CMAP12_FIRST 0x10000
+#define CMAP12_LAST 0x2FFFF
+#define CMAP12_LOOKUPS 65536
+#define CMAP12_ROUNDS 20
+
+/* The lookup of the reader based linear walk mt_ttf_get_glyph_id used to do
+ * before the segments were decoded once, to compare with it. */
+size_t cmap4_walk(MTTTF *ttf, MTReader *reader, size_t c) {
+    size_t i;
+    size_t pos;
+
+    unsigned short int seg_count;
+    unsigned short int end_char, start_char;
+    unsigned short int delta, offset;
+
+    MT_READER_JMP(reader, ttf->cmap.data_cur);
+    seg_count = mt_reader_read_short(reader)/2;
+    MT_READER_SKIP(reader, 2*3);
+
+    for(i=0;i<seg_count;i++){
+        end_char = mt_reader_read_short(reader);
+        if(end_char < c) continue;
+
+        pos = reader->cur;
+        MT_READER_SKIP(reader, seg_count*2);
+        start_char = mt_reader_read_short(reader);
+        if(start_char > c){
+            MT_READER_JMP(reader, pos);
+            continue;
+        }
+
+        MT_READER_SKIP(reader, seg_count*2-2);
+        delta = mt_reader_read_short(reader);
+        MT_READER_SKIP(reader, seg_count*2-2);
+        offset = mt_reader_read_short(reader);
+        if(!offset) return (delta+c)&0xFFFF;
+
+        MT_READER_SKIP(reader, offset+2*(c-start_char)-2);
+        offset = mt_reader_read_short(reader);
+
+        return offset ? (delta+offset)&0xFFFF : 0;
+    }
+
+    return 0;
+}
+
+int bench_cmap4(char *file) {
+    MTReader reader;
+    MTFont font;
+    MTTTF *ttf;
+
+    size_t (*get_glyph_id)(void *_data, void *_font, size_t c);
+
+    size_t c;
+    size_t mapped = 0;
+    size_t sum;
+    size_t check;
+    int round;
+
+    double start;
+    double search, walk;
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+
+    ttf = font.data;
+    if(font.loader != MT_LOADER_TTF || ttf->cmap.format != 4){
+        puts("skipped: the font doesn't use a format 4 cmap");
+        bench_font_free(&font, &reader);
+        return 0;
+    }
+
+    /* The loader is called directly, mt_font_get_glyph_id would otherwise
+     * answer from its character map after the first round. */
+    get_glyph_id = MT_LOADERLIST_GET(font.loader, get_glyph_id);
+
+    sum = 0;
+    start = bench_time();
+    for(round=0;round<CMAP4_ROUNDS;round++){
+        for(c=0;c<0x10000;c++) sum += get_glyph_id(font.data, &font, c);
+    }
+    search = bench_time()-start;
+
+    check = 0;
+    start = bench_time();
+    for(round=0;round<CMAP4_ROUNDS;round++){
+        for(c=0;c<0x10000;c++) check += cmap4_walk(ttf, &reader, c);
+    }
+    walk = bench_time()-start;
+
+    for(c=0;c<0x10000;c++) mapped += get_glyph_id(font.data, &font, c) != 0;
+
+    printf("%u segments, %lu mapped characters\n", ttf->cmap.seg_count,
+           (unsigned long int)mapped);
+    printf("binary search: %8.2f ns/lookup\n",
+           search*1e9/(CMAP4_ROUNDS*65536.0));
+    printf("linear walk  : %8.2f ns/lookup\n",
+           walk*1e9/(CMAP4_ROUNDS*65536.0));
+
+    bench_font_free(&font, &reader);
+
+    if(sum != check){
+        puts("the lookups don't match!");
+        return 1;
+    }
+
+    return 0;
+}
+
+/* The linear walk over the groups, as done before they were decoded. */
+size_t cmap12_walk(MTTTF *ttf, MTReader *reader, size_t c) {
+    unsigned long int i;
+    unsigned long int start_char, end_char, start_index;
+
+    MT_READER_JMP(reader, ttf->cmap.data_cur);
+
+    for(i=0;i<ttf->cmap.group_num;i++){
+        start_char = mt_reader_read_int(reader);
+        end_char = mt_reader_read_int(reader);
+        start_index = mt_reader_read_int(reader);
+        if(c >= start_char && c <= end_char){
+            return c-start_char+start_index;
+        }
+    }
+
+    return 0;
+}
+
+int bench_cmap12(char *file) {
+    MTReader reader;
+    MTFont font;
+    MTTTF *ttf;
+
+    size_t (*get_glyph_id)(void *_data, void *_font, size_t c);
+
+    size_t *chars;
+    size_t i;
+    size_t mapped = 0;
+    size_t sum;
+    size_t check;
+    unsigned long int seed = 12;
+    int round;
+
+    double start;
+    double search, walk;
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+
+    ttf = font.data;
+    if(font.loader != MT_LOADER_TTF || ttf->cmap.format != 12){
+        puts("skipped: the font doesn't use a format 12 cmap");
+        bench_font_free(&font, &reader);
+        return 0;
+    }
+
+    chars = malloc(CMAP12_LOOKUPS*sizeof(size_t));
+    if(chars == NULL){
+        bench_font_free(&font, &reader);
+        return 1;
+    }
+    for(i=0;i<CMAP12_LOOKUPS;i++){
+        chars[i] = CMAP12_FIRST+bench_random(&seed)%
+                   (CMAP12_LAST-CMAP12_FIRST+1);
+    }
+
+    get_glyph_id = MT_LOADERLIST_GET(font.loader, get_glyph_id);
+
+    sum = 0;
+    start = bench_time();
+    for(round=0;round<CMAP12_ROUNDS;round++){
+        for(i=0;i<CMAP12_LOOKUPS;i++){
+            sum += get_glyph_id(font.data, &font, chars[i]);
+        }
+    }
+    search = bench_time()-start;
+
+    check = 0;
+    start = bench_time();
+    for(round=0;round<CMAP12_ROUNDS;round++){
+        for(i=0;i<CMAP12_LOOKUPS;i++){
+            check += cmap12_walk(ttf, &reader, chars[i]);
+        }
+    }
+    walk = bench_time()-start;
+
+    for(i=0;i<CMAP12_LOOKUPS;i++){
+        mapped += get_glyph_id(font.data, &font, chars[i]) != 0;
+    }
+
+    printf("%lu groups, %lu of %d random characters in U+%X-U+%X mapped\n",
+           ttf->cmap.group_num, (unsigned long int)mapped, CMAP12_LOOKUPS,
+           CMAP12_FIRST, CMAP12_LAST);
+    printf("binary search: %8.2f ns/lookup\n",
+           search*1e9/((double)CMAP12_ROUNDS*CMAP12_LOOKUPS));
+    printf("linear walk  : %8.2f ns/lookup\n",
+           walk*1e9/((double)CMAP12_ROUNDS*CMAP12_LOOKUPS));
+
+    free(chars);
+    bench_font_free(&font, &reader);
+
+    if(sum != check){
+        puts("the lookups don't match!");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <mibitype/loaderlist.h>
+
+#include <stdio.h>
+
+#define DECODE_ROUNDS 10
+
+int bench_decode(char *file) {
+    MTReader reader;
+    MTFont font;
+    MTGlyph glyph;
+
+    int (*load_glyph)(void *_data, void *_font, void *_glyph, size_t id);
+
+    size_t i;
+    size_t glyphs = 0;
+    size_t points = 0;
+    size_t failed = 0;
+    int round;
+
+    double start;
+    double time;
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+
+    /* The loader is called directly so that every glyph gets decoded each
+     * round instead of being found in the cache. */
+    load_glyph = MT_LOADERLIST_GET(font.loader, load_glyph);
+
+    start = bench_time();
+    for(round=0;round<DECODE_ROUNDS;round++){
+        for(i=0;i<font.metrics_num;i++){
+            if(load_glyph(font.data, &font, &glyph, i)) failed++;
+            else points += glyph.point_num;
+            mt_glyph_free(&glyph);
+        }
+        glyphs += font.metrics_num;
+    }
+    time = bench_time()-start;
+
+    printf("%lu glyphs (%lu failed) and %lu points in %.2f ms\n",
+           (unsigned long int)glyphs, (unsigned long int)failed,
+           (unsigned long int)points, time*1000);
+    printf("%10.0f glyphs/s, %6.2f Mpoints/s\n", glyphs/time,
+           points/time/1e6);
+
+    bench_font_free(&font, &reader);
+
+    return 0;
+}
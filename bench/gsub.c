@@ -0,0 +1,97 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <mibitype/loaderlist.h>
+#include <mibitype/loaders/ttf.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define GSUB_GLYPHS 1000
+#define GSUB_ROUNDS 2000
+
+/* English text with a lot of ligature candidates. */
+char *gsub_text = "The first fluffy waffles of the official fjord office "
+                  "were efficiently shuffled off to the fifty affluent "
+                  "traffic officers. ";
+
+int bench_gsub(char *file) {
+    MTReader reader;
+    MTFont font;
+    MTTTF *ttf;
+
+    size_t ids[GSUB_GLYPHS];
+    size_t run[GSUB_GLYPHS];
+
+    size_t i;
+    size_t len;
+    size_t num = 0;
+    int round;
+
+    double start;
+    double time;
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+
+    len = strlen(gsub_text);
+    for(i=0;i<GSUB_GLYPHS;i++){
+        ids[i] = mt_font_get_glyph_id(&font,
+                                      (unsigned char)gsub_text[i%len]);
+    }
+
+    /* The copy is part of the measure, it is negligible compared to the
+     * substitutions. */
+    start = bench_time();
+    for(round=0;round<GSUB_ROUNDS;round++){
+        memcpy(run, ids, sizeof(ids));
+        num = mt_font_substitute(&font, run, GSUB_GLYPHS);
+    }
+    time = bench_time()-start;
+
+    ttf = font.data;
+    if(font.loader == MT_LOADER_TTF){
+        printf("%lu substitution lookups, ",
+               (unsigned long int)ttf->subst_lookup_num);
+    }
+    printf("%d glyphs substituted to %lu\n", GSUB_GLYPHS,
+           (unsigned long int)num);
+    printf("%8.2f us per 1k glyphs\n",
+           time*1e6/GSUB_ROUNDS*(1000.0/GSUB_GLYPHS));
+
+    bench_font_free(&font, &reader);
+
+    return 0;
+}
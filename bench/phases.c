@@ -0,0 +1,143 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <mibitype/atlas.h>
+#include <mibitype/runcache.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define PHASES_ROUNDS 50
+
+/* The text is drawn at a few sizes and moved by a fraction of a pixel each
+ * round, like scrolling text. */
+char *phases_text = "It was the best of times, it was the worst of times, it "
+                    "was the age of wisdom, it was the age of foolishness, "
+                    "it was the epoch of belief, it was the epoch of "
+                    "incredulity, it was the season of Light, it was the "
+                    "season of Darkness, it was the spring of hope, it was "
+                    "the winter of despair.";
+
+int phases_points[] = {9, 10, 12, 14};
+
+#define PHASES_POINT_NUM (sizeof(phases_points)/sizeof(phases_points[0]))
+
+/* The atlas is tried with enough space for all the glyphs, and with only two
+ * small pages, where more phases mean more evictions. */
+int phases_page_sizes[] = {256, 128};
+size_t phases_page_max[] = {4, 2};
+
+#define PHASES_ATLAS_NUM (sizeof(phases_page_max)/sizeof(phases_page_max[0]))
+
+int phases_run(MTFont *font, int phases, int page_size, size_t page_max) {
+    MTRun runs[PHASES_POINT_NUM];
+    MTAtlas atlas;
+
+    unsigned long int hits = 0, lookups = 0;
+
+    size_t i, n;
+    int round;
+    int phase;
+    int rc;
+
+    double start;
+    double time;
+
+    if((rc = mt_atlas_init(&atlas, font, page_size, page_max, phases))){
+        return rc;
+    }
+
+    for(i=0;i<PHASES_POINT_NUM;i++){
+        if((rc = mt_run_layout(runs+i, font, phases_points[i], phases,
+                               phases_text, strlen(phases_text)))){
+            while(i--) mt_run_free(runs+i);
+            mt_atlas_free(&atlas);
+            return rc;
+        }
+    }
+
+    start = bench_time();
+    for(round=0;round<PHASES_ROUNDS;round++){
+        for(i=0;i<PHASES_POINT_NUM;i++){
+            for(n=0;n<runs[i].num;n++){
+                /* The offset of the round moves the whole text. */
+                phase = (runs[i].phase[n]+round)%phases;
+                mt_atlas_get_phase(&atlas, runs[i].ids[n],
+                                   phases_points[i]*font->dpi/72, phase);
+            }
+        }
+    }
+    time = bench_time()-start;
+
+    for(i=0;i<(size_t)phases;i++){
+        hits += atlas.stats.phase_hits[i];
+        lookups += atlas.stats.phase_hits[i]+atlas.stats.phase_misses[i];
+    }
+
+    printf("%d phases: hit rate %6.2f %%, %5lu glyphs rasterized, "
+           "%3lu pages cleared, %6.2f ms\n", phases, 100.0*hits/lookups,
+           atlas.stats.misses, atlas.stats.evictions, time*1000);
+
+    for(i=0;i<PHASES_POINT_NUM;i++) mt_run_free(runs+i);
+    mt_atlas_free(&atlas);
+
+    return 0;
+}
+
+int bench_phases(char *file) {
+    MTReader reader;
+    MTFont font;
+
+    size_t i;
+    int phases;
+    int rc = 0;
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+
+    for(i=0;i<PHASES_ATLAS_NUM && !rc;i++){
+        printf("%lu pages of %dx%d pixels:\n",
+               (unsigned long int)phases_page_max[i], phases_page_sizes[i],
+               phases_page_sizes[i]);
+        for(phases=1;phases<=8 && !rc;phases*=2){
+            rc = phases_run(&font, phases, phases_page_sizes[i],
+                            phases_page_max[i]);
+        }
+    }
+
+    bench_font_free(&font, &reader);
+
+    return rc;
+}
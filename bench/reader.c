@@ -0,0 +1,108 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <mibitype/font.h>
+
+#include <stdio.h>
+
+#define READER_ROUNDS 5
+
+/* Open a font, load its first glyph and close it again. */
+int reader_first_glyph(char *file, int mmap, double *time, size_t *rss) {
+    MTReader reader;
+    MTFont font;
+
+    double start;
+    size_t rss_start;
+
+    int rc;
+
+    rss_start = bench_rss();
+    start = bench_time();
+
+    rc = mmap ? mt_reader_init_mmap(&reader, file) :
+                mt_reader_init(&reader, file);
+    if(rc) return rc;
+
+    if((rc = mt_font_init(&font, &reader, 96))){
+        mt_reader_free(&reader);
+        return rc;
+    }
+
+    mt_font_get_glyph(&font, 'A');
+
+    *time = bench_time()-start;
+    *rss = bench_rss()-rss_start;
+
+    mt_font_free(&font);
+    mt_reader_free(&reader);
+
+    return 0;
+}
+
+int bench_reader(char *file) {
+    char *names[2] = {"fread", "mmap"};
+
+    double best[2] = {0, 0};
+    double time;
+    size_t rss[2] = {0, 0};
+    size_t round_rss;
+
+    int round;
+    int mode;
+
+    /* The modes are alternated, so that both benefit from the page cache.
+     * The RSS is taken from the first round, later ones reuse the memory
+     * freed by the previous ones. */
+    for(round=0;round<READER_ROUNDS;round++){
+        for(mode=0;mode<2;mode++){
+            if(reader_first_glyph(file, mode, &time, &round_rss)) return 1;
+            if(!round){
+                best[mode] = time;
+                rss[mode] = round_rss;
+            }
+            if(time < best[mode]) best[mode] = time;
+        }
+    }
+
+    for(mode=0;mode<2;mode++){
+        printf("%-5s: first glyph after %8.3f ms, RSS +%lu KiB\n",
+               names[mode], best[mode]*1000,
+               (unsigned long int)rss[mode]/1024);
+    }
+
+    return 0;
+}
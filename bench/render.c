@@ -0,0 +1,219 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <mibitype/render.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Each size is rendered for at least this long, in seconds. */
+#define RENDER_TIME 0.2
+
+int render_sizes[] = {8, 12, 16, 24, 32, 48, 64, 100, 150, 200};
+
+#define RENDER_SIZE_NUM (sizeof(render_sizes)/sizeof(render_sizes[0]))
+
+/* The rows swept by the kernels benchmark. */
+#define KERNELS_WIDTH 1024
+#define KERNELS_ROWS 100000
+
+/* The glyphs of the printable ASCII characters. */
+#define RENDER_GLYPHS ('~'-' '+1)
+
+/* Render all the glyphs once at a size, growing the buffer of the bitmaps
+ * as needed. The number of pixels rendered is added to pixels. */
+int render_glyphs(MTRasterizer *rasterizer, MTFont *font, MTGlyph **glyphs,
+                  int size, unsigned char **buffer, size_t *buffer_size,
+                  double *pixels) {
+    MTBitmap bitmap;
+
+    size_t i;
+    size_t needed;
+    void *new;
+
+    int rc;
+
+    for(i=0;i<RENDER_GLYPHS;i++){
+        mt_render_get_box(font, glyphs[i], size, 0, &bitmap);
+
+        needed = (size_t)bitmap.pitch*bitmap.height;
+        if(needed > *buffer_size){
+            new = realloc(*buffer, needed);
+            if(new == NULL) return 1;
+            *buffer = new;
+            *buffer_size = needed;
+        }
+        bitmap.data = *buffer;
+
+        if((rc = mt_render_glyph(rasterizer, font, glyphs[i], size, 0,
+                                 &bitmap))){
+            return rc;
+        }
+        *pixels += needed;
+    }
+
+    return 0;
+}
+
+int bench_render(char *file) {
+    MTReader reader;
+    MTFont font;
+    MTRasterizer rasterizer;
+
+    MTGlyph *glyphs[RENDER_GLYPHS];
+
+    unsigned char *buffer = NULL;
+    size_t buffer_size = 0;
+
+    size_t i;
+    size_t rounds;
+    int rc = 0;
+
+    double start;
+    double time;
+    double pixels;
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+
+    /* The glyphs are decoded and pinned first, only rendering is timed. */
+    for(i=0;i<RENDER_GLYPHS;i++){
+        glyphs[i] = mt_font_get_glyph(&font, ' '+i);
+        mt_font_pin_glyph(&font, glyphs[i]);
+    }
+
+    mt_rasterizer_init(&rasterizer);
+
+    for(i=0;i<RENDER_SIZE_NUM && !rc;i++){
+        pixels = 0;
+        rounds = 0;
+        start = bench_time();
+        do{
+            rc = render_glyphs(&rasterizer, &font, glyphs, render_sizes[i],
+                               &buffer, &buffer_size, &pixels);
+            rounds++;
+            time = bench_time()-start;
+        }while(!rc && time < RENDER_TIME);
+
+        printf("%3d px: %10.0f glyphs/s, %8.2f Mpx/s\n", render_sizes[i],
+               rounds*RENDER_GLYPHS/time, pixels/time/1e6);
+    }
+
+    free(buffer);
+    mt_rasterizer_free(&rasterizer);
+    for(i=0;i<RENDER_GLYPHS;i++) mt_font_unpin_glyph(&font, glyphs[i]);
+    bench_font_free(&font, &reader);
+
+    return rc;
+}
+
+int bench_kernels(char *file) {
+    char *names[MT_RENDER_KERNEL_AMOUNT] = {"scalar", "SSE2", "AVX2"};
+    const int sizes[2] = {64, 200};
+
+    MTReader reader;
+    MTFont font;
+    MTRasterizer rasterizer;
+
+    MTGlyph *glyphs[RENDER_GLYPHS];
+
+    int cover[KERNELS_WIDTH+1];
+    int area[KERNELS_WIDTH+1];
+    unsigned char out[KERNELS_WIDTH];
+
+    unsigned char *buffer = NULL;
+    size_t buffer_size = 0;
+
+    size_t i;
+    int kernel;
+    int n;
+    int rc = 0;
+
+    double start;
+    double time;
+    double pixels;
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+
+    for(i=0;i<RENDER_GLYPHS;i++){
+        glyphs[i] = mt_font_get_glyph(&font, ' '+i);
+        mt_font_pin_glyph(&font, glyphs[i]);
+    }
+
+    memset(cover, 0, sizeof(cover));
+    memset(area, 0, sizeof(area));
+
+    for(kernel=0;kernel<MT_RENDER_KERNEL_AMOUNT && !rc;kernel++){
+        if(!mt_render_kernel_supported(kernel)){
+            printf("%-6s: not supported\n", names[kernel]);
+            continue;
+        }
+
+        mt_rasterizer_init(&rasterizer);
+        mt_rasterizer_set_kernel(&rasterizer, kernel);
+
+        /* The kernels don't branch on the values of the cells, so empty
+         * rows are as good as any to time them alone. */
+        start = bench_time();
+        for(n=0;n<KERNELS_ROWS;n++){
+            rasterizer.sweep(cover, area, out, KERNELS_WIDTH);
+        }
+        time = bench_time()-start;
+        printf("%-6s: sweep %8.2f Mpx/s", names[kernel],
+               (double)KERNELS_ROWS*KERNELS_WIDTH/time/1e6);
+
+        for(n=0;n<2 && !rc;n++){
+            pixels = 0;
+            start = bench_time();
+            do{
+                rc = render_glyphs(&rasterizer, &font, glyphs, sizes[n],
+                                   &buffer, &buffer_size, &pixels);
+                time = bench_time()-start;
+            }while(!rc && time < RENDER_TIME);
+            printf(", %d px glyphs %8.2f Mpx/s", sizes[n],
+                   pixels/time/1e6);
+        }
+        putchar('\n');
+
+        mt_rasterizer_free(&rasterizer);
+    }
+
+    free(buffer);
+    for(i=0;i<RENDER_GLYPHS;i++) mt_font_unpin_glyph(&font, glyphs[i]);
+    bench_font_free(&font, &reader);
+
+    return rc;
+}
@@ -0,0 +1,123 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <mibitype/sdf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Each size is generated for at least this long, in seconds. */
+#define SDF_TIME 0.2
+
+/* The glyphs of the printable ASCII characters. */
+#define SDF_GLYPHS ('~'-' '+1)
+
+int sdf_sizes[] = {16, 32, 64};
+int sdf_spreads[] = {4, 8};
+
+#define SDF_SIZE_NUM (sizeof(sdf_sizes)/sizeof(sdf_sizes[0]))
+#define SDF_SPREAD_NUM (sizeof(sdf_spreads)/sizeof(sdf_spreads[0]))
+
+int bench_sdf(char *file) {
+    MTReader reader;
+    MTFont font;
+    MTSdf sdf;
+    MTBitmap bitmap;
+
+    MTGlyph *glyphs[SDF_GLYPHS];
+
+    unsigned char *buffer = NULL;
+    size_t buffer_size = 0;
+    size_t needed;
+    void *new;
+
+    size_t i, n;
+    size_t num;
+    int spread;
+    int rc = 0;
+
+    double start;
+    double time;
+
+    if(bench_font_init(&font, &reader, file)) return 1;
+
+    for(i=0;i<SDF_GLYPHS;i++){
+        glyphs[i] = mt_font_get_glyph(&font, ' '+i);
+        mt_font_pin_glyph(&font, glyphs[i]);
+    }
+
+    mt_sdf_init(&sdf);
+
+    for(n=0;n<SDF_SPREAD_NUM*SDF_SIZE_NUM && !rc;n++){
+        spread = sdf_spreads[n/SDF_SIZE_NUM];
+
+        num = 0;
+        start = bench_time();
+        do{
+            for(i=0;i<SDF_GLYPHS && !rc;i++){
+                mt_sdf_get_box(&font, glyphs[i], sdf_sizes[n%SDF_SIZE_NUM],
+                               spread, &bitmap);
+
+                needed = (size_t)bitmap.pitch*bitmap.height;
+                if(needed > buffer_size){
+                    new = realloc(buffer, needed);
+                    if(new == NULL){
+                        rc = 1;
+                        break;
+                    }
+                    buffer = new;
+                    buffer_size = needed;
+                }
+                bitmap.data = buffer;
+
+                rc = mt_sdf_glyph(&sdf, &font, glyphs[i],
+                                  sdf_sizes[n%SDF_SIZE_NUM], spread, &bitmap);
+            }
+            num += SDF_GLYPHS;
+            time = bench_time()-start;
+        }while(!rc && time < SDF_TIME);
+
+        printf("%2d px, spread %d: %8.2f us/glyph\n",
+               sdf_sizes[n%SDF_SIZE_NUM], spread, time*1e6/num);
+    }
+
+    free(buffer);
+    mt_sdf_free(&sdf);
+    for(i=0;i<SDF_GLYPHS;i++) mt_font_unpin_glyph(&font, glyphs[i]);
+    bench_font_free(&font, &reader);
+
+    return rc;
+}
@@ -0,0 +1,143 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <bench.h>
+
+#include <mibitype/utf8.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UTF8_SIZE (1<<20)
+#define UTF8_ROUNDS 20
+
+/* Latin text with and without accents, and Japanese text ("display a string
+ * of characters" and a full stop), written with escapes to keep the source
+ * file ASCII. */
+char *utf8_texts[] = {
+    "The quick brown fox jumps over the lazy dog. ",
+    "Le caf\xc3\xa9 na\xc3\xafve d\xc3\xa9j\xc3\xa0 vu. ",
+    "\xe6\x96\x87\xe5\xad\x97\xe5\x88\x97\xe3\x82\x92\xe8\xa1\xa8\xe7\xa4\xba"
+    "\xe3\x81\x99\xe3\x82\x8b",
+    "\xe3\x80\x82",
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit.\n"
+};
+
+#define UTF8_TEXT_NUM (sizeof(utf8_texts)/sizeof(utf8_texts[0]))
+
+/* Fill buffer with size bytes of text, made of the texts from first to
+ * last. */
+void utf8_fill(char *buffer, size_t size, size_t first, size_t last) {
+    size_t pos = 0;
+    size_t i = first;
+    size_t len;
+
+    while(pos < size){
+        len = strlen(utf8_texts[i]);
+        /* Don't cut a character in two. */
+        if(len > size-pos) break;
+
+        memcpy(buffer+pos, utf8_texts[i], len);
+        pos += len;
+
+        i = i == last ? first : i+1;
+    }
+    memset(buffer+pos, ' ', size-pos);
+}
+
+void utf8_run(char *name, char *buffer, unsigned long int *out) {
+    size_t i;
+    size_t read;
+    size_t pos;
+    size_t num = 0;
+    size_t check = 0;
+    int round;
+
+    double start;
+    double decode_time, next_time;
+
+    start = bench_time();
+    for(round=0;round<UTF8_ROUNDS;round++){
+        num = mt_utf8_decode(buffer, UTF8_SIZE, out, UTF8_SIZE, &read);
+    }
+    decode_time = bench_time()-start;
+
+    start = bench_time();
+    for(round=0;round<UTF8_ROUNDS;round++){
+        pos = 0;
+        i = 0;
+        while(pos < UTF8_SIZE){
+            out[i++] = mt_utf8_next(buffer, UTF8_SIZE, &pos);
+        }
+        check = i;
+    }
+    next_time = bench_time()-start;
+
+    printf("%-6s: %7lu characters, mt_utf8_decode %8.1f MB/s, "
+           "mt_utf8_next %8.1f MB/s\n", name, (unsigned long int)num,
+           UTF8_ROUNDS*(UTF8_SIZE/1e6)/decode_time,
+           UTF8_ROUNDS*(UTF8_SIZE/1e6)/next_time);
+
+    if(num != check) puts("the decoders don't agree!");
+}
+
+int bench_utf8(char *file) {
+    char *buffer;
+    unsigned long int *out;
+
+    (void)file;
+
+    buffer = malloc(UTF8_SIZE);
+    out = malloc(UTF8_SIZE*sizeof(unsigned long int));
+    if(buffer == NULL || out == NULL){
+        free(buffer);
+        free(out);
+        return 1;
+    }
+
+    utf8_fill(buffer, UTF8_SIZE, 0, 0);
+    utf8_run("ASCII", buffer, out);
+
+    utf8_fill(buffer, UTF8_SIZE, 0, UTF8_TEXT_NUM-1);
+    utf8_run("mixed", buffer, out);
+
+    utf8_fill(buffer, UTF8_SIZE, 2, 3);
+    utf8_run("CJK", buffer, out);
+
+    free(buffer);
+    free(out);
+
+    return 0;
+}
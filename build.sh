@@ -33,23 +33,56 @@
 # ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 # POSSIBILITY OF SUCH DAMAGE.
 
-src=("src/main.c" \
-     "src/mibitype/reader.c" \
+# The library, then the programs that use it.
+lib=("src/mibitype/reader.c" \
      "src/mibitype/glyph.c" \
      "src/mibitype/loader.c" \
      "src/mibitype/loaderlist.c" \
      "src/mibitype/font.c" \
-     "src/mibitype/loaders/ttf.c" \
-     "src/render/render.c")
+     "src/mibitype/map.c" \
+     "src/mibitype/utf8.c" \
+     "src/mibitype/runcache.c" \
+     "src/mibitype/render.c" \
+     "src/mibitype/atlas.c" \
+     "src/mibitype/sdf.c" \
+     "src/mibitype/batch.c" \
+     "src/mibitype/arena.c" \
+     "src/mibitype/loaders/ttf.c")
+demo=("src/main.c" \
+      "src/render/render.c")
+bench=("bench/bench.c" \
+       "bench/reader.c" \
+       "bench/cmap.c" \
+       "bench/cache.c" \
+       "bench/arena.c" \
+       "bench/decode.c" \
+       "bench/utf8.c" \
+       "bench/gsub.c" \
+       "bench/render.c" \
+       "bench/phases.c" \
+       "bench/sdf.c" \
+       "bench/batch.c")
+test=("test/test.c" \
+      "test/render.c" \
+      "test/sdf.c" \
+      "test/arena.c" \
+      "test/utf8.c" \
+      "test/cmap.c" \
+      "test/map.c" \
+      "test/layout.c" \
+      "test/runcache.c" \
+      "test/atlas.c")
 target="nes"
 builddir="build"
 warnings="-Wall -Wextra -Wpedantic"
-incdirs=("src" "src/render")
-libs=("SDL2")
-objfiles=()
-flags=("-g ")
+incdirs=("src" "src/render" "bench" "test")
+libs=("m" "pthread")
+demolibs=("SDL2")
+flags=("-g -O2 ")
 
 output="mibitype"
+benchoutput="mibitype-bench"
+testoutput="mibitype-test"
 
 run_cmd() {
     typeset cmd=$1
@@ -62,31 +95,60 @@ run_cmd() {
     fi
 }
 
+# Compile the files given as arguments, their objects are put in objfiles.
+build_objs() {
+    objfiles=()
+    for file in "$@"
+    do
+        echo "-- Building ${file}..."
+        # Both renderers are called render.c, keep their path in the name.
+        base=$(echo ${file#src/} | tr / _)
+        obj="${builddir}/${base}.o"
+        cmd="cc -c ${file} -o ${obj} -ansi ${flags[@]}"
+        run_cmd "${cmd}"
+        objfiles+=($obj)
+    done
+}
+
 flags+=$warnings
 for dir in "${incdirs[@]}"
 do
     flags+=("-I${dir}")
 done
 
-for lib in "${libs[@]}"
+ldflags=()
+for name in "${libs[@]}"
 do
-    flags+=("-l${lib}")
+    ldflags+=("-l${name}")
 done
 
 mkdir -p $builddir
 
-for file in "${src[@]}"
+build_objs "${lib[@]}"
+libobjs=("${objfiles[@]}")
+
+# The benchmarks and the tests don't need SDL, they are built first so that
+# they are available even if it is missing.
+build_objs "${bench[@]}"
+echo "-- Linking ${benchoutput}..."
+outfile="${builddir}/${benchoutput}"
+cmd="cc ${libobjs[@]} ${objfiles[@]} -o ${outfile} ${ldflags[@]}"
+run_cmd "${cmd}"
+
+build_objs "${test[@]}"
+echo "-- Linking ${testoutput}..."
+outfile="${builddir}/${testoutput}"
+cmd="cc ${libobjs[@]} ${objfiles[@]} -o ${outfile} ${ldflags[@]}"
+run_cmd "${cmd}"
+
+build_objs "${demo[@]}"
+for name in "${demolibs[@]}"
 do
-    echo "-- Building ${file}..."
-    base=$(basename $file)
-    obj="${builddir}/${base}.o"
-    cmd="cc -c ${file} -o ${obj} -ansi ${flags[@]}"
-    run_cmd "${cmd}"
-    objfiles+=($obj)
+    ldflags+=("-l${name}")
 done
 
-echo "-- Linking..."
+echo "-- Linking ${output}..."
 outfile="${builddir}/${output}"
-cmd="cc ${objfiles[@]} ${ldscript} -o ${outfile} ${flags[@]}"
+cmd="cc ${libobjs[@]} ${objfiles[@]} ${ldscript} -o ${outfile} ${flags[@]}"
+cmd+=" ${ldflags[@]}"
 run_cmd "${cmd}"
-
@@ -39,17 +39,27 @@
 #include <render.h>
 
 #include <mibitype/font.h>
+#include <mibitype/runcache.h>
+#include <mibitype/atlas.h>
 
 Renderer renderer;
 
 MTFont font;
 
+MTRunCache runs;
+
+MTAtlas atlas;
+
 size_t selected;
 char lock;
 
 #define DEBUG_UTF8 0
 #define DEBUG_METRICS 0
 #define VIEW_GLYPHS 0
+/* Draw the strings with the rasterizer instead of their outlines. */
+#define RASTERIZE 1
+/* The number of horizontal subpixel positions of the rasterized glyphs. */
+#define PHASES 4
 
 #define SCALE 1
 #define WIDTH 320
@@ -71,8 +81,8 @@ void debug_render_glyph(MTFont *font, MTGlyph *glyph, int dx, int dy,
     if(glyph->contour_ends == NULL) return;
     point_num = glyph->contour_ends[glyph->contour_num-1];
     if(!point_num) return;
-    x = PIXELS(glyph->points->x*scale);
-    y = PIXELS(glyph->points->y*scale);
+    x = PIXELS(MT_GLYPH_X(glyph, 0)*scale);
+    y = PIXELS(MT_GLYPH_Y(glyph, 0)*scale);
     sx = x;
     sy = y;
 
@@ -111,8 +121,8 @@ void debug_render_glyph(MTFont *font, MTGlyph *glyph, int dx, int dy,
         if(i == glyph->contour_ends[n]){
             render_line(&renderer, x+dx, dy-y, sx+dx, dy-sy, 255, 255, 255);
             if(i < point_num-1){
-                x = PIXELS(glyph->points[i+1].x*scale);
-                y = PIXELS(glyph->points[i+1].y*scale);
+                x = PIXELS(MT_GLYPH_X(glyph, i+1)*scale);
+                y = PIXELS(MT_GLYPH_Y(glyph, i+1)*scale);
                 sx = x;
                 sy = y;
             }else{
@@ -121,101 +131,70 @@ void debug_render_glyph(MTFont *font, MTGlyph *glyph, int dx, int dy,
             n++;
         }else{
             render_line(&renderer, x+dx, dy-y,
-                        PIXELS(glyph->points[i+1].x*scale)+dx,
-                        dy-PIXELS(glyph->points[i+1].y*scale), 255, 255, 255);
-            x = PIXELS(glyph->points[i+1].x*scale);
-            y = PIXELS(glyph->points[i+1].y*scale);
+                        PIXELS(MT_GLYPH_X(glyph, i+1)*scale)+dx,
+                        dy-PIXELS(MT_GLYPH_Y(glyph, i+1)*scale),
+                        255, 255, 255);
+            x = PIXELS(MT_GLYPH_X(glyph, i+1)*scale);
+            y = PIXELS(MT_GLYPH_Y(glyph, i+1)*scale);
         }
     }
     render_line(&renderer, x+dx, dy-y, sx+dx, dy-sy, 255, 255, 255);
     for(i=0;i<point_num;i++){
-        render_set_pixel(&renderer, PIXELS(glyph->points[i].x*scale)+dx,
-                         dy-PIXELS(glyph->points[i].y*scale),
-                         glyph->points[i].on_curve ? 255 : 0,
-                         glyph->points[i].on_curve ? 0 : 255, 0);
+        render_set_pixel(&renderer, PIXELS(MT_GLYPH_X(glyph, i)*scale)+dx,
+                         dy-PIXELS(MT_GLYPH_Y(glyph, i)*scale),
+                         MT_GLYPH_ON_CURVE(glyph, i) ? 255 : 0,
+                         MT_GLYPH_ON_CURVE(glyph, i) ? 0 : 255, 0);
+    }
+}
+
+void debug_render_bitmap(MTFont *font, size_t id, int phase, int dx, int dy,
+                         float scale) {
+    MTAtlasGlyph *glyph;
+    unsigned char *data;
+    int size = points*font->dpi/72*scale;
+    int x, y;
+    unsigned char alpha;
+
+    /* The glyph is only rasterized the first time it is drawn at this
+     * size. */
+    glyph = mt_atlas_get_phase(&atlas, id, size, phase);
+    if(glyph == NULL || glyph->page == MT_ATLAS_NONE) return;
+
+    data = atlas.pages[glyph->page].data;
+    for(y=0;y<glyph->height;y++){
+        for(x=0;x<glyph->width;x++){
+            alpha = data[(glyph->y+y)*atlas.page_size+glyph->x+x];
+            if(!alpha) continue;
+            render_set_pixel(&renderer, dx+glyph->left+x, dy-glyph->top+y,
+                             alpha, alpha, alpha);
+        }
     }
 }
 
 void debug_render_str(MTFont *font, char *str, int dx, int dy, float scale) {
+#if !RASTERIZE
     MTGlyph *glyph;
-    int x = dx, y = dy;
+#endif
+    MTRun *run;
 
     size_t i;
 
-    size_t c = 0;
-
-    int byte_num = 1;
-
-#if DEBUG_UTF8
-    puts("=======================");
-#endif
+    /* The string is only laid out the first time it is drawn. */
+    run = mt_run_cache_get(&runs, font, points, PHASES, str, strlen(str));
+    if(run == NULL) return;
 
-    for(i=0;i<strlen(str);i++){
-#if DEBUG_UTF8
-        printf("char: %x\n", (int)str[i]&0xFF);
-        printf("byte num: %x\n", byte_num);
-#endif
-        if(byte_num > 1){
-#if DEBUG_UTF8
-            printf("before shift: %lx\n", c);
-#endif
-            c <<= 6;
-#if DEBUG_UTF8
-            printf("after shift: %lx\n", c);
-            printf("new bits: %x\n", str[i]&0x3F);
-#endif
-            c |= str[i]&0x3F;
-#if DEBUG_UTF8
-            printf("after or: %lx\n", c);
-#endif
-            byte_num--;
-            if(byte_num > 1) continue;
-        }else{
-            if((str[i]&0xE0) == 0xC0){
-                c = str[i]&0x1F;
-                byte_num = 2;
-#if DEBUG_UTF8
-                printf("after init: %lx\n", c);
-#endif
-                continue;
-            }else if((str[i]&0xF0) == 0xE0){
-                c = str[i]&0x0F;
-                byte_num = 3;
-#if DEBUG_UTF8
-                printf("after init: %lx\n", c);
-#endif
-                continue;
-            }else if((str[i]&0xF8) == 0xF0){
-                c = str[i]&0x07;
-                byte_num = 4;
+    for(i=0;i<run->num;i++){
 #if DEBUG_UTF8
-                printf("after init: %lx\n", c);
+        printf("%lx\n", (unsigned long int)run->ids[i]);
 #endif
-                continue;
-            }else{
-                c = str[i];
-                byte_num = 1;
-            }
-        }
-        if(c == '\n'){
-            x = dx;
-            y += PIXELS((font->ascender+font->line_gap-font->descender)*scale);
-            continue;
-        }
-        if(c == ' '){
-            /* Ugly workaround because somehow many fonts don't seem to include
-             * an empty space character */
-            x += PIXELS(400*scale);
-            continue;
-        }
-
-#if DEBUG_UTF8
-        printf("%lx, %c\n", c, (char)c);
+#if RASTERIZE
+        debug_render_bitmap(font, run->ids[i], run->phase[i],
+                            dx+run->x[i]*scale, dy+run->y[i]*scale, scale);
+#else
+        glyph = mt_font_get_glyph_by_id(font, run->ids[i]);
+        debug_render_glyph(font, glyph, dx+run->x[i]*scale,
+                           dy+run->y[i]*scale, scale);
 #endif
-        glyph = mt_font_get_glyph(font, c);
-        debug_render_glyph(font, glyph, x, y, scale);
-
-        x += PIXELS(glyph->advance_width*scale);
     }
 }
 
@@ -293,7 +272,7 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    if(mt_reader_init(&reader, argv[1])){
+    if(mt_reader_init_mmap(&reader, argv[1])){
         fputs("mibitype: Failed to open file!\n", stderr);
 
         return EXIT_FAILURE;
@@ -310,9 +289,24 @@ int main(int argc, char **argv) {
 
     lock = 0;
 
+    if(mt_run_cache_init(&runs, 16)){
+        fputs("mibitype: Out of memory!\n", stderr);
+
+        return EXIT_FAILURE;
+    }
+
+    if(mt_atlas_init(&atlas, &font, 512, 4, PHASES)){
+        fputs("mibitype: Out of memory!\n", stderr);
+
+        return EXIT_FAILURE;
+    }
+
     render_init(&renderer, WIDTH, HEIGHT, "MibiType");
     render_main_loop(&renderer, loop);
 
+    mt_run_cache_free(&runs);
+    mt_atlas_free(&atlas);
+
     mt_font_free(&font);
     mt_reader_free(&reader);
 
@@ -0,0 +1,279 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mibitype/arena.h>
+#include <mibitype/errors.h>
+
+#include <stdlib.h>
+
+int mt_arena_init(MTArena *arena, size_t chunk_size) {
+    size_t i;
+
+    arena->chunks = NULL;
+    arena->chunk_num = 0;
+    arena->chunk_size = chunk_size < MT_ARENA_MIN_CHUNK ? MT_ARENA_MIN_CHUNK :
+                        chunk_size;
+
+    arena->current = MT_ARENA_NONE;
+    arena->cur = NULL;
+    arena->left = 0;
+
+    for(i=0;i<MT_ARENA_CLASSES;i++){
+        arena->free_lists[i] = NULL;
+    }
+
+    arena->memory = 0;
+    arena->released = 0;
+    arena->trim_at = arena->chunk_size;
+
+    return MT_E_NONE;
+}
+
+size_t _mt_arena_class(size_t size) {
+    size_t n = MT_ARENA_MIN_SHIFT;
+
+    while(((size_t)1<<n) < size) n++;
+
+    return n;
+}
+
+MTArenaChunk *_mt_arena_new_chunk(MTArena *arena, size_t size) {
+    void *new;
+    MTArenaChunk *chunk;
+
+    new = realloc(arena->chunks, (arena->chunk_num+1)*sizeof(MTArenaChunk));
+    if(new == NULL) return NULL;
+    arena->chunks = new;
+
+    chunk = arena->chunks+arena->chunk_num;
+
+    chunk->data = malloc(size);
+    if(chunk->data == NULL) return NULL;
+
+    chunk->used = 0;
+    chunk->released = 0;
+
+    arena->chunk_num++;
+    arena->memory += size;
+
+    return chunk;
+}
+
+void *mt_arena_alloc(MTArena *arena, size_t size) {
+    size_t n;
+    size_t block_size;
+
+    void *block;
+    MTArenaChunk *chunk;
+
+    if(!size) return NULL;
+
+    n = _mt_arena_class(size);
+    block_size = (size_t)1<<n;
+
+    if(arena->free_lists[n] != NULL){
+        /* Reuse a released block, the next free block is stored in it. */
+        block = arena->free_lists[n];
+        arena->free_lists[n] = *(void**)block;
+        arena->released -= block_size;
+
+        return block;
+    }
+
+    if(block_size > arena->chunk_size){
+        /* Too big for a chunk, give it its own. */
+        chunk = _mt_arena_new_chunk(arena, block_size);
+        if(chunk == NULL) return NULL;
+        chunk->used = block_size;
+
+        return chunk->data;
+    }
+
+    if(block_size > arena->left){
+        /* The end of the current chunk is lost, but the chunks are big
+         * compared to the blocks. */
+        chunk = _mt_arena_new_chunk(arena, arena->chunk_size);
+        if(chunk == NULL){
+            arena->current = MT_ARENA_NONE;
+            arena->cur = NULL;
+            arena->left = 0;
+            return NULL;
+        }
+        arena->current = chunk-arena->chunks;
+        arena->cur = chunk->data;
+        arena->left = arena->chunk_size;
+    }
+
+    block = arena->cur;
+    arena->cur += block_size;
+    arena->left -= block_size;
+    arena->chunks[arena->current].used += block_size;
+
+    return block;
+}
+
+size_t mt_arena_block_size(size_t size) {
+    if(!size) return 0;
+
+    return (size_t)1<<_mt_arena_class(size);
+}
+
+void mt_arena_release(MTArena *arena, void *ptr, size_t size) {
+    size_t n;
+
+    if(ptr == NULL) return;
+
+    n = _mt_arena_class(size);
+
+    *(void**)ptr = arena->free_lists[n];
+    arena->free_lists[n] = ptr;
+    arena->released += (size_t)1<<n;
+}
+
+int _mt_arena_compare(const void *a, const void *b) {
+    const MTArenaChunk *chunk_a = a;
+    const MTArenaChunk *chunk_b = b;
+
+    if(chunk_a->data < chunk_b->data) return -1;
+
+    return chunk_a->data > chunk_b->data;
+}
+
+/* Find the chunk that contains a block, the chunks must be sorted by
+ * address. */
+MTArenaChunk *_mt_arena_find(MTArena *arena, void *block) {
+    size_t begin = 0;
+    size_t end = arena->chunk_num;
+    size_t mid;
+
+    /* Search the last chunk that starts at or before the block. */
+    while(end-begin > 1){
+        mid = begin+(end-begin)/2;
+        if(arena->chunks[mid].data <= (unsigned char*)block){
+            begin = mid;
+        }else{
+            end = mid;
+        }
+    }
+
+    return arena->chunks+begin;
+}
+
+void mt_arena_trim(MTArena *arena) {
+    size_t i, n;
+    size_t size;
+
+    unsigned char *current;
+    void *block;
+    void **link;
+    MTArenaChunk *chunk;
+
+    if(arena->released < arena->trim_at) return;
+
+    /* Sorting the chunks moves the one of the bump pointer. */
+    current = arena->current != MT_ARENA_NONE ?
+              arena->chunks[arena->current].data : NULL;
+
+    qsort(arena->chunks, arena->chunk_num, sizeof(MTArenaChunk),
+          _mt_arena_compare);
+
+    for(i=0;i<arena->chunk_num;i++){
+        arena->chunks[i].released = 0;
+    }
+
+    for(n=0;n<MT_ARENA_CLASSES;n++){
+        for(block=arena->free_lists[n];block!=NULL;block=*(void**)block){
+            _mt_arena_find(arena, block)->released += (size_t)1<<n;
+        }
+    }
+
+    /* Unlink the blocks of the empty chunks from the free lists. */
+    for(n=0;n<MT_ARENA_CLASSES;n++){
+        link = arena->free_lists+n;
+        while(*link != NULL){
+            chunk = _mt_arena_find(arena, *link);
+            if(chunk->released == chunk->used){
+                *link = *(void**)*link;
+            }else{
+                link = *link;
+            }
+        }
+    }
+
+    arena->current = MT_ARENA_NONE;
+
+    for(i=n=0;i<arena->chunk_num;i++){
+        chunk = arena->chunks+i;
+
+        if(chunk->released == chunk->used){
+            arena->released -= chunk->used;
+
+            if(chunk->data == current){
+                /* Keep the chunk of the bump pointer but start it over. */
+                chunk->used = 0;
+                arena->cur = chunk->data;
+                arena->left = arena->chunk_size;
+            }else{
+                size = chunk->used > arena->chunk_size ? chunk->used :
+                       arena->chunk_size;
+                arena->memory -= size;
+
+                free(chunk->data);
+                continue;
+            }
+        }
+
+        if(chunk->data == current) arena->current = n;
+        arena->chunks[n++] = *chunk;
+    }
+
+    arena->chunk_num = n;
+
+    /* Wait until half of the arena was released again, so that the time
+     * spent here stays proportional to the memory that is released. */
+    arena->trim_at = arena->released+(arena->memory/2 > arena->chunk_size ?
+                                      arena->memory/2 : arena->chunk_size);
+}
+
+void mt_arena_free(MTArena *arena) {
+    size_t i;
+
+    for(i=0;i<arena->chunk_num;i++){
+        free(arena->chunks[i].data);
+    }
+
+    free(arena->chunks);
+
+    mt_arena_init(arena, arena->chunk_size);
+}
@@ -0,0 +1,104 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MT_ARENA_H
+#define MT_ARENA_H
+
+#include <stddef.h>
+
+/* A slab allocator: memory is taken from big chunks with a bump pointer and
+ * released blocks are kept in free lists, one per power of two size class.
+ * mt_arena_trim gives the chunks that only contain released blocks back to
+ * the system, everything is freed at once by mt_arena_free. */
+
+#define MT_ARENA_CLASSES (sizeof(size_t)*8)
+
+/* The smallest block size is 1<<MT_ARENA_MIN_SHIFT bytes. */
+#define MT_ARENA_MIN_SHIFT 4
+
+#define MT_ARENA_MIN_CHUNK 4096
+
+#define MT_ARENA_NONE ((size_t)-1)
+
+typedef struct {
+    unsigned char *data;
+
+    /* The bytes given out from the chunk with the bump pointer. */
+    size_t used;
+    /* The bytes of the released blocks of the chunk, only valid while the
+     * arena is trimmed. */
+    size_t released;
+} MTArenaChunk;
+
+typedef struct {
+    MTArenaChunk *chunks;
+    size_t chunk_num;
+    size_t chunk_size;
+
+    /* The chunk the bump pointer is in, MT_ARENA_NONE if there is none. */
+    size_t current;
+    unsigned char *cur;
+    size_t left;
+
+    void *free_lists[MT_ARENA_CLASSES];
+
+    /* The bytes of all the chunks. */
+    size_t memory;
+    /* The bytes of the blocks in the free lists, mt_arena_trim only looks for
+     * empty chunks once it reaches trim_at. */
+    size_t released;
+    size_t trim_at;
+} MTArena;
+
+int mt_arena_init(MTArena *arena, size_t chunk_size);
+
+void *mt_arena_alloc(MTArena *arena, size_t size);
+
+/* Get the size of the block mt_arena_alloc uses for size bytes, i.e. the
+ * memory an allocation really takes. */
+size_t mt_arena_block_size(size_t size);
+
+/* Give a block back to the arena. size must be the size that was passed to
+ * mt_arena_alloc, or the size of its block. */
+void mt_arena_release(MTArena *arena, void *ptr, size_t size);
+
+/* Free the chunks in which all the blocks were released. Finding them takes
+ * time proportional to the number of released blocks, so it is only done
+ * when enough memory was released since the last time, and this can be
+ * called after each release. */
+void mt_arena_trim(MTArena *arena);
+
+void mt_arena_free(MTArena *arena);
+
+#endif
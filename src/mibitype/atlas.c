@@ -0,0 +1,606 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mibitype/atlas.h>
+#include <mibitype/errors.h>
+
+#include <string.h>
+
+/* A glyph of a page being compacted. */
+typedef struct {
+    int height;
+    size_t n;
+} MTAtlasMove;
+
+size_t _mt_atlas_hash(size_t id, int size, int subpixel) {
+    /* FNV-1a over the glyph id, the size and the subpixel offset. */
+    unsigned long int hash = 2166136261UL;
+
+    hash ^= id;
+    hash *= 16777619UL;
+    hash ^= size;
+    hash *= 16777619UL;
+    hash ^= subpixel;
+    hash *= 16777619UL;
+
+    /* This key is used for empty slots by the map. */
+    if((size_t)hash == MT_MAP_EMPTY) hash--;
+
+    return hash;
+}
+
+void _mt_atlas_page_reset(MTAtlas *atlas, MTAtlasPage *page) {
+    memset(page->data, 0, (size_t)atlas->page_size*atlas->page_size);
+
+    page->nodes[0].x = 0;
+    page->nodes[0].y = 0;
+    page->nodes[0].width = atlas->page_size;
+    page->node_num = 1;
+
+    page->used_area = 0;
+    page->live_area = 0;
+    page->dirty = 1;
+}
+
+int _mt_atlas_page_init(MTAtlas *atlas, MTAtlasPage *page) {
+    page->data = malloc((size_t)atlas->page_size*atlas->page_size);
+    /* Each node is at least one pixel wide, and a node is inserted before the
+     * nodes that are covered are removed. */
+    page->nodes = malloc((atlas->page_size+1)*sizeof(MTAtlasNode));
+    if(page->data == NULL || page->nodes == NULL){
+        free(page->data);
+        free(page->nodes);
+        return MT_E_OUT_OF_MEM;
+    }
+
+    page->last_use = atlas->time;
+    _mt_atlas_page_reset(atlas, page);
+
+    return MT_E_NONE;
+}
+
+/* Get the height at which a rectangle of width w can be put if its left side
+ * is at the start of the node i, or -1 if it doesn't fit. */
+int _mt_atlas_fit(MTAtlas *atlas, MTAtlasPage *page, size_t i, int w,
+                  int h) {
+    int x = page->nodes[i].x;
+    int y = 0;
+    int left = w;
+
+    if(x+w > atlas->page_size) return -1;
+
+    /* The rectangle rests on the highest node it covers. */
+    for(;left>0;i++){
+        if(page->nodes[i].y > y) y = page->nodes[i].y;
+        if(y+h > atlas->page_size) return -1;
+        left -= page->nodes[i].width;
+    }
+
+    return y;
+}
+
+/* Allocate a rectangle of w*h pixels in a page, using the position where its
+ * top is the lowest. Returns 1 if it doesn't fit. */
+int _mt_atlas_pack(MTAtlas *atlas, MTAtlasPage *page, int w, int h, int *x,
+                   int *y) {
+    size_t best = MT_ATLAS_NONE;
+    int best_y = 0;
+    int fit_y;
+
+    size_t i;
+    int shrink;
+
+    for(i=0;i<page->node_num;i++){
+        fit_y = _mt_atlas_fit(atlas, page, i, w, h);
+        if(fit_y < 0) continue;
+
+        if(best == MT_ATLAS_NONE || fit_y < best_y){
+            best = i;
+            best_y = fit_y;
+        }
+    }
+
+    if(best == MT_ATLAS_NONE) return 1;
+
+    *x = page->nodes[best].x;
+    *y = best_y;
+
+    /* Insert the top of the rectangle in the skyline, then remove what it
+     * covers from the following nodes. */
+    memmove(page->nodes+best+1, page->nodes+best,
+            (page->node_num-best)*sizeof(MTAtlasNode));
+    page->node_num++;
+    page->nodes[best].y = best_y+h;
+    page->nodes[best].width = w;
+
+    for(i=best+1;i<page->node_num;){
+        shrink = *x+w-page->nodes[i].x;
+        if(shrink <= 0) break;
+
+        if(shrink < page->nodes[i].width){
+            page->nodes[i].x += shrink;
+            page->nodes[i].width -= shrink;
+            break;
+        }
+
+        memmove(page->nodes+i, page->nodes+i+1,
+                (page->node_num-i-1)*sizeof(MTAtlasNode));
+        page->node_num--;
+    }
+
+    /* Merge the nodes at the same height. */
+    for(i=0;i+1<page->node_num;){
+        if(page->nodes[i].y == page->nodes[i+1].y){
+            page->nodes[i].width += page->nodes[i+1].width;
+            memmove(page->nodes+i+1, page->nodes+i+2,
+                    (page->node_num-i-2)*sizeof(MTAtlasNode));
+            page->node_num--;
+        }else{
+            i++;
+        }
+    }
+
+    page->used_area += (unsigned long int)w*h;
+    page->dirty = 1;
+
+    return 0;
+}
+
+unsigned long int _mt_atlas_area(MTAtlasGlyph *glyph) {
+    return (unsigned long int)(glyph->width+MT_ATLAS_PADDING)*
+           (glyph->height+MT_ATLAS_PADDING);
+}
+
+void _mt_atlas_set_uv(MTAtlas *atlas, MTAtlasGlyph *glyph) {
+    glyph->u0 = glyph->x/(float)atlas->page_size;
+    glyph->v0 = glyph->y/(float)atlas->page_size;
+    glyph->u1 = (glyph->x+glyph->width)/(float)atlas->page_size;
+    glyph->v1 = (glyph->y+glyph->height)/(float)atlas->page_size;
+}
+
+size_t _mt_atlas_new_entry(MTAtlas *atlas) {
+    MTAtlasEntry *entries;
+    size_t max;
+    size_t n;
+
+    if(atlas->free_entry == MT_ATLAS_NONE){
+        if(atlas->entry_num >= atlas->entry_max){
+            max = atlas->entry_max ? atlas->entry_max*2 : 64;
+            entries = realloc(atlas->entries, max*sizeof(MTAtlasEntry));
+            if(entries == NULL) return MT_ATLAS_NONE;
+
+            atlas->entries = entries;
+            atlas->entry_max = max;
+        }
+
+        n = atlas->entry_num++;
+        atlas->entries[n].hash = MT_MAP_EMPTY;
+        atlas->entries[n].next = MT_ATLAS_NONE;
+        atlas->free_entry = n;
+    }
+
+    n = atlas->free_entry;
+    atlas->free_entry = atlas->entries[n].next;
+
+    return n;
+}
+
+/* Put an entry back in the free list, without touching its page. */
+void _mt_atlas_free_entry(MTAtlas *atlas, size_t n) {
+    MTAtlasEntry *entry = atlas->entries+n;
+
+    if(entry->hash != MT_MAP_EMPTY) mt_map_remove(&atlas->map, entry->hash);
+    entry->hash = MT_MAP_EMPTY;
+
+    entry->next = atlas->free_entry;
+    atlas->free_entry = n;
+}
+
+void _mt_atlas_remove(MTAtlas *atlas, size_t n) {
+    MTAtlasGlyph *glyph = &atlas->entries[n].glyph;
+
+    if(glyph->page != MT_ATLAS_NONE){
+        atlas->pages[glyph->page].live_area -= _mt_atlas_area(glyph);
+    }
+
+    _mt_atlas_free_entry(atlas, n);
+}
+
+void _mt_atlas_evict(MTAtlas *atlas, size_t page) {
+    size_t n;
+
+    for(n=0;n<atlas->entry_num;n++){
+        if(atlas->entries[n].hash != MT_MAP_EMPTY &&
+           atlas->entries[n].glyph.page == page){
+            _mt_atlas_free_entry(atlas, n);
+        }
+    }
+
+    _mt_atlas_page_reset(atlas, atlas->pages+page);
+    atlas->stats.evictions++;
+}
+
+int _mt_atlas_compare(const void *a, const void *b) {
+    return ((const MTAtlasMove*)b)->height-((const MTAtlasMove*)a)->height;
+}
+
+/* Repack the glyphs of a page from the tallest to the shortest, which usually
+ * packs them better than the order in which they were added. The glyphs that
+ * don't fit anymore are removed. */
+int _mt_atlas_compact(MTAtlas *atlas, size_t page) {
+    MTAtlasPage *p = atlas->pages+page;
+    MTAtlasMove *moves;
+    MTAtlasGlyph *glyph;
+    unsigned char *old;
+
+    size_t move_num = 0;
+    size_t i, n;
+    int x, y;
+    int row;
+
+    for(n=0;n<atlas->entry_num;n++){
+        if(atlas->entries[n].hash != MT_MAP_EMPTY &&
+           atlas->entries[n].glyph.page == page) move_num++;
+    }
+
+    moves = malloc((move_num ? move_num : 1)*sizeof(MTAtlasMove));
+    old = malloc((size_t)atlas->page_size*atlas->page_size);
+    if(moves == NULL || old == NULL){
+        free(moves);
+        free(old);
+        return MT_E_OUT_OF_MEM;
+    }
+
+    for(n=0,i=0;n<atlas->entry_num;n++){
+        if(atlas->entries[n].hash != MT_MAP_EMPTY &&
+           atlas->entries[n].glyph.page == page){
+            moves[i].height = atlas->entries[n].glyph.height;
+            moves[i].n = n;
+            i++;
+        }
+    }
+
+    qsort(moves, move_num, sizeof(MTAtlasMove), _mt_atlas_compare);
+
+    memcpy(old, p->data, (size_t)atlas->page_size*atlas->page_size);
+    _mt_atlas_page_reset(atlas, p);
+
+    for(i=0;i<move_num;i++){
+        glyph = &atlas->entries[moves[i].n].glyph;
+
+        if(_mt_atlas_pack(atlas, p, glyph->width+MT_ATLAS_PADDING,
+                          glyph->height+MT_ATLAS_PADDING, &x, &y)){
+            _mt_atlas_free_entry(atlas, moves[i].n);
+            continue;
+        }
+
+        for(row=0;row<glyph->height;row++){
+            memcpy(p->data+(size_t)(y+row)*atlas->page_size+x,
+                   old+(size_t)(glyph->y+row)*atlas->page_size+glyph->x,
+                   glyph->width);
+        }
+
+        glyph->x = x;
+        glyph->y = y;
+        _mt_atlas_set_uv(atlas, glyph);
+        p->live_area += _mt_atlas_area(glyph);
+    }
+
+    free(moves);
+    free(old);
+
+    atlas->stats.compactions++;
+
+    return MT_E_NONE;
+}
+
+/* Find space for a rectangle of w*h pixels, making some if needed. */
+int _mt_atlas_place(MTAtlas *atlas, int w, int h, size_t *page, int *x,
+                    int *y) {
+    size_t i;
+    size_t best;
+    unsigned long int waste, best_waste;
+
+    int rc;
+
+    for(i=0;i<atlas->page_num;i++){
+        if(!_mt_atlas_pack(atlas, atlas->pages+i, w, h, x, y)){
+            *page = i;
+            return MT_E_NONE;
+        }
+    }
+
+    if(atlas->page_num < atlas->page_max){
+        i = atlas->page_num;
+        if((rc = _mt_atlas_page_init(atlas, atlas->pages+i))) return rc;
+        atlas->page_num++;
+    }else{
+        /* Compact the page where the most space is used by removed glyphs,
+         * if it may be enough. */
+        best = 0;
+        best_waste = 0;
+        for(i=0;i<atlas->page_num;i++){
+            waste = atlas->pages[i].used_area-atlas->pages[i].live_area;
+            if(waste > best_waste){
+                best = i;
+                best_waste = waste;
+            }
+        }
+
+        if(best_waste >= (unsigned long int)w*h){
+            if((rc = _mt_atlas_compact(atlas, best))) return rc;
+            if(!_mt_atlas_pack(atlas, atlas->pages+best, w, h, x, y)){
+                *page = best;
+                return MT_E_NONE;
+            }
+        }
+
+        /* Otherwise clear the least recently used page. */
+        i = 0;
+        for(best=1;best<atlas->page_num;best++){
+            if(atlas->pages[best].last_use < atlas->pages[i].last_use){
+                i = best;
+            }
+        }
+        _mt_atlas_evict(atlas, i);
+    }
+
+    /* The page is empty, and the rectangle is smaller than a page. */
+    _mt_atlas_pack(atlas, atlas->pages+i, w, h, x, y);
+    *page = i;
+
+    return MT_E_NONE;
+}
+
+int mt_atlas_init(MTAtlas *atlas, MTFont *font, int page_size,
+                  size_t page_max, int phases) {
+    int i;
+
+    int rc;
+
+    atlas->font = font;
+    atlas->page_size = page_size;
+    atlas->phases = phases;
+
+    atlas->pages = NULL;
+    atlas->page_num = 0;
+    atlas->page_max = page_max;
+
+    atlas->entries = NULL;
+    atlas->entry_num = 0;
+    atlas->entry_max = 0;
+    atlas->free_entry = MT_ATLAS_NONE;
+
+    atlas->time = 0;
+
+    atlas->stats.hits = 0;
+    atlas->stats.misses = 0;
+    atlas->stats.evictions = 0;
+    atlas->stats.compactions = 0;
+    for(i=0;i<MT_ATLAS_PHASE_MAX;i++){
+        atlas->stats.phase_hits[i] = 0;
+        atlas->stats.phase_misses[i] = 0;
+    }
+
+    if(page_size <= 0 || !page_max || phases < 1 ||
+       phases > MT_ATLAS_PHASE_MAX){
+        return MT_E_IMPLEMENTATION;
+    }
+
+    atlas->pages = malloc(page_max*sizeof(MTAtlasPage));
+    if(atlas->pages == NULL) return MT_E_OUT_OF_MEM;
+
+    if((rc = mt_map_init(&atlas->map))){
+        free(atlas->pages);
+        atlas->pages = NULL;
+        return rc;
+    }
+
+    mt_rasterizer_init(&atlas->rasterizer);
+
+    return MT_E_NONE;
+}
+
+/* Set hit to 1 if the glyph was already in the atlas. */
+MTAtlasGlyph *_mt_atlas_get(MTAtlas *atlas, size_t id, int size,
+                            int subpixel, int *hit) {
+    MTAtlasEntry *entry;
+    MTAtlasGlyph *glyph;
+    MTAtlasPage *page;
+    MTGlyph *outline;
+    MTBitmap bitmap;
+
+    size_t hash;
+    size_t *slot;
+    size_t n;
+
+    atlas->time++;
+    *hit = 0;
+
+    hash = _mt_atlas_hash(id, size, subpixel);
+
+    slot = mt_map_get(&atlas->map, hash);
+    if(slot != NULL){
+        entry = atlas->entries+*slot;
+
+        if(entry->id == id && entry->size == size &&
+           entry->subpixel == subpixel){
+            atlas->stats.hits++;
+            *hit = 1;
+
+            if(entry->glyph.page != MT_ATLAS_NONE){
+                atlas->pages[entry->glyph.page].last_use = atlas->time;
+            }
+
+            return &entry->glyph;
+        }
+
+        /* Another glyph has the same hash, replace it. */
+        _mt_atlas_remove(atlas, *slot);
+    }
+
+    atlas->stats.misses++;
+
+    outline = mt_font_get_glyph_by_id(atlas->font, id);
+    if(outline == NULL) return NULL;
+
+    mt_render_get_box(atlas->font, outline, size, subpixel, &bitmap);
+    if(bitmap.width+MT_ATLAS_PADDING > atlas->page_size ||
+       bitmap.height+MT_ATLAS_PADDING > atlas->page_size){
+        return NULL;
+    }
+
+    n = _mt_atlas_new_entry(atlas);
+    if(n == MT_ATLAS_NONE) return NULL;
+
+    entry = atlas->entries+n;
+    glyph = &entry->glyph;
+
+    glyph->page = MT_ATLAS_NONE;
+    glyph->x = 0;
+    glyph->y = 0;
+    glyph->width = bitmap.width;
+    glyph->height = bitmap.height;
+    glyph->left = bitmap.left;
+    glyph->top = bitmap.top;
+
+    if(bitmap.width > 0 && bitmap.height > 0){
+        if(_mt_atlas_place(atlas, bitmap.width+MT_ATLAS_PADDING,
+                           bitmap.height+MT_ATLAS_PADDING, &glyph->page,
+                           &glyph->x, &glyph->y)){
+            _mt_atlas_free_entry(atlas, n);
+            return NULL;
+        }
+
+        page = atlas->pages+glyph->page;
+
+        /* Render directly into the page. */
+        bitmap.data = page->data+(size_t)glyph->y*atlas->page_size+glyph->x;
+        bitmap.pitch = atlas->page_size;
+        if(mt_render_glyph(&atlas->rasterizer, atlas->font, outline, size,
+                           subpixel, &bitmap)){
+            /* The space stays unused until the page is compacted. */
+            _mt_atlas_free_entry(atlas, n);
+            return NULL;
+        }
+
+        page->live_area += _mt_atlas_area(glyph);
+        page->last_use = atlas->time;
+    }
+
+    if(mt_map_set(&atlas->map, hash, n)){
+        _mt_atlas_remove(atlas, n);
+        return NULL;
+    }
+
+    _mt_atlas_set_uv(atlas, glyph);
+    entry->id = id;
+    entry->size = size;
+    entry->subpixel = subpixel;
+    entry->hash = hash;
+
+    return glyph;
+}
+
+MTAtlasGlyph *mt_atlas_get(MTAtlas *atlas, size_t id, int size,
+                           int subpixel) {
+    int hit;
+
+    return _mt_atlas_get(atlas, id, size, subpixel, &hit);
+}
+
+MTAtlasGlyph *mt_atlas_get_phase(MTAtlas *atlas, size_t id, int size,
+                                 int phase) {
+    MTAtlasGlyph *glyph;
+    int hit;
+
+    if(phase < 0 || phase >= atlas->phases) phase = 0;
+
+    glyph = _mt_atlas_get(atlas, id, size,
+                          phase*MT_RENDER_ONE/atlas->phases, &hit);
+
+    if(hit) atlas->stats.phase_hits[phase]++;
+    else atlas->stats.phase_misses[phase]++;
+
+    return glyph;
+}
+
+void mt_atlas_remove(MTAtlas *atlas, size_t id, int size, int subpixel) {
+    MTAtlasEntry *entry;
+    size_t *slot;
+
+    slot = mt_map_get(&atlas->map, _mt_atlas_hash(id, size, subpixel));
+    if(slot == NULL) return;
+
+    entry = atlas->entries+*slot;
+    if(entry->id == id && entry->size == size &&
+       entry->subpixel == subpixel){
+        _mt_atlas_remove(atlas, *slot);
+    }
+}
+
+void mt_atlas_clear(MTAtlas *atlas) {
+    size_t i;
+
+    mt_map_clear(&atlas->map);
+
+    atlas->entry_num = 0;
+    atlas->free_entry = MT_ATLAS_NONE;
+
+    for(i=0;i<atlas->page_num;i++){
+        _mt_atlas_page_reset(atlas, atlas->pages+i);
+    }
+}
+
+void mt_atlas_free(MTAtlas *atlas) {
+    size_t i;
+
+    for(i=0;i<atlas->page_num;i++){
+        free(atlas->pages[i].data);
+        free(atlas->pages[i].nodes);
+    }
+
+    free(atlas->pages);
+    atlas->pages = NULL;
+    atlas->page_num = 0;
+
+    free(atlas->entries);
+    atlas->entries = NULL;
+    atlas->entry_num = 0;
+    atlas->entry_max = 0;
+    atlas->free_entry = MT_ATLAS_NONE;
+
+    mt_map_free(&atlas->map);
+    mt_rasterizer_free(&atlas->rasterizer);
+}
@@ -0,0 +1,185 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MT_ATLAS_H
+#define MT_ATLAS_H
+
+#include <mibitype/font.h>
+#include <mibitype/map.h>
+#include <mibitype/render.h>
+
+#define MT_ATLAS_NONE ((size_t)-1)
+
+/* The space left between the glyphs of a page, so that they don't bleed into
+ * each other when the page is sampled with filtering. */
+#define MT_ATLAS_PADDING 1
+
+/* The maximum number of horizontal subpixel phases. */
+#define MT_ATLAS_PHASE_MAX 16
+
+/* A glyph stored in the atlas. Glyphs without outline have an empty rectangle
+ * and their page is MT_ATLAS_NONE. */
+typedef struct {
+    size_t page;
+    /* The rectangle of the bitmap in the page in pixels. */
+    int x, y;
+    int width, height;
+
+    /* The position of the top left corner of the bitmap relative to the origin
+     * of the glyph, with Y going up, like in MTBitmap. */
+    int left, top;
+
+    /* The rectangle of the bitmap in texture coordinates. */
+    float u0, v0;
+    float u1, v1;
+} MTAtlasGlyph;
+
+typedef struct {
+    /* Must stay the first member, the glyph pointers we return are cast back
+     * to entries. */
+    MTAtlasGlyph glyph;
+
+    size_t id;
+    int size;
+    int subpixel;
+    /* MT_MAP_EMPTY if the entry is free. */
+    size_t hash;
+
+    /* Links the free entries together. */
+    size_t next;
+} MTAtlasEntry;
+
+/* A segment of the skyline of a page: the space below y between x and
+ * x+width is used. */
+typedef struct {
+    int x, y;
+    int width;
+} MTAtlasNode;
+
+typedef struct {
+    /* page_size*page_size alpha values. */
+    unsigned char *data;
+
+    /* The skyline, sorted from left to right. */
+    MTAtlasNode *nodes;
+    size_t node_num;
+
+    /* The area of the rectangles allocated since the page was last cleared,
+     * and the area of the glyphs that still use them, padding included. */
+    unsigned long int used_area;
+    unsigned long int live_area;
+
+    /* The last time a glyph of the page was used. */
+    unsigned long int last_use;
+
+    /* Set every time the page is modified. It is never cleared by the atlas,
+     * so that a renderer can clear it once it uploaded the page. */
+    int dirty;
+} MTAtlasPage;
+
+typedef struct {
+    unsigned long int hits;
+    unsigned long int misses;
+    /* Pages that were cleared to make space. */
+    unsigned long int evictions;
+    /* Pages that were repacked to reclaim the space of removed glyphs. */
+    unsigned long int compactions;
+
+    /* The lookups done with mt_atlas_get_phase, for each phase. */
+    unsigned long int phase_hits[MT_ATLAS_PHASE_MAX];
+    unsigned long int phase_misses[MT_ATLAS_PHASE_MAX];
+} MTAtlasStats;
+
+/* Rasterized glyph bitmaps packed into square pages with a skyline packer.
+ * The glyphs are keyed by glyph id, size in pixels per em and subpixel offset
+ * and are found with a hash of the key. When all the pages are full, the page
+ * with the most space wasted by removed glyphs is compacted if it is enough,
+ * otherwise the least recently used page is cleared. */
+typedef struct {
+    MTFont *font;
+
+    int page_size;
+
+    /* The number of subpixel phases used by mt_atlas_get_phase. */
+    int phases;
+
+    MTAtlasPage *pages;
+    size_t page_num;
+    size_t page_max;
+
+    MTAtlasEntry *entries;
+    size_t entry_num;
+    size_t entry_max;
+    size_t free_entry;
+
+    /* Maps the hashes of the keys to entries. */
+    MTMap map;
+
+    MTRasterizer rasterizer;
+
+    /* Incremented on each lookup, to find the least recently used page. */
+    unsigned long int time;
+
+    MTAtlasStats stats;
+} MTAtlas;
+
+/* Initialize an atlas for the glyphs of font, that can use up to page_max
+ * pages of page_size*page_size pixels. Each glyph can be stored with phases
+ * different horizontal subpixel offsets, up to MT_ATLAS_PHASE_MAX. */
+int mt_atlas_init(MTAtlas *atlas, MTFont *font, int page_size,
+                  size_t page_max, int phases);
+
+/* Get a glyph rendered with size pixels per em and its origin moved right by
+ * subpixel/MT_RENDER_ONE pixels, rasterizing it if it isn't in the atlas. The
+ * glyph, and the position of the other glyphs, stay valid until the next call
+ * that modifies the atlas. Returns NULL if the glyph could not be rasterized
+ * or is bigger than a page. */
+MTAtlasGlyph *mt_atlas_get(MTAtlas *atlas, size_t id, int size,
+                           int subpixel);
+
+/* Get a glyph with its origin moved right by phase/phases pixels, for example
+ * at a phase given by mt_run_layout. The phases count separately in the
+ * stats. */
+MTAtlasGlyph *mt_atlas_get_phase(MTAtlas *atlas, size_t id, int size,
+                                 int phase);
+
+/* Remove a glyph from the atlas. Its space is reclaimed when its page is
+ * compacted. */
+void mt_atlas_remove(MTAtlas *atlas, size_t id, int size, int subpixel);
+
+void mt_atlas_clear(MTAtlas *atlas);
+
+void mt_atlas_free(MTAtlas *atlas);
+
+#endif
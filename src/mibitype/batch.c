@@ -0,0 +1,332 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* pthreads are not part of ANSI C. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <mibitype/batch.h>
+#include <mibitype/errors.h>
+
+#if MT_THREADS
+#define MT_BATCH_LOCK(mutex) pthread_mutex_lock(mutex)
+#define MT_BATCH_UNLOCK(mutex) pthread_mutex_unlock(mutex)
+#else
+#define MT_BATCH_LOCK(mutex)
+#define MT_BATCH_UNLOCK(mutex)
+#endif
+
+void _mt_batch_render_slot(MTBatch *batch, MTBatchWorker *worker, size_t n) {
+    MTBatchSlot *slot = batch->slots+n;
+    MTGlyph *glyph = batch->glyphs[n];
+
+    mt_render_get_box(batch->font, glyph, batch->size, 0, &slot->bitmap);
+
+    slot->rc = MT_E_NONE;
+    if(slot->bitmap.data == NULL){
+        slot->rc = mt_bitmap_alloc(&slot->bitmap);
+    }else if((size_t)slot->bitmap.pitch*slot->bitmap.height > slot->size){
+        slot->rc = MT_E_OUT_OF_MEM;
+    }
+
+    if(!slot->rc){
+        slot->rc = mt_render_glyph(&worker->rasterizer, batch->font, glyph,
+                                   batch->size, 0, &slot->bitmap);
+    }
+}
+
+/* Get the next glyph a worker should render, or MT_BATCH_NONE if all the
+ * glyphs are taken. */
+size_t _mt_batch_next(MTBatch *batch, MTBatchWorker *worker) {
+    MTBatchWorker *victim;
+
+    size_t n;
+    size_t i;
+    size_t take;
+
+    if(worker->next < worker->last) return worker->next++;
+
+    MT_BATCH_LOCK(&worker->lock);
+    if(worker->begin < worker->end){
+        take = worker->end-worker->begin;
+        if(take > MT_BATCH_CHUNK) take = MT_BATCH_CHUNK;
+        worker->next = worker->begin;
+        worker->begin += take;
+        worker->last = worker->begin;
+        MT_BATCH_UNLOCK(&worker->lock);
+        return worker->next++;
+    }
+    MT_BATCH_UNLOCK(&worker->lock);
+
+    /* Steal half of the glyphs left to another worker, from the end of its
+     * range as it takes them from the start. Only one lock is held at a
+     * time. */
+    for(i=1;i<batch->active;i++){
+        victim = batch->workers+(worker->n+i)%batch->active;
+
+        MT_BATCH_LOCK(&victim->lock);
+        if(victim->begin >= victim->end){
+            MT_BATCH_UNLOCK(&victim->lock);
+            continue;
+        }
+        take = (victim->end-victim->begin+1)/2;
+        victim->end -= take;
+        n = victim->end;
+        MT_BATCH_UNLOCK(&victim->lock);
+
+        MT_BATCH_LOCK(&worker->lock);
+        worker->begin = n+1;
+        worker->end = n+take;
+        MT_BATCH_UNLOCK(&worker->lock);
+
+        worker->steals++;
+
+        return n;
+    }
+
+    return MT_BATCH_NONE;
+}
+
+void _mt_batch_work(MTBatch *batch, MTBatchWorker *worker) {
+    size_t n;
+
+    while((n = _mt_batch_next(batch, worker)) != MT_BATCH_NONE){
+        _mt_batch_render_slot(batch, worker, n);
+    }
+}
+
+#if MT_THREADS
+void *_mt_batch_thread(void *data) {
+    MTBatchWorker *worker = data;
+    MTBatch *batch = worker->batch;
+
+    unsigned long int job = 0;
+
+    pthread_mutex_lock(&batch->lock);
+    while(1){
+        while(batch->job == job && !batch->quit){
+            pthread_cond_wait(&batch->start, &batch->lock);
+        }
+        if(batch->quit) break;
+        job = batch->job;
+        if(worker->n >= batch->active) continue;
+        pthread_mutex_unlock(&batch->lock);
+
+        _mt_batch_work(batch, worker);
+
+        pthread_mutex_lock(&batch->lock);
+        batch->running--;
+        if(!batch->running) pthread_cond_signal(&batch->done);
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    return NULL;
+}
+#endif
+
+int mt_batch_init(MTBatch *batch, size_t worker_num) {
+    size_t i;
+
+#if !MT_THREADS
+    worker_num = 1;
+#endif
+    if(!worker_num) worker_num = 1;
+
+    batch->active = 0;
+    batch->font = NULL;
+    batch->ids = NULL;
+    batch->size = 0;
+    batch->slots = NULL;
+
+    batch->glyphs = NULL;
+    batch->glyph_max = 0;
+
+    batch->workers = malloc(worker_num*sizeof(MTBatchWorker));
+    if(batch->workers == NULL) return MT_E_OUT_OF_MEM;
+
+#if MT_THREADS
+    batch->threads = malloc(worker_num*sizeof(pthread_t));
+    if(batch->threads == NULL){
+        free(batch->workers);
+        batch->workers = NULL;
+        return MT_E_OUT_OF_MEM;
+    }
+
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->start, NULL);
+    pthread_cond_init(&batch->done, NULL);
+    batch->job = 0;
+    batch->running = 0;
+    batch->quit = 0;
+#endif
+
+    for(i=0;i<worker_num;i++){
+        batch->workers[i].batch = batch;
+        batch->workers[i].n = i;
+        mt_rasterizer_init(&batch->workers[i].rasterizer);
+        batch->workers[i].begin = 0;
+        batch->workers[i].end = 0;
+        batch->workers[i].next = 0;
+        batch->workers[i].last = 0;
+        batch->workers[i].steals = 0;
+#if MT_THREADS
+        pthread_mutex_init(&batch->workers[i].lock, NULL);
+#endif
+    }
+
+    /* The first worker runs on the calling thread. */
+    batch->worker_num = 1;
+#if MT_THREADS
+    for(;batch->worker_num<worker_num;batch->worker_num++){
+        if(pthread_create(batch->threads+batch->worker_num, NULL,
+                          _mt_batch_thread,
+                          batch->workers+batch->worker_num)){
+            break;
+        }
+    }
+
+    /* If some threads could not be started, work with the others. */
+    for(i=batch->worker_num;i<worker_num;i++){
+        mt_rasterizer_free(&batch->workers[i].rasterizer);
+        pthread_mutex_destroy(&batch->workers[i].lock);
+    }
+#endif
+
+    return MT_E_NONE;
+}
+
+int mt_batch_render(MTBatch *batch, MTFont *font, const size_t *ids,
+                    size_t num, int size, MTBatchSlot *slots) {
+    void *new;
+
+    size_t i;
+    size_t active;
+
+    if(!num) return MT_E_NONE;
+
+    if(num > batch->glyph_max){
+        new = realloc(batch->glyphs, num*sizeof(MTGlyph*));
+        if(new == NULL) return MT_E_OUT_OF_MEM;
+        batch->glyphs = new;
+        batch->glyph_max = num;
+    }
+
+    batch->font = font;
+    batch->ids = ids;
+    batch->size = size;
+    batch->slots = slots;
+
+    /* Pin the glyphs so that loading the next ones doesn't evict them. */
+    for(i=0;i<num;i++){
+        batch->glyphs[i] = mt_font_get_glyph_by_id(font, ids[i]);
+        mt_font_pin_glyph(font, batch->glyphs[i]);
+    }
+
+    active = num/MT_BATCH_MIN_GLYPHS;
+    if(active > batch->worker_num) active = batch->worker_num;
+    if(!active) active = 1;
+
+    /* Split the glyphs evenly, the workers steal them from each other if they
+     * are not equally fast to render. */
+    for(i=0;i<active;i++){
+        batch->workers[i].begin = num*i/active;
+        batch->workers[i].end = num*(i+1)/active;
+        batch->workers[i].next = 0;
+        batch->workers[i].last = 0;
+    }
+
+#if MT_THREADS
+    /* The threads of the inactive workers may still be reading it. */
+    pthread_mutex_lock(&batch->lock);
+    batch->active = active;
+    if(active > 1){
+        batch->running = active-1;
+        batch->job++;
+        pthread_cond_broadcast(&batch->start);
+    }
+    pthread_mutex_unlock(&batch->lock);
+#else
+    batch->active = active;
+#endif
+
+    _mt_batch_work(batch, batch->workers);
+
+#if MT_THREADS
+    if(active > 1){
+        pthread_mutex_lock(&batch->lock);
+        while(batch->running){
+            pthread_cond_wait(&batch->done, &batch->lock);
+        }
+        pthread_mutex_unlock(&batch->lock);
+    }
+#endif
+
+    for(i=0;i<num;i++) mt_font_unpin_glyph(font, batch->glyphs[i]);
+
+    return MT_E_NONE;
+}
+
+void mt_batch_free(MTBatch *batch) {
+    size_t i;
+
+#if MT_THREADS
+    pthread_mutex_lock(&batch->lock);
+    batch->quit = 1;
+    pthread_cond_broadcast(&batch->start);
+    pthread_mutex_unlock(&batch->lock);
+
+    for(i=1;i<batch->worker_num;i++) pthread_join(batch->threads[i], NULL);
+
+    free(batch->threads);
+    batch->threads = NULL;
+
+    pthread_mutex_destroy(&batch->lock);
+    pthread_cond_destroy(&batch->start);
+    pthread_cond_destroy(&batch->done);
+#endif
+
+    for(i=0;i<batch->worker_num;i++){
+        mt_rasterizer_free(&batch->workers[i].rasterizer);
+#if MT_THREADS
+        pthread_mutex_destroy(&batch->workers[i].lock);
+#endif
+    }
+
+    free(batch->workers);
+    batch->workers = NULL;
+    batch->worker_num = 0;
+
+    free(batch->glyphs);
+    batch->glyphs = NULL;
+    batch->glyph_max = 0;
+}
@@ -0,0 +1,139 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MT_BATCH_H
+#define MT_BATCH_H
+
+#include <mibitype/defs.h>
+#include <mibitype/font.h>
+#include <mibitype/render.h>
+
+#if MT_THREADS
+#include <pthread.h>
+#endif
+
+#define MT_BATCH_NONE ((size_t)-1)
+
+/* Each worker that is woken up gets at least this many glyphs, so batches
+ * smaller than twice this are rendered on the calling thread alone: waking
+ * the threads up and waiting for them costs more than it saves. */
+#define MT_BATCH_MIN_GLYPHS 16
+
+/* The glyphs a worker takes from its range at a time, to lock it less
+ * often. */
+#define MT_BATCH_CHUNK 4
+
+/* Where a glyph of a batch is rendered. If bitmap.data is NULL it is
+ * allocated with mt_bitmap_alloc, otherwise it must point to size bytes. */
+typedef struct {
+    MTBitmap bitmap;
+    size_t size;
+
+    /* The error code of the glyph. */
+    int rc;
+} MTBatchSlot;
+
+typedef struct MTBatch MTBatch;
+
+/* Each worker owns a range of the glyphs of the batch, takes them from the
+ * front and steals the back half of the range of another worker when it has
+ * nothing left to do. */
+typedef struct {
+    MTBatch *batch;
+    size_t n;
+
+    MTRasterizer rasterizer;
+
+    size_t begin, end;
+#if MT_THREADS
+    pthread_mutex_t lock;
+#endif
+
+    /* The glyphs taken from the range, that only this worker sees so they
+     * are rendered without locking. */
+    size_t next, last;
+
+    /* The number of times the worker stole glyphs from another one. */
+    unsigned long int steals;
+} MTBatchWorker;
+
+/* A pool of workers that rasterize glyphs. The thread that calls
+ * mt_batch_render is the first worker, the others have their own thread. */
+struct MTBatch {
+    MTBatchWorker *workers;
+    size_t worker_num;
+
+    /* The current batch. */
+    size_t active;
+    MTFont *font;
+    const size_t *ids;
+    int size;
+    MTBatchSlot *slots;
+
+    /* The font is not thread safe: the glyphs of the batch are loaded and
+     * pinned before the workers start and unpinned once they are all done,
+     * so that the workers only rasterize them. */
+    MTGlyph **glyphs;
+    size_t glyph_max;
+
+#if MT_THREADS
+    pthread_t *threads;
+
+    /* Protects job, running and quit. job is incremented to start the
+     * threads, that decrement running when they are done. Only the threads
+     * of the first active workers render the batch. */
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long int job;
+    size_t running;
+    int quit;
+#endif
+};
+
+/* Start a pool of worker_num workers. Without MT_THREADS there is always a
+ * single worker. */
+int mt_batch_init(MTBatch *batch, size_t worker_num);
+
+/* Rasterize the glyphs ids[0] to ids[num-1] with size pixels per em into
+ * slots[0] to slots[num-1]. The error code of each glyph is in its slot. The
+ * glyphs stay pinned in the font cache until the batch is done, and the font
+ * must not be used by other threads until then. */
+int mt_batch_render(MTBatch *batch, MTFont *font, const size_t *ids,
+                    size_t num, int size, MTBatchSlot *slots);
+
+/* Stop the threads of the pool. */
+void mt_batch_free(MTBatch *batch);
+
+#endif
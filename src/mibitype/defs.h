@@ -37,6 +37,47 @@
 
 #define MT_DEBUG 0
 
+/* Set to 1 to allow using mmap to load font files (requires POSIX). */
+#ifndef MT_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#define MT_MMAP 1
+#else
+#define MT_MMAP 0
+#endif
+#endif
+
+/* Set to 1 to rasterize batches of glyphs on multiple threads (requires
+ * POSIX threads). */
+#ifndef MT_THREADS
+#if defined(__unix__) || defined(__APPLE__)
+#define MT_THREADS 1
+#else
+#define MT_THREADS 0
+#endif
+#endif
+
+/* Set to 1 to select SIMD kernels for the rasterizer at runtime (requires GCC
+ * or Clang on x86). */
+#ifndef MT_RENDER_SIMD
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MT_RENDER_SIMD 1
+#else
+#define MT_RENDER_SIMD 0
+#endif
+#endif
+
+/* Set to 1 to select SIMD kernels for the UTF-8 decoder at runtime (requires
+ * GCC or Clang on x86). */
+#ifndef MT_UTF8_SIMD
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MT_UTF8_SIMD 1
+#else
+#define MT_UTF8_SIMD 0
+#endif
+#endif
+
 #include <stdlib.h>
 
 #if MT_DEBUG
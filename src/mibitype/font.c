@@ -36,21 +36,57 @@
 #include <mibitype/errors.h>
 
 #include <mibitype/loaderlist.h>
+#include <mibitype/utf8.h>
 
 #include <string.h>
 
 int mt_font_init(MTFont *font, MTReader *reader, int dpi) {
+    return mt_font_init_flags(font, reader, dpi, 0);
+}
+
+int mt_font_init_flags(MTFont *font, MTReader *reader, int dpi, int flags) {
     size_t i;
     int found = 0;
 
     int rc;
 
+    font->flags = flags;
+
     font->dpi = dpi;
+    font->units_per_em = 0;
 
     font->reader = reader;
 
     font->data = NULL;
 
+    font->glyph_blocks = NULL;
+    font->glyph_num = 0;
+    mt_map_init(&font->glyph_map);
+    mt_map_init(&font->char_map);
+
+    font->lru_first = MT_FONT_NONE;
+    font->lru_last = MT_FONT_NONE;
+    font->free_entry = MT_FONT_NONE;
+
+    font->budget = 0;
+
+    font->glyph_memory_max = 0;
+    mt_arena_init(&font->arena, 0);
+
+    font->stats.hits = 0;
+    font->stats.misses = 0;
+    font->stats.aliased = 0;
+    font->stats.evictions = 0;
+    font->stats.memory = 0;
+
+    font->glyph_table = NULL;
+    font->glyph_table_size = 0;
+
+    font->metrics = NULL;
+    font->metrics_num = 0;
+
+    mt_glyph_init(&font->missing);
+
     MT_READER_JMP(reader, 0);
 
     /* Find what kind of file it is */
@@ -73,6 +109,18 @@ int mt_font_init(MTFont *font, MTReader *reader, int dpi) {
         return rc;
     }
 
+    if(!font->metrics_num) return MT_E_CORRUPTED;
+
+    if(flags&MT_FONT_METRICS_ONLY){
+        /* The missing glyph is kept without an outline. */
+        font->missing.advance_width = font->metrics[0].advance_width;
+        font->missing.left_side_bearing = font->metrics[0].left_side_bearing;
+
+        return MT_E_NONE;
+    }
+
+    mt_arena_init(&font->arena, font->glyph_memory_max*MT_FONT_ARENA_GLYPHS);
+
     if((rc = MT_LOADERLIST_GET(font->loader, load_missing)(font->data, font,
                                                            &font->missing))){
         return rc;
@@ -82,118 +130,450 @@ int mt_font_init(MTFont *font, MTReader *reader, int dpi) {
 }
 
 size_t mt_font_get_glyph_id(MTFont *font, size_t c) {
+    unsigned short int *page;
+
+    if(font->glyph_table != NULL && c < MT_FONT_PAGE_NUM*MT_FONT_PAGE_SIZE){
+        page = font->glyph_table[c/MT_FONT_PAGE_SIZE];
+
+        return page != NULL ? page[c%MT_FONT_PAGE_SIZE] : 0;
+    }
+
     return MT_LOADERLIST_GET(font->loader, get_glyph_id)(font->data, font, c);
 }
 
-MTGlyph *mt_font_search_glyph(MTFont *font, size_t c) {
-    /* Some interpolation search */
-    size_t first, last;
-    size_t selected;
+int mt_font_build_glyph_table(MTFont *font) {
+    unsigned short int ids[MT_FONT_PAGE_SIZE];
+    unsigned short int **table;
 
-    if(!font->glyph_num) return NULL;
+    size_t i, n;
+    size_t id;
 
-    first = 0;
-    last = font->glyph_num-1;
+    int populated;
 
-    if(c == font->glyphs->c){
-        return font->glyphs;
-    }else if(c == font->glyphs[last].c){
-        return font->glyphs+last;
-    }else if(c < font->glyphs->c){
-        font->expected_glyph_pos = 0;
-        return NULL;
-    }else if(c > font->glyphs[last].c){
-        font->expected_glyph_pos = last+1;
-        return NULL;
+    mt_font_free_glyph_table(font);
+
+    table = malloc(MT_FONT_PAGE_NUM*sizeof(unsigned short int*));
+    if(table == NULL) return MT_E_OUT_OF_MEM;
+
+    font->glyph_table_size = MT_FONT_PAGE_NUM*sizeof(unsigned short int*);
+
+    for(i=0;i<MT_FONT_PAGE_NUM;i++){
+        populated = 0;
+
+        for(n=0;n<MT_FONT_PAGE_SIZE;n++){
+            id = MT_LOADERLIST_GET(font->loader, get_glyph_id)(font->data,
+                                   font, i*MT_FONT_PAGE_SIZE+n);
+            /* Glyph ids that don't fit can't be valid TrueType glyph ids. */
+            ids[n] = id > 0xFFFF ? 0 : id;
+            populated |= ids[n];
+        }
+
+        if(!populated){
+            table[i] = NULL;
+            continue;
+        }
+
+        table[i] = malloc(MT_FONT_PAGE_SIZE*sizeof(unsigned short int));
+        if(table[i] == NULL){
+            font->glyph_table = table;
+            /* Only free the pages that were allocated. */
+            for(n=i+1;n<MT_FONT_PAGE_NUM;n++) table[n] = NULL;
+            mt_font_free_glyph_table(font);
+
+            return MT_E_OUT_OF_MEM;
+        }
+
+        memcpy(table[i], ids, MT_FONT_PAGE_SIZE*sizeof(unsigned short int));
+        font->glyph_table_size += MT_FONT_PAGE_SIZE*sizeof(unsigned short int);
     }
 
-    while(first != last) {
-        selected = (last+first)/2;
-        if(font->glyphs[selected].c == c){
-            return font->glyphs+selected;
-        }else if(font->glyphs[selected].c < c){
-            first = selected+1;
-        }else{
-            last = selected;
+    font->glyph_table = table;
+
+    return MT_E_NONE;
+}
+
+void mt_font_free_glyph_table(MTFont *font) {
+    size_t i;
+
+    if(font->glyph_table != NULL){
+        for(i=0;i<MT_FONT_PAGE_NUM;i++){
+            free(font->glyph_table[i]);
         }
     }
 
-    if(font->glyphs[first].c == c) return font->glyphs+first;
+    free(font->glyph_table);
+    font->glyph_table = NULL;
+    font->glyph_table_size = 0;
+}
+
+#define MT_FONT_ENTRY(font, n) \
+    ((font)->glyph_blocks[(n)/MT_FONT_GLYPH_BLOCK]+(n)%MT_FONT_GLYPH_BLOCK)
+
+void _mt_font_lru_remove(MTFont *font, size_t n) {
+    MTFontEntry *entry = MT_FONT_ENTRY(font, n);
+
+    if(entry->prev != MT_FONT_NONE){
+        MT_FONT_ENTRY(font, entry->prev)->next = entry->next;
+    }else{
+        font->lru_first = entry->next;
+    }
 
-    font->expected_glyph_pos = first;
-    return NULL;
+    if(entry->next != MT_FONT_NONE){
+        MT_FONT_ENTRY(font, entry->next)->prev = entry->prev;
+    }else{
+        font->lru_last = entry->prev;
+    }
 }
 
-int _mt_font_load_glyph(MTFont *font, size_t c) {
+void _mt_font_lru_push(MTFont *font, size_t n) {
+    MTFontEntry *entry = MT_FONT_ENTRY(font, n);
+
+    entry->prev = MT_FONT_NONE;
+    entry->next = font->lru_first;
+
+    if(font->lru_first != MT_FONT_NONE){
+        MT_FONT_ENTRY(font, font->lru_first)->prev = n;
+    }else{
+        font->lru_last = n;
+    }
+
+    font->lru_first = n;
+}
+
+void _mt_font_evict(MTFont *font) {
+    size_t n;
+    MTFontEntry *entry;
+
+    if(!font->budget) return;
+
+    /* Pinned glyphs are not in the LRU list, so they can't be evicted. */
+    while(font->stats.memory > font->budget && font->lru_last != MT_FONT_NONE){
+        n = font->lru_last;
+        entry = MT_FONT_ENTRY(font, n);
+
+#if MT_DEBUG
+        printf("mibitype: Evict glyph %lu!\n", entry->glyph.id);
+#endif
+
+        _mt_font_lru_remove(font, n);
+        mt_map_remove(&font->glyph_map, entry->glyph.id);
+
+        font->stats.memory -= entry->memory;
+        font->stats.evictions++;
+
+        mt_glyph_free(&entry->glyph);
+
+        entry->next = font->free_entry;
+        font->free_entry = n;
+    }
+
+    /* Give the chunks that only contained evicted outlines back, or the
+     * memory of the process would stay at its highest. */
+    mt_arena_trim(&font->arena);
+}
+
+MTGlyph *mt_font_search_glyph(MTFont *font, size_t id) {
+    size_t *slot;
+    MTFontEntry *entry;
+
+    /* The missing glyph is always loaded. */
+    if(!id) return &font->missing;
+
+    slot = mt_map_get(&font->glyph_map, id);
+    if(slot == NULL) return NULL;
+
+    entry = MT_FONT_ENTRY(font, *slot);
+
+    /* Mark it as the most recently used glyph. */
+    if(!entry->pins && font->lru_first != *slot){
+        _mt_font_lru_remove(font, *slot);
+        _mt_font_lru_push(font, *slot);
+    }
+
+    return &entry->glyph;
+}
+
+MTGlyph *_mt_font_load_glyph(MTFont *font, size_t id, size_t c) {
     void *new;
     int rc;
     MTGlyph tmp;
+    MTFontEntry *entry;
+
+    size_t n;
+    size_t block;
 
 #if MT_DEBUG
-    printf("mibitype: Load glyph %lu at %lu!\n", c, font->expected_glyph_pos);
+    printf("mibitype: Load glyph %lu!\n", id);
 #endif
 
     rc = MT_LOADERLIST_GET(font->loader, load_glyph)(font->data, font,
-                           &tmp, mt_font_get_glyph_id(font, c));
+                           &tmp, id);
 
     if(rc){
         mt_glyph_free(&tmp);
-        return rc;
+        return NULL;
     }
 
     tmp.c = c;
+    tmp.id = id;
+
+    if(font->free_entry != MT_FONT_NONE){
+        /* Reuse an entry of an evicted glyph. */
+        n = font->free_entry;
+    }else{
+        n = font->glyph_num;
+        block = n/MT_FONT_GLYPH_BLOCK;
+
+        if(!(n%MT_FONT_GLYPH_BLOCK)){
+            /* All the blocks are full, add a new one. */
+            new = realloc(font->glyph_blocks, (block+1)*sizeof(MTFontEntry*));
+            if(new == NULL){
+                mt_glyph_free(&tmp);
+                return NULL;
+            }
+            font->glyph_blocks = new;
+
+            font->glyph_blocks[block] = malloc(MT_FONT_GLYPH_BLOCK*
+                                               sizeof(MTFontEntry));
+            if(font->glyph_blocks[block] == NULL){
+                mt_glyph_free(&tmp);
+                return NULL;
+            }
+        }
+    }
 
-    new = realloc(font->glyphs, (font->glyph_num+1)*sizeof(MTGlyph));
-    if(new == NULL){
+    if(mt_map_set(&font->glyph_map, id, n)){
+        if(n == font->glyph_num && !(n%MT_FONT_GLYPH_BLOCK)){
+            /* The block added for this glyph is still empty, free it so that
+             * the next glyph doesn't leak it by adding it again. */
+            free(font->glyph_blocks[n/MT_FONT_GLYPH_BLOCK]);
+            font->glyph_blocks[n/MT_FONT_GLYPH_BLOCK] = NULL;
+        }
         mt_glyph_free(&tmp);
-        return MT_E_OUT_OF_MEM;
+        return NULL;
     }
-    font->glyphs = new;
 
-    if(font->expected_glyph_pos < font->glyph_num){
-        memmove(font->glyphs+font->expected_glyph_pos+1,
-                font->glyphs+font->expected_glyph_pos,
-                (font->glyph_num-font->expected_glyph_pos)*sizeof(MTGlyph));
+    entry = MT_FONT_ENTRY(font, n);
+
+    if(n == font->free_entry){
+        font->free_entry = entry->next;
+    }else{
+        font->glyph_num++;
     }
 
-    font->glyphs[font->expected_glyph_pos] = tmp;
+    entry->glyph = tmp;
+    entry->pins = 0;
+    entry->memory = sizeof(MTFontEntry)+mt_glyph_memory(&tmp);
 
-    font->glyph_num++;
+    font->stats.memory += entry->memory;
+    font->stats.misses++;
 
-    return rc;
+    /* The new glyph isn't in the LRU list yet, so it can't get evicted. */
+    _mt_font_evict(font);
+
+    _mt_font_lru_push(font, n);
+
+    return &entry->glyph;
 }
 
 MTGlyph *mt_font_get_glyph(MTFont *font, size_t c) {
     MTGlyph *glyph;
 
-    glyph = mt_font_search_glyph(font, c);
+    size_t *cached_id;
+    size_t id;
 
-    if(glyph == NULL){
-#if MT_DEBUG
-        size_t i;
-        puts("mibitype: ========");
-        for(i=0;i<font->glyph_num;i++){
-            printf("mibitype: Glyph %lu is already loaded.\n",
-                   font->glyphs[i].c);
+    if(font->flags&MT_FONT_METRICS_ONLY) return &font->missing;
+
+    cached_id = mt_map_get(&font->char_map, c);
+
+    if(cached_id != NULL){
+        id = *cached_id;
+
+        glyph = mt_font_search_glyph(font, id);
+        if(glyph != NULL){
+            font->stats.hits++;
+            return glyph;
         }
-        puts("mibitype: ========");
-#endif
-        if(_mt_font_load_glyph(font, c)){
-#if MT_DEBUG
-            puts("mibitype: Failed to load glyph!");
-#endif
-            return &font->missing;
+    }else{
+        id = mt_font_get_glyph_id(font, c);
+
+        /* If this fails the glyph id will just be looked up again the next
+         * time. */
+        mt_map_set(&font->char_map, c, id);
+
+        glyph = mt_font_search_glyph(font, id);
+        if(glyph != NULL){
+            font->stats.aliased++;
+            return glyph;
         }
-        return font->glyphs+font->expected_glyph_pos;
     }
 
+    glyph = _mt_font_load_glyph(font, id, c);
+    if(glyph == NULL){
 #if MT_DEBUG
-    /*puts("mibitype: Glyph already loaded!");*/
+        puts("mibitype: Failed to load glyph!");
 #endif
+        return &font->missing;
+    }
 
     return glyph;
 }
 
+MTGlyph *mt_font_get_glyph_by_id(MTFont *font, size_t id) {
+    MTGlyph *glyph;
+
+    if(font->flags&MT_FONT_METRICS_ONLY) return &font->missing;
+
+    glyph = mt_font_search_glyph(font, id);
+
+    if(glyph != NULL){
+        font->stats.hits++;
+        return glyph;
+    }
+
+    glyph = _mt_font_load_glyph(font, id, 0);
+    if(glyph == NULL) return &font->missing;
+
+    return glyph;
+}
+
+MTGlyphMetrics *mt_font_get_metrics(MTFont *font, size_t id) {
+    return font->metrics+(id < font->metrics_num ? id : 0);
+}
+
+int mt_font_get_kerning(MTFont *font, size_t left, size_t right) {
+    return MT_LOADERLIST_GET(font->loader, get_kerning)(font->data, font, left,
+                                                        right);
+}
+
+size_t mt_font_substitute(MTFont *font, size_t *ids, size_t num) {
+    return MT_LOADERLIST_GET(font->loader, substitute)(font->data, font, ids,
+                                                       num);
+}
+
+long int mt_font_position(MTFont *font, const size_t *ids, size_t num,
+                          long int *x) {
+    size_t i;
+
+    long int pos = 0;
+
+    for(i=0;i<num;i++){
+        if(i) pos += mt_font_get_kerning(font, ids[i-1], ids[i]);
+
+        x[i] = pos;
+        pos += mt_font_get_metrics(font, ids[i])->advance_width;
+    }
+
+    return pos;
+}
+
+int mt_font_measure(MTFont *font, const char *str, size_t len,
+                    MTFontMeasure *measure) {
+    MTGlyph bounds;
+    MTGlyphMetrics *metrics;
+
+    size_t pos = 0;
+    unsigned long int c;
+    size_t id;
+    size_t last = MT_FONT_NONE;
+
+    long int x = 0;
+    long int y = 0;
+    const long int line_height = font->ascender-font->descender+
+                                 font->line_gap;
+
+    int ink = 0;
+
+    measure->advance = 0;
+    measure->xmin = 0;
+    measure->ymin = 0;
+    measure->xmax = 0;
+    measure->ymax = 0;
+    measure->line_num = len ? 1 : 0;
+
+    while(pos < len){
+        c = mt_utf8_next(str, len, &pos);
+
+        if(c == '\n'){
+            if(x > measure->advance) measure->advance = x;
+
+            x = 0;
+            y -= line_height;
+            measure->line_num++;
+            last = MT_FONT_NONE;
+            continue;
+        }
+
+        id = mt_font_get_glyph_id(font, c);
+        metrics = mt_font_get_metrics(font, id);
+
+        if(last != MT_FONT_NONE) x += mt_font_get_kerning(font, last, id);
+        last = id;
+
+        /* Glyphs without an outline have an empty bounding box. */
+        if(!MT_LOADERLIST_GET(font->loader, load_bounds)(font->data, font,
+                              &bounds, id) &&
+           (bounds.xmin < bounds.xmax || bounds.ymin < bounds.ymax)){
+            if(!ink || x+bounds.xmin < measure->xmin){
+                measure->xmin = x+bounds.xmin;
+            }
+            if(!ink || y+bounds.ymin < measure->ymin){
+                measure->ymin = y+bounds.ymin;
+            }
+            if(!ink || x+bounds.xmax > measure->xmax){
+                measure->xmax = x+bounds.xmax;
+            }
+            if(!ink || y+bounds.ymax > measure->ymax){
+                measure->ymax = y+bounds.ymax;
+            }
+
+            ink = 1;
+        }
+
+        x += metrics->advance_width;
+    }
+
+    if(x > measure->advance) measure->advance = x;
+
+    return MT_E_NONE;
+}
+
+void mt_font_set_budget(MTFont *font, size_t budget) {
+    font->budget = budget;
+
+    _mt_font_evict(font);
+}
+
+void mt_font_pin_glyph(MTFont *font, MTGlyph *glyph) {
+    MTFontEntry *entry = (MTFontEntry*)glyph;
+    size_t *slot;
+
+    if(glyph == &font->missing) return;
+
+    if(!entry->pins){
+        slot = mt_map_get(&font->glyph_map, glyph->id);
+        if(slot != NULL) _mt_font_lru_remove(font, *slot);
+    }
+
+    entry->pins++;
+}
+
+void mt_font_unpin_glyph(MTFont *font, MTGlyph *glyph) {
+    MTFontEntry *entry = (MTFontEntry*)glyph;
+    size_t *slot;
+
+    if(glyph == &font->missing || !entry->pins) return;
+
+    entry->pins--;
+
+    if(!entry->pins){
+        slot = mt_map_get(&font->glyph_map, glyph->id);
+        if(slot != NULL) _mt_font_lru_push(font, *slot);
+
+        _mt_font_evict(font);
+    }
+}
+
 int mt_font_size_to_pixels(MTFont *font, int points, int size) {
     return MT_LOADERLIST_GET(font->loader, size_to_pixels)(font->data, font,
                              points, size);
@@ -202,14 +582,33 @@ int mt_font_size_to_pixels(MTFont *font, int points, int size) {
 void mt_font_free(MTFont *font) {
     size_t i;
 
+    /* The glyphs of free entries are already freed, freeing them again
+     * doesn't do anything. */
     for(i=0;i<font->glyph_num;i++){
-        mt_glyph_free(font->glyphs+i);
+        mt_glyph_free(&MT_FONT_ENTRY(font, i)->glyph);
+    }
+
+    for(i=0;i<(font->glyph_num+MT_FONT_GLYPH_BLOCK-1)/MT_FONT_GLYPH_BLOCK;
+        i++){
+        free(font->glyph_blocks[i]);
     }
 
     mt_glyph_free(&font->missing);
 
-    free(font->glyphs);
-    font->glyphs = NULL;
+    mt_arena_free(&font->arena);
+
+    free(font->glyph_blocks);
+    font->glyph_blocks = NULL;
+    font->glyph_num = 0;
+
+    mt_map_free(&font->glyph_map);
+    mt_map_free(&font->char_map);
+
+    mt_font_free_glyph_table(font);
+
+    free(font->metrics);
+    font->metrics = NULL;
+    font->metrics_num = 0;
 
     MT_LOADERLIST_GET(font->loader, free)(font->data, font);
 
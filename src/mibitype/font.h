@@ -39,35 +39,193 @@
 
 #include <mibitype/reader.h>
 #include <mibitype/glyph.h>
+#include <mibitype/map.h>
+#include <mibitype/arena.h>
 
 #include <stdlib.h>
 
+/* The glyph table covers the BMP with 256 pages of 256 glyph ids. */
+#define MT_FONT_PAGE_NUM 256
+#define MT_FONT_PAGE_SIZE 256
+
+/* The loaded glyphs are stored in blocks of MT_FONT_GLYPH_BLOCK glyphs that
+ * are never moved, so that the pointers returned by mt_font_get_glyph stay
+ * valid as long as the glyph is not evicted. */
+#define MT_FONT_GLYPH_BLOCK 64
+
+#define MT_FONT_NONE ((size_t)-1)
+
+/* Flags of mt_font_init_flags. */
+enum {
+    /* Only load what is needed to get the metrics of the glyphs: outlines
+     * can't be loaded, mt_font_get_glyph always returns the missing glyph,
+     * that has no outline either. */
+    MT_FONT_METRICS_ONLY = 1
+};
+
+/* The chunks of the outline arena can hold at least this many glyphs of the
+ * biggest size allowed by the font. */
+#define MT_FONT_ARENA_GLYPHS 16
+
+typedef struct {
+    /* Must stay the first member, the glyph pointers we return are cast back
+     * to entries. */
+    MTGlyph glyph;
+
+    /* Links of the LRU list, pinned glyphs are removed from it. When the entry
+     * is free, next links the free entries together. */
+    size_t prev, next;
+
+    unsigned int pins;
+
+    /* The memory used by the glyph, including the entry itself. */
+    size_t memory;
+} MTFontEntry;
+
+typedef struct {
+    /* Glyphs that were already loaded. */
+    unsigned long int hits;
+    /* Glyphs that had to be decoded. */
+    unsigned long int misses;
+    /* Characters that were mapped to a glyph that was already loaded for
+     * another character, i.e. decodes that were avoided. */
+    unsigned long int aliased;
+    /* Glyphs that were evicted to stay under the memory budget. */
+    unsigned long int evictions;
+
+    /* The memory currently used by the loaded glyphs in bytes. */
+    size_t memory;
+} MTFontStats;
+
+/* The size of a text measured by mt_font_measure, in font units. */
+typedef struct {
+    /* The advance of the longest line. */
+    long int advance;
+
+    /* The box containing the ink of all the glyphs, relative to the origin of
+     * the first line, with Y going up. It is empty (all zeros) if no glyph
+     * has an outline or if the font was loaded in metrics only mode. */
+    long int xmin, ymin;
+    long int xmax, ymax;
+
+    size_t line_num;
+} MTFontMeasure;
+
 typedef struct {
     MTReader *reader;
 
-    MTGlyph *glyphs;
+    int flags;
+
+    /* The glyphs are stored once per glyph id, glyph_map maps glyph ids to
+     * entries and char_map maps characters to glyph ids. */
+    MTFontEntry **glyph_blocks;
+    MTMap glyph_map;
+    MTMap char_map;
+
+    /* The most and least recently used glyphs, and the first free entry. */
+    size_t lru_first, lru_last;
+    size_t free_entry;
+
+    /* The maximum amount of memory the loaded glyphs may use, 0 if there is no
+     * limit. */
+    size_t budget;
+
+    MTFontStats stats;
+
+    /* The outlines of the glyphs are allocated from this arena. */
+    MTArena arena;
+    /* The size of the biggest outline the font may contain, set by the
+     * loader. */
+    size_t glyph_memory_max;
 
     MTGlyph missing;
 
     int dpi;
 
+    /* The size of the em square in font units, set by the loader. */
+    int units_per_em;
+
     int xmin, xmax, ymin, ymax;
 
     int ascender, descender, line_gap;
 
     size_t glyph_num;
 
+    /* The metrics of all the glyphs of the font, indexed by glyph id, set by
+     * the loader. */
+    MTGlyphMetrics *metrics;
+    size_t metrics_num;
+
     size_t loader;
 
-    size_t expected_glyph_pos;
+    /* Optional codepoint to glyph id table built by
+     * mt_font_build_glyph_table. Pages that don't contain any glyph are not
+     * allocated. */
+    unsigned short int **glyph_table;
+    size_t glyph_table_size;
 
     void *data;
 } MTFont;
 
 int mt_font_init(MTFont *font, MTReader *reader, int dpi);
 
+int mt_font_init_flags(MTFont *font, MTReader *reader, int dpi, int flags);
+
+size_t mt_font_get_glyph_id(MTFont *font, size_t c);
+
 MTGlyph *mt_font_get_glyph(MTFont *font, size_t c);
 
+MTGlyph *mt_font_get_glyph_by_id(MTFont *font, size_t id);
+
+/* Get the metrics of a glyph without loading it. Ids that are out of range get
+ * the metrics of the missing glyph. */
+MTGlyphMetrics *mt_font_get_metrics(MTFont *font, size_t id);
+
+/* Get the kerning between the glyphs left and right in font units. */
+int mt_font_get_kerning(MTFont *font, size_t left, size_t right);
+
+/* Apply the single substitutions and the ligatures of the font to a run of
+ * num glyph ids, in place. Returns the number of glyphs after substitution,
+ * that is smaller than num if ligatures were formed. */
+size_t mt_font_substitute(MTFont *font, size_t *ids, size_t num);
+
+/* Position a run of num glyph ids: x[i] is set to the position of the glyph
+ * ids[i] relative to the start of the run, in font units, with kerning
+ * applied. Returns the advance of the whole run. */
+long int mt_font_position(MTFont *font, const size_t *ids, size_t num,
+                          long int *x);
+
+/* Measure len bytes of UTF-8 text. Lines are separated by '\n'. Only the
+ * metrics, the kerning and the bounding boxes of the glyphs are used, no glyph
+ * is loaded and nothing is allocated. */
+int mt_font_measure(MTFont *font, const char *str, size_t len,
+                    MTFontMeasure *measure);
+
+/* Limit the memory used by the loaded glyphs, the least recently used glyphs
+ * get evicted when the budget is exceeded. 0 disables the limit. When a budget
+ * is set, a glyph returned by mt_font_get_glyph may be evicted by any later
+ * call that loads a glyph, pin it to keep it.
+ * The budget bounds stats.memory, i.e. the arena blocks charged to the
+ * glyphs, not the chunks of the arena: the chunks that eviction empties are
+ * given back to the system, but a chunk that still contains a glyph is kept,
+ * so font->arena.memory can stay above the budget when the glyphs that are
+ * kept are spread over many chunks. */
+void mt_font_set_budget(MTFont *font, size_t budget);
+
+/* Pinned glyphs are never evicted. Each mt_font_pin_glyph call must be matched
+ * by a call to mt_font_unpin_glyph. */
+void mt_font_pin_glyph(MTFont *font, MTGlyph *glyph);
+
+void mt_font_unpin_glyph(MTFont *font, MTGlyph *glyph);
+
+/* Precompute the glyph ids of all the characters of the BMP, so that getting
+ * a glyph id doesn't require going through the loader anymore. The memory
+ * used by the table is stored in glyph_table_size, use
+ * mt_font_free_glyph_table to get rid of it if it is too big. */
+int mt_font_build_glyph_table(MTFont *font);
+
+void mt_font_free_glyph_table(MTFont *font);
+
 int mt_font_size_to_pixels(MTFont *font, int points, int size);
 
 void mt_font_free(MTFont *font);
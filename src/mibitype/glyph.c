@@ -41,16 +41,84 @@ int mt_glyph_init(MTGlyph *glyph) {
     glyph->contour_ends = NULL;
     glyph->contour_num = 0;
 
-    glyph->points = NULL;
+    glyph->point_num = 0;
+
+    glyph->x = NULL;
+    glyph->y = NULL;
+    glyph->on_curve = NULL;
+
+    glyph->arena = NULL;
 
     glyph->c = '\0';
+    glyph->id = 0;
 
     return MT_E_NONE;
 }
 
+size_t _mt_glyph_memory(size_t point_num, size_t contour_num) {
+    return point_num*2*sizeof(short int)+
+           contour_num*sizeof(unsigned short int)+(point_num+7)/8;
+}
+
+int mt_glyph_alloc(MTGlyph *glyph, MTArena *arena, size_t point_num,
+                   size_t contour_num) {
+    const size_t size = _mt_glyph_memory(point_num, contour_num);
+
+    unsigned char *block;
+
+    glyph->point_num = 0;
+    glyph->contour_num = 0;
+    glyph->x = NULL;
+    glyph->y = NULL;
+    glyph->contour_ends = NULL;
+    glyph->on_curve = NULL;
+    glyph->arena = NULL;
+
+    if(!size) return MT_E_NONE;
+
+    block = arena != NULL ? mt_arena_alloc(arena, size) : malloc(size);
+    if(block == NULL) return MT_E_OUT_OF_MEM;
+
+    /* The shorts come first so that they are aligned. */
+    glyph->x = (short int*)block;
+    glyph->y = glyph->x+point_num;
+    glyph->contour_ends = (unsigned short int*)(glyph->y+point_num);
+    glyph->on_curve = (unsigned char*)(glyph->contour_ends+contour_num);
+
+    glyph->point_num = point_num;
+    glyph->contour_num = contour_num;
+    glyph->arena = arena;
+
+    return MT_E_NONE;
+}
+
+void mt_glyph_get_point(MTGlyph *glyph, size_t n, MTPoint *point) {
+    point->x = MT_GLYPH_X(glyph, n);
+    point->y = MT_GLYPH_Y(glyph, n);
+    point->on_curve = MT_GLYPH_ON_CURVE(glyph, n);
+}
+
+size_t mt_glyph_memory(MTGlyph *glyph) {
+    const size_t size = _mt_glyph_memory(glyph->point_num,
+                                         glyph->contour_num);
+
+    return glyph->arena != NULL ? mt_arena_block_size(size) : size;
+}
+
 void mt_glyph_free(MTGlyph *glyph) {
-    free(glyph->contour_ends);
+    if(glyph->arena != NULL){
+        mt_arena_release(glyph->arena, glyph->x, mt_glyph_memory(glyph));
+    }else{
+        free(glyph->x);
+    }
+
+    glyph->arena = NULL;
+
+    glyph->x = NULL;
+    glyph->y = NULL;
     glyph->contour_ends = NULL;
-    free(glyph->points);
-    glyph->points = NULL;
+    glyph->on_curve = NULL;
+
+    glyph->point_num = 0;
+    glyph->contour_num = 0;
 }
@@ -37,28 +37,64 @@
 
 #include <stddef.h>
 
+#include <mibitype/arena.h>
+
 typedef struct {
     int x, y;
     unsigned char on_curve;
 } MTPoint;
 
+/* The horizontal metrics of a glyph, available without loading it. */
+typedef struct {
+    unsigned short int advance_width;
+    short int left_side_bearing;
+} MTGlyphMetrics;
+
+/* The outline is stored as a structure of arrays: the coordinates of the
+ * points are in x and y, and on_curve is a bitset telling which points are on
+ * the curve. x, y, contour_ends and on_curve are a single block starting at x,
+ * allocated from arena if it isn't NULL, with malloc otherwise. */
 typedef struct {
-    size_t *contour_ends;
+    unsigned short int *contour_ends;
     size_t contour_num;
 
+    size_t point_num;
+
     int xmin, ymin;
     int xmax, ymax;
 
     unsigned int advance_width;
     int left_side_bearing;
 
-    MTPoint *points;
+    short int *x;
+    short int *y;
+    unsigned char *on_curve;
+
+    MTArena *arena;
 
+    /* The first character this glyph was loaded for, other characters may
+     * share it. */
     size_t c;
+    size_t id;
 } MTGlyph;
 
+#define MT_GLYPH_X(glyph, n) ((glyph)->x[n])
+#define MT_GLYPH_Y(glyph, n) ((glyph)->y[n])
+#define MT_GLYPH_ON_CURVE(glyph, n) (((glyph)->on_curve[(n)>>3]>>((n)&7))&1)
+
 int mt_glyph_init(MTGlyph *glyph);
 
+/* Allocate the outline of a glyph with point_num points and contour_num
+ * contours. If arena is NULL, it is allocated with malloc. */
+int mt_glyph_alloc(MTGlyph *glyph, MTArena *arena, size_t point_num,
+                   size_t contour_num);
+
+void mt_glyph_get_point(MTGlyph *glyph, size_t n, MTPoint *point);
+
+/* Get the amount of memory used by the outline of the glyph in bytes. If it
+ * was allocated from an arena, this is the size of its block. */
+size_t mt_glyph_memory(MTGlyph *glyph);
+
 void mt_glyph_free(MTGlyph *glyph);
 
 #endif
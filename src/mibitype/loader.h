@@ -44,6 +44,13 @@ typedef struct {
     int (*init)(void *_data, void *_font);
     size_t (*get_glyph_id)(void *_data, void *_font, size_t c);
     int (*load_glyph)(void *_data, void *_font, void *_glyph, size_t id);
+    /* Only load the bounding box of the glyph, without its outline. */
+    int (*load_bounds)(void *_data, void *_font, void *_glyph, size_t id);
+    /* Get the kerning between two glyphs in font units. */
+    int (*get_kerning)(void *_data, void *_font, size_t left, size_t right);
+    /* Apply the glyph substitutions to a run of glyph ids in place and
+     * return the new number of glyphs. */
+    size_t (*substitute)(void *_data, void *_font, size_t *ids, size_t num);
     int (*load_missing)(void *_data, void *_font, void *_glyph);
     int (*size_to_pixels)(void *_data, void *_font, int points, int size);
     void (*free)(void *_data, void *_font);
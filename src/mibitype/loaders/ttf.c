@@ -40,6 +40,11 @@
 #define MT_TTF_CHAR_TO_INT(a, b, c, d) ((a)|((b)<<8)|((c)<<16)|((d)<<24))
 #define MT_TTF_STR_TO_INT(s) MT_TTF_CHAR_TO_INT((s)[0], (s)[1], (s)[2], (s)[3])
 
+/* Tags of OpenType features, as read with MT_VIEW_U32. */
+#define MT_TTF_TAG(a, b, c, d) (((unsigned long int)(a)<<24)| \
+                                ((unsigned long int)(b)<<16)| \
+                                ((unsigned long int)(c)<<8)|(d))
+
 #define MT_TTF_REQUIRED_TABLES_NUM 9
 
 #define MT_TTF_EXTEND_SIGN(n, b) ((n)&(1<<((b)-1)) ? -(((n)^0xFFFF)+1) : (n))
@@ -50,6 +55,9 @@ enum {
     MT_TTF_HEAD = MT_TTF_CHAR_TO_INT('h', 'e', 'a', 'd'),
     MT_TTF_HHEA = MT_TTF_CHAR_TO_INT('h', 'h', 'e', 'a'),
     MT_TTF_HMTX = MT_TTF_CHAR_TO_INT('h', 'm', 't', 'x'),
+    MT_TTF_KERN = MT_TTF_CHAR_TO_INT('k', 'e', 'r', 'n'),
+    MT_TTF_GPOS = MT_TTF_CHAR_TO_INT('G', 'P', 'O', 'S'),
+    MT_TTF_GSUB = MT_TTF_CHAR_TO_INT('G', 'S', 'U', 'B'),
     MT_TTF_LOCA = MT_TTF_CHAR_TO_INT('l', 'o', 'c', 'a'),
     MT_TTF_MAXP = MT_TTF_CHAR_TO_INT('m', 'a', 'x', 'p'),
     MT_TTF_NAME = MT_TTF_CHAR_TO_INT('n', 'a', 'm', 'e'),
@@ -132,6 +140,14 @@ int _mt_ttf_load_dir(MTTTF *ttf, MTReader *reader, int is_check) {
             ttf->table_dir[i].offset = mt_reader_read_int(reader);
             ttf->table_dir[i].size = mt_reader_read_int(reader);
 
+            /* Check once that the table fits in the file, so that we don't
+             * need to check it each time we read from it. */
+            if(ttf->table_dir[i].offset > reader->size ||
+               ttf->table_dir[i].size > reader->size-
+                                        ttf->table_dir[i].offset){
+                return MT_E_CORRUPTED;
+            }
+
 #if MT_DEBUG
             /* I may cause issues depending on the endianness */
             fputs("mibitype: Table name: ", stdout);
@@ -165,14 +181,24 @@ int mt_ttf_is_valid(void *_data, MTReader *reader) {
 }
 
 int _mt_ttf_load_maxp(MTTTF *ttf, MTFont *font) {
-    /* TODO: Doc. */
+    /* The maxp table starts with:
+     * uint32 the version (0x00010000 for TrueType outlines).
+     * uint16 the number of glyphs.
+     * uint16 the maximum number of points in a simple glyph.
+     * uint16 the maximum number of contours in a simple glyph.
+     * uint16 the maximum number of points in a compound glyph.
+     * uint16 the maximum number of contours in a compound glyph.
+     * followed by other limits that we don't need.
+     */
 
     MT_READER_JMP(font->reader, ttf->maxp_table_pos);
 
-    /* Skip the version number for now. */
     if(mt_reader_read_int(font->reader) != 0x00010000) return MT_E_CORRUPTED;
     ttf->glyph_num = mt_reader_read_short(font->reader);
     ttf->simple_points_max = mt_reader_read_short(font->reader);
+    ttf->simple_contours_max = mt_reader_read_short(font->reader);
+    ttf->compound_points_max = mt_reader_read_short(font->reader);
+    ttf->compound_contours_max = mt_reader_read_short(font->reader);
 
 #if MT_DEBUG
     printf("mibitype: This font has %d glyphs\n", ttf->glyph_num);
@@ -198,6 +224,20 @@ int _mt_ttf_get_table_pos(MTTTF *ttf, unsigned long int table, size_t *pos) {
     return !found;
 }
 
+int _mt_ttf_get_table_view(MTTTF *ttf, MTFont *font, unsigned long int table,
+                           MTView *view) {
+    size_t i;
+
+    for(i=0;i<ttf->table_num;i++){
+        if(ttf->table_dir[i].tag == table){
+            return mt_reader_view(font->reader, ttf->table_dir[i].offset,
+                                  ttf->table_dir[i].size, view);
+        }
+    }
+
+    return MT_E_CORRUPTED;
+}
+
 int _mt_ttf_load_head(MTTTF *ttf, MTFont *font) {
     size_t offset;
 
@@ -208,6 +248,8 @@ int _mt_ttf_load_head(MTTTF *ttf, MTFont *font) {
     MT_READER_JMP(font->reader, offset);
     MT_READER_SKIP(font->reader, 4*4+2);
     ttf->units_per_em = mt_reader_read_short(font->reader);
+    if(!ttf->units_per_em) return MT_E_CORRUPTED;
+    font->units_per_em = ttf->units_per_em;
     MT_READER_SKIP(font->reader, 2*8);
     font->xmin = mt_reader_read_short(font->reader);
     font->ymin = mt_reader_read_short(font->reader);
@@ -234,6 +276,145 @@ int _mt_ttf_load_head(MTTTF *ttf, MTFont *font) {
     return 0;
 }
 
+int _mt_ttf_load_cmap4(MTTTF *ttf, MTFont *font, unsigned long int length) {
+    /* The format 4 subtable is made up of:
+     * uint16 the segment count times two.
+     * uint16 the search range, the entry selector and the range shift (we
+     *        don't need them, we do our own binary search).
+     * uint16 x seg_count the end codes of the segments.
+     * uint16 reserved padding.
+     * uint16 x seg_count the start codes of the segments.
+     * int16 x seg_count the deltas added to the characters.
+     * uint16 x seg_count the offsets into the glyph index array (or 0).
+     * uint16 x ... the glyph index array.
+     */
+
+    MTTTFCmap *cmap = &ttf->cmap;
+
+    const size_t start = cmap->data_cur-6;
+
+    size_t i;
+    size_t seg_count;
+    size_t header_size;
+
+    seg_count = mt_reader_read_short(font->reader)/2;
+    header_size = 16+seg_count*8;
+
+    if(start+header_size > font->reader->size) return MT_E_CORRUPTED;
+
+    /* Some fonts have a wrong length, don't read past the end of the file. */
+    if(length < header_size) length = header_size;
+    if(start+length > font->reader->size) length = font->reader->size-start;
+
+    cmap->seg_count = seg_count;
+    cmap->glyph_id_num = (length-header_size)/2;
+
+    /* Allocate all the arrays at once. */
+    cmap->end_codes = malloc((seg_count*4+cmap->glyph_id_num+1)*
+                             sizeof(unsigned short int));
+    if(cmap->end_codes == NULL) return MT_E_OUT_OF_MEM;
+
+    cmap->start_codes = cmap->end_codes+seg_count;
+    cmap->id_deltas = cmap->start_codes+seg_count;
+    cmap->id_range_offsets = cmap->id_deltas+seg_count;
+    cmap->glyph_ids = cmap->id_range_offsets+seg_count;
+
+    /* Skip all the search related things */
+    MT_READER_SKIP(font->reader, 2*3);
+
+    for(i=0;i<seg_count;i++){
+        cmap->end_codes[i] = mt_reader_read_short(font->reader);
+    }
+
+    /* Skip the reserved padding. */
+    MT_READER_SKIP(font->reader, 2);
+
+    for(i=0;i<seg_count;i++){
+        cmap->start_codes[i] = mt_reader_read_short(font->reader);
+    }
+    for(i=0;i<seg_count;i++){
+        cmap->id_deltas[i] = mt_reader_read_short(font->reader);
+    }
+    for(i=0;i<seg_count;i++){
+        cmap->id_range_offsets[i] = mt_reader_read_short(font->reader);
+    }
+    for(i=0;i<cmap->glyph_id_num;i++){
+        cmap->glyph_ids[i] = mt_reader_read_short(font->reader);
+    }
+
+#if MT_DEBUG
+    printf("mibitype: Segment count: %lu, glyph ids: %lu\n",
+           (unsigned long int)seg_count,
+           (unsigned long int)cmap->glyph_id_num);
+#endif
+
+    return MT_E_NONE;
+}
+
+int _mt_ttf_load_cmap12(MTTTF *ttf, MTFont *font) {
+    /* The format 12 subtable contains group_num groups made up of:
+     * uint32 the first character code of the group.
+     * uint32 the last character code of the group.
+     * uint32 the glyph index of the first character of the group.
+     * The groups are sorted by character code.
+     */
+
+    MTTTFCmap *cmap = &ttf->cmap;
+
+    size_t i;
+
+    if(cmap->data_cur > font->reader->size ||
+       cmap->group_num > (font->reader->size-cmap->data_cur)/12){
+        return MT_E_CORRUPTED;
+    }
+
+    if(!cmap->group_num) return MT_E_NONE;
+
+    cmap->groups = malloc(cmap->group_num*sizeof(MTTTFCmapGroup));
+    if(cmap->groups == NULL) return MT_E_OUT_OF_MEM;
+
+    MT_READER_JMP(font->reader, cmap->data_cur);
+
+    for(i=0;i<cmap->group_num;i++){
+        cmap->groups[i].start_char = mt_reader_read_int(font->reader);
+        cmap->groups[i].end_char = mt_reader_read_int(font->reader);
+        cmap->groups[i].start_index = mt_reader_read_int(font->reader);
+
+#if MT_DEBUG
+        printf("mibitype: start char: %04lx\n"
+               "mibitype: end char: %04lx\n"
+               "mibitype: start index: %04lx\n", cmap->groups[i].start_char,
+               cmap->groups[i].end_char, cmap->groups[i].start_index);
+#endif
+    }
+
+    return MT_E_NONE;
+}
+
+/* Rate an encoding subtable, 0 if it can't be used. Format 12 covers all the
+ * planes, so it is preferred over format 4 that only covers the BMP. */
+int _mt_ttf_cmap_score(unsigned short int platform_id,
+                       unsigned short int platform_specific_id,
+                       unsigned short int format) {
+    if(!platform_id){
+        /* Unicode BMP only (3), full repertoire (4 and 6). */
+        if(platform_specific_id != 3 && platform_specific_id != 4 &&
+           platform_specific_id != 6){
+            return 0;
+        }
+    }else if(platform_id == 3){
+        /* Windows Unicode BMP only (1) and full repertoire (10). */
+        if(platform_specific_id != 1 && platform_specific_id != 10) return 0;
+    }else{
+        return 0;
+    }
+
+    if(format == 12) return 2;
+    if(format == 4) return 1;
+
+    return 0;
+}
+
 int _mt_ttf_load_cmap(MTTTF *ttf, MTFont *font) {
     size_t i;
 
@@ -243,15 +424,13 @@ int _mt_ttf_load_cmap(MTTTF *ttf, MTFont *font) {
     unsigned short int platform_specific_id;
     unsigned short int format;
 
+    unsigned long int offset;
+    unsigned long int best_offset = 0;
+    int score;
+    int best_score = 0;
+
     unsigned long int length;
     unsigned long int group_num;
-#if MT_DEBUG
-    unsigned long int seg_count;
-    unsigned long int start_char, end_char, start_index;
-    size_t n;
-#endif
-
-    (void)length;
 
     MT_READER_JMP(font->reader, ttf->cmap_table_pos);
 
@@ -263,83 +442,63 @@ int _mt_ttf_load_cmap(MTTTF *ttf, MTFont *font) {
         MT_READER_JMP(font->reader, ttf->cmap_table_pos+4+i*8);
 
         platform_id = mt_reader_read_short(font->reader);
-        ttf->cmap.platform_id = platform_id;
+        platform_specific_id = mt_reader_read_short(font->reader);
+        offset = mt_reader_read_int(font->reader);
 
-#if MT_DEBUG
-        printf("mibitype: Platform ID: %d\n", platform_id);
-#endif
+        /* Jump to the start of the mapping table */
+        MT_READER_JMP(font->reader, ttf->cmap_table_pos+offset);
+        format = mt_reader_read_short(font->reader);
 
-        platform_specific_id = mt_reader_read_short(font->reader);
 #if MT_DEBUG
+        printf("mibitype: Platform ID: %d\n", platform_id);
         printf("mibitype: Platform specific ID: %d\n",
                platform_specific_id);
+        printf("mibitype: Character map format: %d\n", format);
 #endif
 
-        if(!platform_id){
-            /* It is an unicode encoding subtable. */
-            /* Jump to the start of the mapping table */
-            MT_READER_JMP(font->reader, ttf->cmap_table_pos+
-                                        mt_reader_read_int(font->reader));
-
-            if(platform_specific_id == 3 || platform_specific_id == 4){
-                /* It is a unicode 2.0 full repertoire (IDK what it means)
-                 * character table */
-                format = mt_reader_read_short(font->reader);
-                ttf->cmap.format = format;
-#if MT_DEBUG
-                printf("mibitype: Character map format: %d\n", format);
-#endif
-                if(format == 4){
-                    /* It is a two byte encoding format. */
-                    length = mt_reader_read_short(font->reader);
+        score = _mt_ttf_cmap_score(platform_id, platform_specific_id,
+                                   format);
+        if(score > best_score){
+            best_score = score;
+            best_offset = offset;
+            ttf->cmap.platform_id = platform_id;
+            ttf->cmap.format = format;
+            ttf->best_map = i;
+        }
+    }
 
-                    /* Skip the language code */
-                    MT_READER_SKIP(font->reader, 2);
+    if(!best_score) return MT_E_NONE;
 
-                    ttf->cmap.data_cur = font->reader->cur;
+    /* Skip the format. */
+    MT_READER_JMP(font->reader, ttf->cmap_table_pos+best_offset+2);
 
-#if MT_DEBUG
-                    /* Load the seg count */
-                    seg_count = mt_reader_read_short(font->reader)/2;
-                    printf("mibitype: Segment count: %lu\n", seg_count);
-#endif
+    if(ttf->cmap.format == 4){
+        /* It is a two byte encoding format. */
+        length = mt_reader_read_short(font->reader);
 
-                    ttf->best_map = i;
-                    break;
-                }else if(format == 12){
-                    /* Skip the reserved thing */
-                    MT_READER_SKIP(font->reader, 2);
-                    length = mt_reader_read_int(font->reader);
+        /* Skip the language code */
+        MT_READER_SKIP(font->reader, 2);
 
-                    /* Skip the language code */
-                    MT_READER_SKIP(font->reader, 4);
-                    group_num = mt_reader_read_int(font->reader);
-                    ttf->cmap.group_num = group_num;
-                    ttf->cmap.data_cur = font->reader->cur;
-                    ttf->best_map = i;
+        ttf->cmap.data_cur = font->reader->cur;
 
-#if MT_DEBUG
-                    printf("mibitype: Group num: %lu\n", group_num);
-                    for(n=0;n<group_num;n++){
-                        start_char = mt_reader_read_int(font->reader);
-                        end_char = mt_reader_read_int(font->reader);
-                        start_index = mt_reader_read_int(font->reader);
-                        printf("mibitype: start char: %04lx\n"
-                               "mibitype: end char: %04lx\n"
-                               "mibitype: start index: %04lx\n", start_char,
-                               end_char, start_index);
-                    }
+        return _mt_ttf_load_cmap4(ttf, font, length);
+    }
+
+    /* Skip the reserved thing */
+    MT_READER_SKIP(font->reader, 2);
+    length = mt_reader_read_int(font->reader);
 
-                    break;
+    /* Skip the language code */
+    MT_READER_SKIP(font->reader, 4);
+    group_num = mt_reader_read_int(font->reader);
+    ttf->cmap.group_num = group_num;
+    ttf->cmap.data_cur = font->reader->cur;
+
+#if MT_DEBUG
+    printf("mibitype: Group num: %lu\n", group_num);
 #endif
-                }
-            }
-        }else if(platform_id == 3){
-            /* TODO: Implement this! */
-        }
-    }
 
-    return MT_E_NONE;
+    return _mt_ttf_load_cmap12(ttf, font);
 }
 
 int _mt_ttf_load_hhea(MTTTF *ttf, MTFont *font) {
@@ -369,410 +528,1647 @@ int _mt_ttf_load_hhea(MTTTF *ttf, MTFont *font) {
     return MT_E_NONE;
 }
 
-int mt_ttf_init(void *_data, void *_font) {
-    int rc;
-
-    MTTTF *ttf = _data;
-    MTFont *font = _font;
-
-    ttf->flags = NULL;
-    ttf->table_dir = NULL;
-
-    _mt_ttf_load_dir(ttf, font->reader, 0);
+int _mt_ttf_reserve(MTTTF *ttf, size_t contour_num, size_t point_num,
+                    size_t flag_num) {
+    void *new;
 
-    if(_mt_ttf_get_table_pos(ttf, MT_TTF_GLYF, &ttf->glyf_table_pos)){
-        return MT_E_CORRUPTED;
+    /* The buffers are sized using the limits in maxp, so they should only grow
+     * for fonts where these limits are wrong. */
+    if(contour_num > ttf->contour_buffer_size){
+        new = realloc(ttf->contour_buffer, contour_num*sizeof(size_t));
+        if(new == NULL) return MT_E_OUT_OF_MEM;
+        ttf->contour_buffer = new;
+        ttf->contour_buffer_size = contour_num;
     }
-    if(_mt_ttf_get_table_pos(ttf, MT_TTF_MAXP, &ttf->maxp_table_pos)){
-        return MT_E_CORRUPTED;
+
+    if(point_num > ttf->point_buffer_size){
+        new = realloc(ttf->point_buffer, point_num*sizeof(MTPoint));
+        if(new == NULL) return MT_E_OUT_OF_MEM;
+        ttf->point_buffer = new;
+        ttf->point_buffer_size = point_num;
     }
-    if(_mt_ttf_get_table_pos(ttf, MT_TTF_LOCA, &ttf->loca_table_pos)){
-        return MT_E_CORRUPTED;
+
+    if(flag_num > ttf->flag_buffer_size){
+        new = realloc(ttf->flags, flag_num);
+        if(new == NULL) return MT_E_OUT_OF_MEM;
+        ttf->flags = new;
+        ttf->flag_buffer_size = flag_num;
     }
-    if(_mt_ttf_get_table_pos(ttf, MT_TTF_CMAP, &ttf->cmap_table_pos)){
-        return MT_E_CORRUPTED;
+
+    return MT_E_NONE;
+}
+
+int _mt_ttf_load_hmtx(MTTTF *ttf, MTFont *font) {
+    /* hmtx contains advance_width_num pairs of an uint16 advance width and an
+     * int16 left side bearing, followed by the left side bearings of the
+     * remaining glyphs, that use the last advance width. They are decoded once
+     * here into a dense array, so that the metrics of a glyph can be known
+     * without loading it. */
+
+    MTView hmtx;
+
+    size_t i;
+    size_t pos;
+
+    unsigned short int advance_width;
+
+    int rc;
+
+    if((rc = _mt_ttf_get_table_view(ttf, font, MT_TTF_HMTX, &hmtx))){
+        return rc;
     }
-    if(_mt_ttf_get_table_pos(ttf, MT_TTF_HMTX, &ttf->htmx_table_pos)){
-        return MT_E_CORRUPTED;
+
+    if(!ttf->glyph_num) return MT_E_CORRUPTED;
+
+    /* Ignore the advance widths of glyphs that don't exist. */
+    if(ttf->advance_width_num > ttf->glyph_num){
+        ttf->advance_width_num = ttf->glyph_num;
     }
 
-    if((rc = _mt_ttf_load_maxp(ttf, _font))) return rc;
+    if(hmtx.size < (size_t)ttf->advance_width_num*4) return MT_E_CORRUPTED;
 
-    if((rc = _mt_ttf_load_head(ttf, _font))) return rc;
+    font->metrics = malloc(ttf->glyph_num*sizeof(MTGlyphMetrics));
+    if(font->metrics == NULL) return MT_E_OUT_OF_MEM;
+    font->metrics_num = ttf->glyph_num;
 
-    if((rc = _mt_ttf_load_cmap(ttf, _font))) return rc;
+    for(i=0;i<ttf->advance_width_num;i++){
+        font->metrics[i].advance_width = MT_VIEW_U16(&hmtx, i*4);
+        font->metrics[i].left_side_bearing = MT_VIEW_S16(&hmtx, i*4+2);
+    }
 
-    if((rc = _mt_ttf_load_hhea(ttf, _font))) return rc;
+    advance_width = font->metrics[i-1].advance_width;
 
-    ttf->flags = malloc(ttf->simple_points_max);
-    if(ttf->flags == NULL) return MT_E_OUT_OF_MEM;
+    /* Some fonts leave out the left side bearings at the end of the table. */
+    for(pos=i*4;i<ttf->glyph_num;i++,pos+=2){
+        font->metrics[i].advance_width = advance_width;
+        font->metrics[i].left_side_bearing = MT_VIEW_HAS(&hmtx, pos, 2) ?
+                                             MT_VIEW_S16(&hmtx, pos) : 0;
+    }
 
     return MT_E_NONE;
 }
 
-size_t mt_ttf_get_glyph_id(void *_data, void *_font, size_t c) {
-    MTTTF *ttf = _data;
-    MTFont *font = _font;
+#define MT_TTF_BIT_GET(bitset, n) (((bitset)[(n)>>3]>>((n)&7))&1)
+#define MT_TTF_BIT_SET(bitset, n) ((bitset)[(n)>>3] |= 1<<((n)&7))
 
-    size_t i;
-    unsigned long int start_char, end_char, start_index;
+MTTTFPairLookup *_mt_ttf_add_pair_lookup(MTTTF *ttf) {
+    MTTTFPairLookup *new;
+    MTTTFPairLookup *lookup;
 
-    unsigned short int seg_count;
+    new = realloc(ttf->pair_lookups,
+                  (ttf->pair_lookup_num+1)*sizeof(MTTTFPairLookup));
+    if(new == NULL) return NULL;
+    ttf->pair_lookups = new;
 
-    size_t old_pos;
+    lookup = ttf->pair_lookups+ttf->pair_lookup_num;
 
-    size_t delta, offset;
+    lookup->left = calloc((ttf->glyph_num+7)/8, 1);
+    if(lookup->left == NULL) return NULL;
 
-    /* TODO: Make something clean. */
+    mt_map_init(&lookup->pairs);
+    lookup->classes = NULL;
+    lookup->class_num = 0;
 
-    MT_READER_JMP(font->reader, ttf->cmap.data_cur);
+    ttf->pair_lookup_num++;
 
-    if(ttf->cmap.platform_id == 0){
-        if(ttf->cmap.format == 4){
-#if MT_DEBUG
-            puts("mibitype: Loading glyph id from cmap format 4!");
-#endif
-            /* Load the seg count */
-            seg_count = mt_reader_read_short(font->reader)/2;
-
-            /* Skip all the search related things */
-            MT_READER_SKIP(font->reader, 2*3);
-
-            /* Search the segment (endcodes are sorted, but I don't kniw if
-             * they can contain multiple elements with the same value so I'm
-             * not doing any binary search for now. */
-            for(i=0;i<seg_count;i++){
-                end_char = mt_reader_read_short(font->reader);
-                old_pos = font->reader->cur;
-                if(end_char >= c){
-                    MT_READER_SKIP(font->reader, seg_count*2);
-                    start_char = mt_reader_read_short(font->reader);
-#if MT_DEBUG
-                    printf("mibitype: start_char: %lx, end_char: %lx\n",
-                           start_char, end_char);
-#endif
-                    if(start_char > c){
-                        /* This segment doesn't contain this char, go back */
-                        MT_READER_JMP(font->reader, old_pos);
-                    }else{
-                        /* The char is in this segment, get the index */
-                        MT_READER_SKIP(font->reader, seg_count*2-2);
-                        delta = mt_reader_read_short(font->reader);
+    return lookup;
+}
 
-                        MT_READER_SKIP(font->reader, seg_count*2-2);
-                        offset = mt_reader_read_short(font->reader);
+void _mt_ttf_free_pair_lookup(MTTTFPairLookup *lookup) {
+    size_t i;
 
-#if MT_DEBUG
-                        printf("mibitype: Segment found: start_char: %lx, "
-                               "end_char: %lx, delta: %lx, offset: %lx\n",
-                               start_char, end_char, delta, offset);
-#endif
-                        if(offset){
-                            MT_READER_SKIP(font->reader,
-                                           offset+2*(c-start_char)-2);
-                            return delta+mt_reader_read_short(font->reader);
-                        }else{
-                            return (delta+c)&0xFFFF;
-                        }
-                    }
-                }
-#if MT_DEBUG
-                else{
-                    printf("mibitype: end_char: %lx\n", end_char);
-                }
-#endif
-            }
-#if MT_DEBUG
-            puts("mibitype: NO CORRESPONDING GLYPH ID FOUND!");
-            return 0;
-#endif
-        }else if(ttf->cmap.format == 12){
-            for(i=0;i<ttf->cmap.group_num;i++){
-                start_char = mt_reader_read_int(font->reader);
-                end_char = mt_reader_read_int(font->reader);
-                start_index = mt_reader_read_int(font->reader);
-                if(c >= start_char && c <= end_char){
-#if MT_DEBUG
-                    puts("mibitype: Using table 12!");
-#endif
-                    return c-start_char+start_index;
-                }
-            }
-        }
-    }
+    mt_map_free(&lookup->pairs);
+    free(lookup->left);
 
-#if MT_DEBUG
-    puts("mibitype: NO SUPPORTED CMAP TABLE FOUND!");
-#endif
-    return c;
+    for(i=0;i<lookup->class_num;i++){
+        free(lookup->classes[i].coverage);
+        free(lookup->classes[i].values);
+    }
+    free(lookup->classes);
 }
 
-void _mt_ttf_load_glyph_info(MTTTF *ttf, MTFont *font, MTGlyph *glyph,
-                             size_t id, int load_sizes, int load_metrics) {
-    /* Load the glyph description. It is made up of:
-     * int16 the number of contours (useful to know if it is a simple glyph).
-     * int16 the minimum X coordinate.
-     * int16 the minimum Y coordinate.
-     * int16 the maximum X coordinate.
-     * int16 the maximum Y coordinate.
-     */
+int _mt_ttf_add_pair(MTTTF *ttf, MTTTFPairLookup *lookup, size_t left,
+                     size_t right, int value, int add) {
+    size_t *old;
+    size_t key = (left<<16)|right;
 
-    size_t old_pos;
+    if(left >= ttf->glyph_num || right >= ttf->glyph_num) return MT_E_NONE;
 
-    if(ttf->long_offsets){
-        MT_READER_JMP(font->reader, ttf->loca_table_pos+id*4);
-        MT_READER_JMP(font->reader, ttf->glyf_table_pos+
-                                    mt_reader_read_int(font->reader));
-    }else{
-        MT_READER_JMP(font->reader, ttf->loca_table_pos+id*2);
-        MT_READER_JMP(font->reader, ttf->glyf_table_pos+
-                                    mt_reader_read_short(font->reader)*2);
+    old = mt_map_get(&lookup->pairs, key);
+    if(old != NULL){
+        /* The values of the subtables of the kern table add up, while the
+         * first GPOS subtable that contains a pair wins. */
+        if(!add) return MT_E_NONE;
+        value += MT_TTF_EXTEND_SIGN(*old, 16);
     }
 
-    ttf->added_contours = mt_reader_read_short(font->reader);
-    if(load_sizes){
-        glyph->xmin = mt_reader_read_short(font->reader);
-        glyph->ymin = mt_reader_read_short(font->reader);
-        glyph->xmax = mt_reader_read_short(font->reader);
-        glyph->ymax = mt_reader_read_short(font->reader);
-
-        glyph->xmin = MT_TTF_EXTEND_SIGN(glyph->xmin, 16);
-        glyph->ymin = MT_TTF_EXTEND_SIGN(glyph->ymin, 16);
-        glyph->xmax = MT_TTF_EXTEND_SIGN(glyph->xmax, 16);
-        glyph->ymax = MT_TTF_EXTEND_SIGN(glyph->ymax, 16);
-    }else{
-        MT_READER_SKIP(font->reader, 4*2);
-    }
+    MT_TTF_BIT_SET(lookup->left, left);
 
-    if(load_metrics){
-        old_pos = font->reader->cur;
-        if(id < ttf->advance_width_num){
-            MT_READER_JMP(font->reader, ttf->htmx_table_pos+4*id);
-            glyph->advance_width = mt_reader_read_short(font->reader);
-        }else{
-            MT_READER_JMP(font->reader, ttf->htmx_table_pos+4*
-                          (ttf->advance_width_num-1));
-            glyph->advance_width = mt_reader_read_short(font->reader);
-            MT_READER_JMP(font->reader, ttf->htmx_table_pos+4*
-                          ttf->advance_width_num+
-                          (id-ttf->advance_width_num)*2);
-        }
-        glyph->left_side_bearing = mt_reader_read_short(font->reader);
-        glyph->left_side_bearing = MT_TTF_EXTEND_SIGN(glyph->left_side_bearing,
-                                                      16);
-        MT_READER_JMP(font->reader, old_pos);
-    }
+    return mt_map_set(&lookup->pairs, key, value&0xFFFF);
 }
 
-int _mt_ttf_load_simple_glyph(MTTTF *ttf, MTFont *font, MTGlyph *glyph) {
-    /* Simple glyphs are stored as following:
-     * uint16 x contour_num is an array containing indices of the last
-     *                      points of a contour.
-     * uint16 the number of instruction (IDK what they are for).
-     * uint16 x instruction_num the instruction (IDK what they are for).
-     * uint16 x (depending on the flags) an array of flags.
-     * uint8/uint16 x the number of points X coordinates of the points.
-     * uint8/uint16 x the number of points Y coordinates of the points.
-     * the coordinates are relative to the previous point or (0;0) for the
-     * first point.
+int _mt_ttf_load_kern(MTTTF *ttf, MTFont *font) {
+    /* The kern table (the Microsoft version) is made up of:
+     * uint16 the version (0).
+     * uint16 the number of subtables.
+     * Each subtable starts with:
+     * uint16 the version of the subtable.
+     * uint16 the length of the subtable.
+     * uint16 the coverage, the format is in the high byte, bit 0 is set for
+     *        horizontal kerning, bit 1 for minimum values and bit 2 for cross
+     *        stream kerning.
+     * Format 0 subtables then contain:
+     * uint16 the number of pairs.
+     * uint16 x 3 informations for binary searches.
+     * The pairs, made up of two uint16 glyph ids and an int16 value.
      */
 
+    MTView kern;
+
+    MTTTFPairLookup *lookup;
+
     size_t i, n;
+    size_t pos;
 
-    const size_t new_contour_num = glyph->contour_num+ttf->added_contours;
-    const size_t previous_point_num = glyph->contour_num ?
-                                    glyph->contour_ends[glyph->contour_num-1]+
-                                    1 : 0;
+    size_t table_num;
+    size_t length;
+    unsigned short int coverage;
+    size_t pair_num;
 
-    unsigned short int point_num, instruction_num;
+    size_t offset;
 
-    unsigned char flag, count;
-    short int value;
+    int rc;
 
-    int x, y;
+    if(_mt_ttf_get_table_pos(ttf, MT_TTF_KERN, &offset)){
+        /* Kerning is optional. */
+        return MT_E_NONE;
+    }
 
-    void *new;
+    /* A corrupted kern table only makes us lose kerning, running out of
+     * memory is the only fatal error. */
+    if((rc = _mt_ttf_get_table_view(ttf, font, MT_TTF_KERN, &kern))){
+        return rc == MT_E_OUT_OF_MEM ? rc : MT_E_NONE;
+    }
 
-    if(!new_contour_num) return MT_E_NONE;
+    /* Apple kern tables have another header, they are not supported. */
+    if(kern.size < 4 || MT_VIEW_U16(&kern, 0)) return MT_E_NONE;
 
-    new = realloc(glyph->contour_ends, new_contour_num*sizeof(size_t));
-    if(new == NULL) return MT_E_OUT_OF_MEM;
-    glyph->contour_ends = new;
+    /* All the pairs of the kern table are stored as a single lookup. */
+    lookup = _mt_ttf_add_pair_lookup(ttf);
+    if(lookup == NULL) return MT_E_OUT_OF_MEM;
 
-    for(i=glyph->contour_num;i<new_contour_num;i++){
-        glyph->contour_ends[i] = mt_reader_read_short(font->reader);
-    }
+    table_num = MT_VIEW_U16(&kern, 2);
 
-    /* Skip all the instruction stuff for now. */
-    instruction_num = mt_reader_read_short(font->reader);
-    MT_READER_SKIP(font->reader, instruction_num);
+    /* The pairs of a subtable are only added once it was checked, and we
+     * stop at the first corrupted subtable, keeping the previous ones. */
+    for(i=0,pos=4;i<table_num;i++,pos+=length){
+        if(!MT_VIEW_HAS(&kern, pos, 6)) break;
 
-    /* Read the points and flags. */
-    point_num = glyph->contour_ends[new_contour_num-1]+1;
+        length = MT_VIEW_U16(&kern, pos+2);
+        coverage = MT_VIEW_U16(&kern, pos+4);
 
 #if MT_DEBUG
-    printf("mibitype: Point num: %d\n", point_num);
-    printf("mibitype: cur: %016lx\n", font->reader->cur);
+        printf("mibitype: Kerning subtable format %d, coverage %02x\n",
+               coverage>>8, coverage&0xFF);
 #endif
 
-    if(point_num > ttf->simple_points_max) return MT_E_CORRUPTED;
+        /* Only use horizontal kerning values of format 0 subtables. */
+        if((coverage>>8) || (coverage&0x7) != 1){
+            if(length < 6) break;
+            continue;
+        }
 
-    for(i=0;i<point_num;i++){
-        flag = mt_reader_read_char(font->reader);
-        ttf->flags[i] = flag;
+        if(!MT_VIEW_HAS(&kern, pos+6, 4*2)) break;
+        pair_num = MT_VIEW_U16(&kern, pos+6);
 
-        if(flag&(1<<3)){
-            count = mt_reader_read_char(font->reader);
-            for(n=0;n<count;n++){
-                if(i+1 >= point_num){
-#if MT_DEBUG
-                    puts("mibitype: Too many flags!");
-#endif
-                    break;
-                }
-                ttf->flags[++i] = flag;
+        /* The length may have overflowed in fonts with a lot of pairs, so
+         * the number of pairs is used to check the size of the subtable. */
+        if(!MT_VIEW_HAS(&kern, pos+14, pair_num*6)) break;
+
+        for(n=0;n<pair_num;n++){
+            if((rc = _mt_ttf_add_pair(ttf, lookup,
+                                      MT_VIEW_U16(&kern, pos+14+n*6),
+                                      MT_VIEW_U16(&kern, pos+14+n*6+2),
+                                      MT_VIEW_S16(&kern, pos+14+n*6+4), 1))){
+                return rc;
             }
         }
+
+        if(length < 14+pair_num*6) length = 14+pair_num*6;
     }
 
 #if MT_DEBUG
-    for(i=0;i<point_num;i++){
-        printf("mibitype: cur: %016lx. Flag %ld: %02x\n", font->reader->cur,
-               i+1, ttf->flags[i]);
-    }
+    printf("mibitype: %lu kerning pairs\n", lookup->pairs.num);
 #endif
 
-    new = realloc(glyph->points, (previous_point_num+point_num)*
-                  sizeof(MTPoint));
-    if(new == NULL) return MT_E_OUT_OF_MEM;
-    glyph->points = new;
+    return MT_E_NONE;
+}
 
-    /* Load the X coordinates and set if the point is on the curve. */
-    x = 0;
-    y = 0;
+int _mt_ttf_load_coverage(MTTTF *ttf, MTView *table, size_t pos,
+                          unsigned char *bitset, unsigned short int *glyphs,
+                          size_t glyph_max) {
+    /* Coverage tables list glyphs, the index of a glyph in the list is its
+     * coverage index. They are made up of:
+     * uint16 the format.
+     * Format 1:
+     * uint16 the number of glyphs.
+     * uint16 x the number of glyphs the glyph ids.
+     * Format 2:
+     * uint16 the number of ranges.
+     * The ranges, made up of the uint16 first and last glyph ids and the
+     * uint16 coverage index of the first glyph.
+     * The glyphs are set in bitset if it isn't NULL, and the glyph with the
+     * coverage index i is stored in glyphs[i] for i < glyph_max. */
 
-    for(n=previous_point_num,i=0;i<point_num;n++,i++){
-        glyph->points[n].on_curve = ttf->flags[i]&1;
-        if(ttf->flags[i]&(1<<1)){
-            /* The X coordinate is a single byte long */
-            value = mt_reader_read_char(font->reader);
-            if(!(ttf->flags[i]&(1<<4))) value = -value;
-#if MT_DEBUG
-            printf("mibitype: cur: %016lx. X (1 byte) coordinate offset: %d\n",
-                   font->reader->cur, value);
-#endif
-            x += value;
-        }else if(!(ttf->flags[i]&(1<<4))){
-            /* The X coordinate is two bytes long */
-            value = mt_reader_read_short(font->reader);
-#if MT_DEBUG
-            printf("mibitype: cur: %016lx. X (2 bytes) coordinate offset: "
-                   "%d\n", font->reader->cur, value);
-#endif
-            x += value;
+    size_t i, n;
+    size_t num;
+    size_t index;
+
+    unsigned short int glyph, first, last;
+
+    if(!MT_VIEW_HAS(table, pos, 2*2)) return MT_E_CORRUPTED;
+
+    num = MT_VIEW_U16(table, pos+2);
+
+    if(MT_VIEW_U16(table, pos) == 1){
+        if(!MT_VIEW_HAS(table, pos+4, num*2)) return MT_E_CORRUPTED;
+
+        for(i=0;i<num;i++){
+            glyph = MT_VIEW_U16(table, pos+4+i*2);
+            if(glyph >= ttf->glyph_num) continue;
+
+            if(bitset != NULL) MT_TTF_BIT_SET(bitset, glyph);
+            if(i < glyph_max) glyphs[i] = glyph;
         }
-#if MT_DEBUG
-        else{
-            printf("mibitype: cur: %016lx. Repeated X coordinate.\n",
-                   font->reader->cur);
+    }else if(MT_VIEW_U16(table, pos) == 2){
+        if(!MT_VIEW_HAS(table, pos+4, num*3*2)) return MT_E_CORRUPTED;
+
+        for(i=0;i<num;i++){
+            first = MT_VIEW_U16(table, pos+4+i*6);
+            last = MT_VIEW_U16(table, pos+4+i*6+2);
+            index = MT_VIEW_U16(table, pos+4+i*6+4);
+
+            if(last >= ttf->glyph_num) last = ttf->glyph_num-1;
+
+            for(n=first;n<=last;n++,index++){
+                if(bitset != NULL) MT_TTF_BIT_SET(bitset, n);
+                if(index < glyph_max) glyphs[index] = n;
+            }
         }
-#endif
-        glyph->points[n].x = x;
+    }else{
+        return MT_E_CORRUPTED;
     }
 
-    /* Load the Y coordinates. */
-    for(n=previous_point_num,i=0;i<point_num;n++,i++){
-        if(ttf->flags[i]&(1<<2)){
-            /* The Y coordinate is a single byte long */
-            value = mt_reader_read_char(font->reader);
-            if(!(ttf->flags[i]&(1<<5))) value = -value;
-#if MT_DEBUG
-            printf("mibitype: cur: %016lx. Y (1 byte) coordinate offset: %d\n",
-                   font->reader->cur, value);
-#endif
-            y += value;
-        }else if(!(ttf->flags[i]&(1<<5))){
-            /* The Y coordinate is two bytes long */
-            value = mt_reader_read_short(font->reader);
+    return MT_E_NONE;
+}
+
+unsigned short int *_mt_ttf_load_class_def(MTTTF *ttf, MTView *table,
+                                           size_t pos, int *rc) {
+    /* Class definition tables give a class to glyphs, glyphs that are not
+     * listed are in class 0. They are made up of:
+     * uint16 the format.
+     * Format 1:
+     * uint16 the first glyph id.
+     * uint16 the number of glyphs.
+     * uint16 x the number of glyphs the classes of the glyphs.
+     * Format 2:
+     * uint16 the number of ranges.
+     * The ranges, made up of the uint16 first and last glyph ids and the
+     * uint16 class.
+     * They are decoded to an array containing the class of each glyph id.
+     * Subtables often share them, so the decoded tables are kept in
+     * class_defs and reused. */
+
+    unsigned short int *classes;
+    unsigned short int **new;
+
+    size_t *cached;
+
+    size_t i, n;
+    size_t num;
+    size_t first, last;
+
+    *rc = MT_E_NONE;
+
+    cached = mt_map_get(&ttf->class_def_map, pos);
+    if(cached != NULL) return ttf->class_defs[*cached];
+
+    *rc = MT_E_CORRUPTED;
+    if(!MT_VIEW_HAS(table, pos, 2*2)) return NULL;
+
+    *rc = MT_E_OUT_OF_MEM;
+    classes = calloc(ttf->glyph_num, sizeof(unsigned short int));
+    if(classes == NULL) return NULL;
+
+    new = realloc(ttf->class_defs, (ttf->class_def_num+1)*
+                                   sizeof(unsigned short int*));
+    if(new == NULL){
+        free(classes);
+        return NULL;
+    }
+    ttf->class_defs = new;
+    ttf->class_defs[ttf->class_def_num++] = classes;
+
+    if(mt_map_set(&ttf->class_def_map, pos, ttf->class_def_num-1)){
+        return NULL;
+    }
+
+    *rc = MT_E_CORRUPTED;
+
+    if(MT_VIEW_U16(table, pos) == 1){
+        if(!MT_VIEW_HAS(table, pos+2, 2*2)) return NULL;
+
+        first = MT_VIEW_U16(table, pos+2);
+        num = MT_VIEW_U16(table, pos+4);
+        if(!MT_VIEW_HAS(table, pos+6, num*2)) return NULL;
+
+        for(i=0;i<num && first+i<ttf->glyph_num;i++){
+            classes[first+i] = MT_VIEW_U16(table, pos+6+i*2);
+        }
+    }else if(MT_VIEW_U16(table, pos) == 2){
+        num = MT_VIEW_U16(table, pos+2);
+        if(!MT_VIEW_HAS(table, pos+4, num*3*2)) return NULL;
+
+        for(i=0;i<num;i++){
+            first = MT_VIEW_U16(table, pos+4+i*6);
+            last = MT_VIEW_U16(table, pos+4+i*6+2);
+
+            if(last >= ttf->glyph_num) last = ttf->glyph_num-1;
+
+            for(n=first;n<=last;n++){
+                classes[n] = MT_VIEW_U16(table, pos+4+i*6+4);
+            }
+        }
+    }else{
+        return NULL;
+    }
+
+    *rc = MT_E_NONE;
+
+    return classes;
+}
+
+size_t _mt_ttf_value_size(unsigned short int format) {
+    /* Each bit of the format adds an uint16 to the value record. */
+    size_t size = 0;
+
+    for(;format;format>>=1) size += (format&1)*2;
+
+    return size;
+}
+
+size_t _mt_ttf_x_advance_pos(unsigned short int format) {
+    /* The X advance comes after the X and Y placements. */
+    return _mt_ttf_value_size(format&0x3);
+}
+
+int _mt_ttf_load_pair_pos1(MTTTF *ttf, MTView *gpos, size_t pos,
+                           MTTTFPairLookup *lookup) {
+    /* PairPos format 1 subtables list the pairs one by one:
+     * uint16 the format (1).
+     * uint16 the offset of the coverage table, that lists the first glyphs.
+     * uint16 the format of the value records of the first glyphs.
+     * uint16 the format of the value records of the second glyphs.
+     * uint16 the number of pair sets, one for each covered glyph.
+     * uint16 x the number of pair sets the offsets of the pair sets.
+     * Each pair set is made up of:
+     * uint16 the number of pairs.
+     * The pairs, made up of the uint16 second glyph id and the two value
+     * records. */
+
+    unsigned short int *glyphs;
+
+    unsigned short int format1, format2;
+    size_t set_num;
+    size_t record_size;
+    size_t advance_pos;
+
+    size_t i, n;
+    size_t set;
+    size_t pair_num;
+
+    int rc;
+
+    if(!MT_VIEW_HAS(gpos, pos, 5*2)) return MT_E_CORRUPTED;
+
+    format1 = MT_VIEW_U16(gpos, pos+4);
+    format2 = MT_VIEW_U16(gpos, pos+6);
+    set_num = MT_VIEW_U16(gpos, pos+8);
+
+    if(!MT_VIEW_HAS(gpos, pos+10, set_num*2)) return MT_E_CORRUPTED;
+
+    /* We only need the X advance of the first glyph. */
+    if(!(format1&0x4)) return MT_E_NONE;
+
+    record_size = 2+_mt_ttf_value_size(format1)+_mt_ttf_value_size(format2);
+    advance_pos = 2+_mt_ttf_x_advance_pos(format1);
+
+    glyphs = malloc(set_num*sizeof(unsigned short int));
+    if(set_num && glyphs == NULL) return MT_E_OUT_OF_MEM;
+
+    for(i=0;i<set_num;i++) glyphs[i] = 0xFFFF;
+
+    if((rc = _mt_ttf_load_coverage(ttf, gpos, pos+MT_VIEW_U16(gpos, pos+2),
+                                   NULL, glyphs, set_num))){
+        free(glyphs);
+        return rc;
+    }
+
+    for(i=0;i<set_num;i++){
+        if(glyphs[i] == 0xFFFF) continue;
+
+        set = pos+MT_VIEW_U16(gpos, pos+10+i*2);
+
+        if(!MT_VIEW_HAS(gpos, set, 2)) break;
+        pair_num = MT_VIEW_U16(gpos, set);
+        if(!MT_VIEW_HAS(gpos, set+2, pair_num*record_size)) break;
+
+        /* A class subtable that comes before covers this glyph. */
+        for(n=0;n<lookup->class_num;n++){
+            if(MT_TTF_BIT_GET(lookup->classes[n].coverage, glyphs[i])) break;
+        }
+        if(n < lookup->class_num) continue;
+
+        for(n=0;n<pair_num;n++){
+            if((rc = _mt_ttf_add_pair(ttf, lookup, glyphs[i],
+                                      MT_VIEW_U16(gpos,
+                                                  set+2+n*record_size),
+                                      MT_VIEW_S16(gpos,
+                                                  set+2+n*record_size+
+                                                  advance_pos), 0))){
+                free(glyphs);
+                return rc;
+            }
+        }
+    }
+
+    free(glyphs);
+
+    return i < set_num ? MT_E_CORRUPTED : MT_E_NONE;
+}
+
+int _mt_ttf_load_pair_pos2(MTTTF *ttf, MTView *gpos, size_t pos,
+                           MTTTFPairLookup *lookup) {
+    /* PairPos format 2 subtables give the values for pairs of classes:
+     * uint16 the format (2).
+     * uint16 the offset of the coverage table, that lists the first glyphs.
+     * uint16 the format of the value records of the first glyphs.
+     * uint16 the format of the value records of the second glyphs.
+     * uint16 the offset of the class definitions of the first glyphs.
+     * uint16 the offset of the class definitions of the second glyphs.
+     * uint16 the number of classes of the first glyphs.
+     * uint16 the number of classes of the second glyphs.
+     * The two value records of each pair of classes, as a matrix indexed by
+     * the class of the first glyph and then by the class of the second
+     * glyph. */
+
+    MTTTFPairClasses *new;
+    MTTTFPairClasses *classes;
+
+    unsigned short int format1, format2;
+    size_t record_size;
+    size_t advance_pos;
+
+    size_t i;
+    size_t value_num;
+
+    int rc;
+
+    if(!MT_VIEW_HAS(gpos, pos, 8*2)) return MT_E_CORRUPTED;
+
+    format1 = MT_VIEW_U16(gpos, pos+4);
+    format2 = MT_VIEW_U16(gpos, pos+6);
+
+    record_size = _mt_ttf_value_size(format1)+_mt_ttf_value_size(format2);
+    advance_pos = _mt_ttf_x_advance_pos(format1);
+
+    new = realloc(lookup->classes, (lookup->class_num+1)*
+                                   sizeof(MTTTFPairClasses));
+    if(new == NULL) return MT_E_OUT_OF_MEM;
+    lookup->classes = new;
+
+    classes = lookup->classes+lookup->class_num;
+    classes->class1_num = MT_VIEW_U16(gpos, pos+12);
+    classes->class2_num = MT_VIEW_U16(gpos, pos+14);
+    classes->values = NULL;
+
+    classes->coverage = calloc((ttf->glyph_num+7)/8, 1);
+    if(classes->coverage == NULL) return MT_E_OUT_OF_MEM;
+
+    /* The entry is complete enough to be freed from here. */
+    lookup->class_num++;
+
+    value_num = classes->class1_num*classes->class2_num;
+    if(!MT_VIEW_HAS(gpos, pos+16, value_num*record_size)){
+        return MT_E_CORRUPTED;
+    }
+
+    if((rc = _mt_ttf_load_coverage(ttf, gpos, pos+MT_VIEW_U16(gpos, pos+2),
+                                   classes->coverage, NULL, 0))){
+        return rc;
+    }
+
+    classes->class1 = _mt_ttf_load_class_def(ttf, gpos,
+                                             pos+MT_VIEW_U16(gpos, pos+8),
+                                             &rc);
+    if(rc) return rc;
+    classes->class2 = _mt_ttf_load_class_def(ttf, gpos,
+                                             pos+MT_VIEW_U16(gpos, pos+10),
+                                             &rc);
+    if(rc) return rc;
+
+    classes->values = malloc(value_num*sizeof(short int));
+    if(value_num && classes->values == NULL) return MT_E_OUT_OF_MEM;
+
+    for(i=0;i<value_num;i++){
+        classes->values[i] = format1&0x4 ?
+                             MT_VIEW_S16(gpos, pos+16+i*record_size+
+                                               advance_pos) : 0;
+    }
+
+    return MT_E_NONE;
+}
+
+int _mt_ttf_find_lookups(MTView *table, const unsigned long int *tags,
+                         size_t tag_num, unsigned char **used,
+                         size_t *lookups, size_t *lookup_num) {
+    /* GPOS and GSUB start with:
+     * uint16 x 2 the version.
+     * uint16 the offset of the script list.
+     * uint16 the offset of the feature list.
+     * uint16 the offset of the lookup list.
+     * The feature list contains the number of features and their records,
+     * made up of a tag and the offset of the feature, that contains the
+     * offset of its parameters, and the number and the indices of the lookups
+     * it uses.
+     * The lookup list contains the number of lookups and their offsets.
+     * used is set to an array telling if each lookup is used by one of the
+     * features, whatever the script. */
+
+    size_t features;
+    size_t feature_num;
+
+    size_t i, n;
+
+    size_t feature;
+    size_t index_num;
+    size_t index;
+
+    if(table->size < 5*2) return MT_E_CORRUPTED;
+
+    features = MT_VIEW_U16(table, 6);
+    *lookups = MT_VIEW_U16(table, 8);
+
+    if(!MT_VIEW_HAS(table, features, 2) || !MT_VIEW_HAS(table, *lookups, 2)){
+        return MT_E_CORRUPTED;
+    }
+
+    feature_num = MT_VIEW_U16(table, features);
+    *lookup_num = MT_VIEW_U16(table, *lookups);
+
+    if(!MT_VIEW_HAS(table, features+2, feature_num*6) ||
+       !MT_VIEW_HAS(table, *lookups+2, *lookup_num*2)){
+        return MT_E_CORRUPTED;
+    }
+
+    *used = calloc(*lookup_num+1, 1);
+    if(*used == NULL) return MT_E_OUT_OF_MEM;
+
+    for(i=0;i<feature_num;i++){
+        for(n=0;n<tag_num;n++){
+            if(MT_VIEW_U32(table, features+2+i*6) == tags[n]) break;
+        }
+        if(n == tag_num) continue;
+
+        feature = features+MT_VIEW_U16(table, features+2+i*6+4);
+        if(!MT_VIEW_HAS(table, feature, 2*2)) continue;
+
+        index_num = MT_VIEW_U16(table, feature+2);
+        if(!MT_VIEW_HAS(table, feature+4, index_num*2)) continue;
+
+        for(n=0;n<index_num;n++){
+            index = MT_VIEW_U16(table, feature+4+n*2);
+            if(index < *lookup_num) (*used)[index] = 1;
+        }
+    }
+
+    return MT_E_NONE;
+}
+
+int _mt_ttf_get_lookup(MTView *table, size_t lookups, size_t i,
+                       unsigned short int *type, size_t *pos,
+                       size_t *subtable_num) {
+    /* Each lookup contains its type, its flags and the number and the offsets
+     * of its subtables. */
+
+    *pos = lookups+MT_VIEW_U16(table, lookups+2+i*2);
+    if(!MT_VIEW_HAS(table, *pos, 3*2)) return MT_E_CORRUPTED;
+
+    *type = MT_VIEW_U16(table, *pos);
+    *subtable_num = MT_VIEW_U16(table, *pos+4);
+    if(!MT_VIEW_HAS(table, *pos+6, *subtable_num*2)) return MT_E_CORRUPTED;
+
+    return MT_E_NONE;
+}
+
+int _mt_ttf_get_subtable(MTView *table, size_t lookup, size_t n,
+                         unsigned short int extension,
+                         unsigned short int *type, size_t *subtable) {
+    /* Extension subtables contain the format (1), the type of the lookup and
+     * the 32 bit offset of the real subtable. type is set to the type of the
+     * real subtable. */
+
+    *subtable = lookup+MT_VIEW_U16(table, lookup+6+n*2);
+
+    if(*type == extension){
+        if(!MT_VIEW_HAS(table, *subtable, 4*2)) return MT_E_CORRUPTED;
+
+        *type = MT_VIEW_U16(table, *subtable+2);
+        *subtable += MT_VIEW_U32(table, *subtable+4);
+    }
+
+    if(!MT_VIEW_HAS(table, *subtable, 2)) return MT_E_CORRUPTED;
+
+    return MT_E_NONE;
+}
+
+int _mt_ttf_load_gpos(MTTTF *ttf, MTFont *font) {
+    /* Only the pair adjustments of the lookups of the kern feature are
+     * used. */
+
+    const unsigned long int tags[1] = {
+        MT_TTF_TAG('k', 'e', 'r', 'n')
+    };
+
+    MTView gpos;
+
+    MTTTFPairLookup *lookup;
+
+    unsigned char *used;
+
+    size_t lookups;
+    size_t lookup_num;
+
+    size_t i, n;
+    size_t pos;
+
+    size_t subtable_num;
+    size_t subtable;
+    unsigned short int lookup_type;
+    unsigned short int type;
+
+    size_t offset;
+
+    int rc;
+
+    if(_mt_ttf_get_table_pos(ttf, MT_TTF_GPOS, &offset)) return MT_E_NONE;
+
+    /* Corrupted lookups are dropped and a table that can't be read at all
+     * only makes us lose kerning, running out of memory is the only fatal
+     * error. */
+    if((rc = _mt_ttf_get_table_view(ttf, font, MT_TTF_GPOS, &gpos))){
+        return rc == MT_E_OUT_OF_MEM ? rc : MT_E_NONE;
+    }
+
+    if((rc = _mt_ttf_find_lookups(&gpos, tags, 1, &used, &lookups,
+                                  &lookup_num))){
+        return rc == MT_E_OUT_OF_MEM ? rc : MT_E_NONE;
+    }
+
+    /* Lookups are applied in the order of the lookup list. */
+    for(i=0;i<lookup_num && !rc;i++){
+        if(!used[i]) continue;
+
+        if(_mt_ttf_get_lookup(&gpos, lookups, i, &lookup_type, &pos,
+                              &subtable_num)){
+            continue;
+        }
+
+        /* Only pair adjustments (type 2), that may be in extension subtables
+         * (type 9), are supported. */
+        if(lookup_type != 2 && lookup_type != 9) continue;
+
+        lookup = _mt_ttf_add_pair_lookup(ttf);
+        if(lookup == NULL){
+            rc = MT_E_OUT_OF_MEM;
+            break;
+        }
+
+        for(n=0;n<subtable_num && !rc;n++){
+            type = lookup_type;
+            if((rc = _mt_ttf_get_subtable(&gpos, pos, n, 9, &type,
+                                          &subtable))){
+                break;
+            }
+            if(type != 2) continue;
+
+            if(MT_VIEW_U16(&gpos, subtable) == 1){
+                rc = _mt_ttf_load_pair_pos1(ttf, &gpos, subtable, lookup);
+            }else if(MT_VIEW_U16(&gpos, subtable) == 2){
+                rc = _mt_ttf_load_pair_pos2(ttf, &gpos, subtable, lookup);
+            }
+        }
+
+        if(rc && rc != MT_E_OUT_OF_MEM){
+            /* The pairs of the subtables before the corrupted one were
+             * already added, drop the whole lookup rather than only using a
+             * part of it. */
+#if MT_DEBUG
+            printf("mibitype: Pair lookup %lu is corrupted!\n", i);
+#endif
+            _mt_ttf_free_pair_lookup(lookup);
+            ttf->pair_lookup_num--;
+            rc = MT_E_NONE;
+            continue;
+        }
+
+#if MT_DEBUG
+        printf("mibitype: Pair lookup %lu: %lu pairs, %lu class subtables\n",
+               i, lookup->pairs.num, lookup->class_num);
+#endif
+    }
+
+    free(used);
+
+    /* The offsets of the class definitions are not needed anymore. */
+    mt_map_free(&ttf->class_def_map);
+
+    return rc;
+}
+
+void _mt_ttf_free_subst_lookup(MTTTFSubstLookup *lookup) {
+    free(lookup->substitutes);
+    mt_map_free(&lookup->trie);
+    free(lookup->ligatures);
+    free(lookup->first);
+}
+
+MTTTFSubstLookup *_mt_ttf_add_subst_lookup(MTTTF *ttf,
+                                           unsigned short int type) {
+    MTTTFSubstLookup *new;
+    MTTTFSubstLookup *lookup;
+
+    size_t i;
+
+    new = realloc(ttf->subst_lookups,
+                  (ttf->subst_lookup_num+1)*sizeof(MTTTFSubstLookup));
+    if(new == NULL) return NULL;
+    ttf->subst_lookups = new;
+
+    lookup = ttf->subst_lookups+ttf->subst_lookup_num;
+
+    lookup->type = type;
+    lookup->substitutes = NULL;
+    mt_map_init(&lookup->trie);
+    lookup->ligatures = NULL;
+    lookup->node_num = 0;
+    lookup->first = NULL;
+
+    ttf->subst_lookup_num++;
+
+    if(type == 1){
+        /* Glyphs that are not covered are substituted by themselves. */
+        lookup->substitutes = malloc(ttf->glyph_num*
+                                     sizeof(unsigned short int));
+        if(lookup->substitutes == NULL) return NULL;
+
+        for(i=0;i<ttf->glyph_num;i++) lookup->substitutes[i] = i;
+    }else{
+        lookup->first = calloc((ttf->glyph_num+7)/8, 1);
+        if(lookup->first == NULL) return NULL;
+
+        /* Add the root of the trie. */
+        lookup->ligatures = malloc(sizeof(MTTTFLigature));
+        if(lookup->ligatures == NULL) return NULL;
+
+        lookup->ligatures[0].order = MT_FONT_NONE;
+        lookup->node_num = 1;
+    }
+
+    return lookup;
+}
+
+int _mt_ttf_load_single_subst(MTTTF *ttf, MTView *gsub, size_t pos,
+                              MTTTFSubstLookup *lookup,
+                              unsigned char *covered) {
+    /* SingleSubst subtables are made up of:
+     * uint16 the format.
+     * uint16 the offset of the coverage table.
+     * Format 1:
+     * int16 the delta to add to the glyph ids.
+     * Format 2:
+     * uint16 the number of substitutes.
+     * uint16 x the number of substitutes the substitute of each covered
+     *          glyph, by coverage index.
+     * Glyphs already covered by a previous subtable of the lookup are in
+     * covered, they keep their substitute. */
+
+    unsigned short int *glyphs;
+    size_t glyph_num;
+
+    unsigned short int format;
+    int delta = 0;
+
+    size_t i;
+
+    int rc;
+
+    if(!MT_VIEW_HAS(gsub, pos, 3*2)) return MT_E_CORRUPTED;
+
+    format = MT_VIEW_U16(gsub, pos);
+
+    if(format == 1){
+        delta = MT_VIEW_S16(gsub, pos+4);
+        glyph_num = ttf->glyph_num;
+    }else if(format == 2){
+        glyph_num = MT_VIEW_U16(gsub, pos+4);
+        if(!MT_VIEW_HAS(gsub, pos+6, glyph_num*2)) return MT_E_CORRUPTED;
+    }else{
+        return MT_E_CORRUPTED;
+    }
+
+    glyphs = malloc(glyph_num*sizeof(unsigned short int));
+    if(glyph_num && glyphs == NULL) return MT_E_OUT_OF_MEM;
+
+    for(i=0;i<glyph_num;i++) glyphs[i] = 0xFFFF;
+
+    if((rc = _mt_ttf_load_coverage(ttf, gsub, pos+MT_VIEW_U16(gsub, pos+2),
+                                   NULL, glyphs, glyph_num))){
+        free(glyphs);
+        return rc;
+    }
+
+    for(i=0;i<glyph_num;i++){
+        if(glyphs[i] == 0xFFFF || MT_TTF_BIT_GET(covered, glyphs[i])){
+            continue;
+        }
+
+        MT_TTF_BIT_SET(covered, glyphs[i]);
+
+        if(format == 1){
+            lookup->substitutes[glyphs[i]] = (glyphs[i]+delta)&0xFFFF;
+        }else{
+            lookup->substitutes[glyphs[i]] = MT_VIEW_U16(gsub, pos+6+i*2);
+        }
+
+        /* Don't substitute glyphs by glyphs that don't exist. */
+        if(lookup->substitutes[glyphs[i]] >= ttf->glyph_num){
+            lookup->substitutes[glyphs[i]] = glyphs[i];
+        }
+    }
+
+    free(glyphs);
+
+    return MT_E_NONE;
+}
+
+int _mt_ttf_add_ligature(MTTTF *ttf, MTTTFSubstLookup *lookup,
+                         MTView *gsub, size_t pos, unsigned short int first,
+                         size_t order) {
+    /* Ligatures are made up of:
+     * uint16 the glyph of the ligature.
+     * uint16 the number of components, including the first one.
+     * uint16 x the number of components-1 the other components. */
+
+    MTTTFLigature *new;
+
+    size_t node = 0;
+    size_t *next;
+    size_t glyph;
+
+    size_t i;
+    size_t component_num;
+
+    if(!MT_VIEW_HAS(gsub, pos, 2*2)) return MT_E_CORRUPTED;
+
+    component_num = MT_VIEW_U16(gsub, pos+2);
+    if(!component_num) return MT_E_CORRUPTED;
+    if(!MT_VIEW_HAS(gsub, pos+4, (component_num-1)*2)){
+        return MT_E_CORRUPTED;
+    }
+
+    if(MT_VIEW_U16(gsub, pos) >= ttf->glyph_num) return MT_E_NONE;
+
+    for(i=0;i<component_num;i++){
+        glyph = i ? MT_VIEW_U16(gsub, pos+4+(i-1)*2) : first;
+        if(glyph >= ttf->glyph_num) return MT_E_NONE;
+
+        next = mt_map_get(&lookup->trie, (node<<16)|glyph);
+        if(next != NULL){
+            node = *next;
+            continue;
+        }
+
+        /* Add a new node, the number of nodes is doubled when it is a power
+         * of two. */
+        if(!(lookup->node_num&(lookup->node_num-1))){
+            new = realloc(lookup->ligatures, lookup->node_num*2*
+                                             sizeof(MTTTFLigature));
+            if(new == NULL) return MT_E_OUT_OF_MEM;
+            lookup->ligatures = new;
+        }
+
+        if(mt_map_set(&lookup->trie, (node<<16)|glyph, lookup->node_num)){
+            return MT_E_OUT_OF_MEM;
+        }
+
+        node = lookup->node_num++;
+        lookup->ligatures[node].order = MT_FONT_NONE;
+    }
+
+    /* The first ligature that matches is used. */
+    if(lookup->ligatures[node].order == MT_FONT_NONE){
+        lookup->ligatures[node].glyph = MT_VIEW_U16(gsub, pos);
+        lookup->ligatures[node].order = order;
+    }
+
+    MT_TTF_BIT_SET(lookup->first, first);
+
+    return MT_E_NONE;
+}
+
+int _mt_ttf_load_ligature_subst(MTTTF *ttf, MTView *gsub, size_t pos,
+                                MTTTFSubstLookup *lookup, size_t *order) {
+    /* LigatureSubst subtables are made up of:
+     * uint16 the format (1).
+     * uint16 the offset of the coverage table.
+     * uint16 the number of ligature sets, one for each covered glyph.
+     * uint16 x the number of ligature sets the offsets of the ligature sets.
+     * Each ligature set contains the number of ligatures starting with the
+     * glyph and their offsets. They are tried in order. */
+
+    unsigned short int *glyphs;
+
+    size_t set_num;
+    size_t set;
+    size_t ligature_num;
+
+    size_t i, n;
+
+    int rc = MT_E_NONE;
+
+    if(!MT_VIEW_HAS(gsub, pos, 3*2)) return MT_E_CORRUPTED;
+    if(MT_VIEW_U16(gsub, pos) != 1) return MT_E_CORRUPTED;
+
+    set_num = MT_VIEW_U16(gsub, pos+4);
+    if(!MT_VIEW_HAS(gsub, pos+6, set_num*2)) return MT_E_CORRUPTED;
+
+    glyphs = malloc(set_num*sizeof(unsigned short int));
+    if(set_num && glyphs == NULL) return MT_E_OUT_OF_MEM;
+
+    for(i=0;i<set_num;i++) glyphs[i] = 0xFFFF;
+
+    if((rc = _mt_ttf_load_coverage(ttf, gsub, pos+MT_VIEW_U16(gsub, pos+2),
+                                   NULL, glyphs, set_num))){
+        free(glyphs);
+        return rc;
+    }
+
+    for(i=0;i<set_num && !rc;i++){
+        if(glyphs[i] == 0xFFFF) continue;
+
+        set = pos+MT_VIEW_U16(gsub, pos+6+i*2);
+
+        if(!MT_VIEW_HAS(gsub, set, 2)){
+            rc = MT_E_CORRUPTED;
+            break;
+        }
+        ligature_num = MT_VIEW_U16(gsub, set);
+        if(!MT_VIEW_HAS(gsub, set+2, ligature_num*2)){
+            rc = MT_E_CORRUPTED;
+            break;
+        }
+
+        for(n=0;n<ligature_num && !rc;n++){
+            rc = _mt_ttf_add_ligature(ttf, lookup, gsub,
+                                      set+MT_VIEW_U16(gsub, set+2+n*2),
+                                      glyphs[i], (*order)++);
+        }
+    }
+
+    free(glyphs);
+
+    return rc;
+}
+
+int _mt_ttf_load_gsub(MTTTF *ttf, MTFont *font) {
+    /* The single substitutions and the ligatures of the lookups of the ccmp,
+     * liga and rlig features are compiled to substitution tables and tries,
+     * so that applying them doesn't need to go through the coverage
+     * tables. */
+
+    const unsigned long int tags[3] = {
+        MT_TTF_TAG('c', 'c', 'm', 'p'),
+        MT_TTF_TAG('l', 'i', 'g', 'a'),
+        MT_TTF_TAG('r', 'l', 'i', 'g')
+    };
+
+    MTView gsub;
+
+    MTTTFSubstLookup *lookup;
+
+    unsigned char *used;
+    unsigned char *covered;
+
+    size_t lookups;
+    size_t lookup_num;
+
+    size_t i, n;
+    size_t pos;
+
+    size_t subtable_num;
+    size_t subtable;
+    unsigned short int lookup_type;
+    unsigned short int type;
+
+    size_t order;
+
+    size_t offset;
+
+    int rc;
+
+    if(_mt_ttf_get_table_pos(ttf, MT_TTF_GSUB, &offset)) return MT_E_NONE;
+
+    /* Like for GPOS, corrupted lookups are dropped and running out of memory
+     * is the only fatal error. */
+    if((rc = _mt_ttf_get_table_view(ttf, font, MT_TTF_GSUB, &gsub))){
+        return rc == MT_E_OUT_OF_MEM ? rc : MT_E_NONE;
+    }
+
+    if((rc = _mt_ttf_find_lookups(&gsub, tags, 3, &used, &lookups,
+                                  &lookup_num))){
+        return rc == MT_E_OUT_OF_MEM ? rc : MT_E_NONE;
+    }
+
+    covered = malloc((ttf->glyph_num+7)/8);
+    if(covered == NULL){
+        free(used);
+        return MT_E_OUT_OF_MEM;
+    }
+
+    for(i=0;i<lookup_num && !rc;i++){
+        if(!used[i]) continue;
+
+        if(_mt_ttf_get_lookup(&gsub, lookups, i, &lookup_type, &pos,
+                              &subtable_num)){
+            continue;
+        }
+
+        /* Extension lookups (type 7) contain subtables of a single type. */
+        type = lookup_type;
+        if(type == 7 && subtable_num &&
+           _mt_ttf_get_subtable(&gsub, pos, 0, 7, &type, &subtable)){
+            continue;
+        }
+
+        /* Only single substitutions (type 1) and ligatures (type 4) are
+         * supported. */
+        if(type != 1 && type != 4) continue;
+
+        lookup = _mt_ttf_add_subst_lookup(ttf, type);
+        if(lookup == NULL){
+            rc = MT_E_OUT_OF_MEM;
+            break;
+        }
+
+        memset(covered, 0, (ttf->glyph_num+7)/8);
+        order = 0;
+
+        for(n=0;n<subtable_num && !rc;n++){
+            type = lookup_type;
+            if((rc = _mt_ttf_get_subtable(&gsub, pos, n, 7, &type,
+                                          &subtable))){
+                break;
+            }
+            if(type != lookup->type) continue;
+
+            if(type == 1){
+                rc = _mt_ttf_load_single_subst(ttf, &gsub, subtable, lookup,
+                                               covered);
+            }else{
+                rc = _mt_ttf_load_ligature_subst(ttf, &gsub, subtable,
+                                                 lookup, &order);
+            }
+        }
+
+        if(rc && rc != MT_E_OUT_OF_MEM){
+            /* Drop the whole lookup, it would only apply a part of its
+             * substitutions. */
+#if MT_DEBUG
+            printf("mibitype: Substitution lookup %lu is corrupted!\n", i);
+#endif
+            _mt_ttf_free_subst_lookup(lookup);
+            ttf->subst_lookup_num--;
+            rc = MT_E_NONE;
+            continue;
+        }
+
+#if MT_DEBUG
+        printf("mibitype: Substitution lookup %lu: type %d, %lu nodes\n", i,
+               lookup->type, lookup->node_num);
+#endif
+    }
+
+    free(covered);
+    free(used);
+
+    return rc;
+}
+
+int _mt_ttf_load_loca(MTTTF *ttf, MTFont *font) {
+    /* loca contains glyph_num+1 offsets in glyf, as uint16 (that need to be
+     * multiplied by two) or uint32 if long offsets are used. They are decoded
+     * once here to avoid going through loca each time a glyph is loaded. */
+
+    MTView loca;
+
+    size_t i;
+
+    int rc;
+
+    if((rc = _mt_ttf_get_table_view(ttf, font, MT_TTF_LOCA, &loca))){
+        return rc;
+    }
+
+    if(loca.size < ((size_t)ttf->glyph_num+1)*(ttf->long_offsets ? 4 : 2)){
+        return MT_E_CORRUPTED;
+    }
+
+    ttf->glyph_offsets = malloc(((size_t)ttf->glyph_num+1)*sizeof(size_t));
+    if(ttf->glyph_offsets == NULL) return MT_E_OUT_OF_MEM;
+
+    if(ttf->long_offsets){
+        for(i=0;i<=ttf->glyph_num;i++){
+            ttf->glyph_offsets[i] = MT_VIEW_U32(&loca, i*4);
+        }
+    }else{
+        for(i=0;i<=ttf->glyph_num;i++){
+            ttf->glyph_offsets[i] = (size_t)MT_VIEW_U16(&loca, i*2)*2;
+        }
+    }
+
+    /* Check that the offsets are in glyf once, so that we only need to check
+     * that they are increasing when loading a glyph. */
+    for(i=0;i<=ttf->glyph_num;i++){
+        if(ttf->glyph_offsets[i] > ttf->glyf.size) return MT_E_CORRUPTED;
+    }
+
+    return MT_E_NONE;
+}
+
+int mt_ttf_init(void *_data, void *_font) {
+    int rc;
+
+    MTTTF *ttf = _data;
+    MTFont *font = _font;
+
+    ttf->flags = NULL;
+    ttf->flag_buffer_size = 0;
+    ttf->table_dir = NULL;
+
+    ttf->contour_buffer = NULL;
+    ttf->point_buffer = NULL;
+    ttf->contour_buffer_size = 0;
+    ttf->point_buffer_size = 0;
+
+    ttf->cmap.format = 0;
+    ttf->cmap.end_codes = NULL;
+    ttf->cmap.groups = NULL;
+
+    ttf->glyph_offsets = NULL;
+
+    ttf->pair_lookups = NULL;
+    ttf->pair_lookup_num = 0;
+    ttf->class_defs = NULL;
+    ttf->class_def_num = 0;
+    mt_map_init(&ttf->class_def_map);
+
+    ttf->subst_lookups = NULL;
+    ttf->subst_lookup_num = 0;
+
+    if((rc = _mt_ttf_load_dir(ttf, font->reader, 0))) return rc;
+
+    if(_mt_ttf_get_table_pos(ttf, MT_TTF_MAXP, &ttf->maxp_table_pos)){
+        return MT_E_CORRUPTED;
+    }
+    if(_mt_ttf_get_table_pos(ttf, MT_TTF_CMAP, &ttf->cmap_table_pos)){
+        return MT_E_CORRUPTED;
+    }
+
+    if((rc = _mt_ttf_load_maxp(ttf, _font))) return rc;
+
+    if((rc = _mt_ttf_load_head(ttf, _font))) return rc;
+
+    if((rc = _mt_ttf_load_cmap(ttf, _font))) return rc;
+
+    if((rc = _mt_ttf_load_hhea(ttf, _font))) return rc;
+
+    if((rc = _mt_ttf_load_hmtx(ttf, _font))) return rc;
+
+    if((rc = _mt_ttf_load_gpos(ttf, _font))) return rc;
+
+    if((rc = _mt_ttf_load_gsub(ttf, _font))) return rc;
+
+    /* The kern table is only used by fonts that don't use GPOS for
+     * kerning. */
+    if(!ttf->pair_lookup_num && (rc = _mt_ttf_load_kern(ttf, _font))){
+        return rc;
+    }
+
+    /* Nothing else is needed if we don't load outlines. */
+    if(font->flags&MT_FONT_METRICS_ONLY) return MT_E_NONE;
+
+    if((rc = _mt_ttf_get_table_view(ttf, font, MT_TTF_GLYF, &ttf->glyf))){
+        return rc;
+    }
+
+    if((rc = _mt_ttf_load_loca(ttf, _font))) return rc;
+
+    /* Size the decoding buffers for the biggest glyph. */
+    if((rc = _mt_ttf_reserve(ttf,
+                             ttf->simple_contours_max >
+                             ttf->compound_contours_max ?
+                             ttf->simple_contours_max :
+                             ttf->compound_contours_max,
+                             ttf->simple_points_max >
+                             ttf->compound_points_max ?
+                             ttf->simple_points_max :
+                             ttf->compound_points_max,
+                             ttf->simple_points_max))){
+        return rc;
+    }
+
+    font->glyph_memory_max = ttf->point_buffer_size*2*sizeof(short int)+
+                             ttf->contour_buffer_size*
+                             sizeof(unsigned short int)+
+                             (ttf->point_buffer_size+7)/8;
+
+    return MT_E_NONE;
+}
+
+size_t _mt_ttf_cmap4_get_glyph_id(MTTTFCmap *cmap, size_t c) {
+    const unsigned short int *base = cmap->end_codes;
+
+    size_t n = cmap->seg_count;
+    size_t half;
+    size_t i;
+    size_t index;
+
+    unsigned short int id;
+
+    if(!n || c > 0xFFFF) return 0;
+
+    /* Find the first segment whose end code is greater or equal to c. The
+     * loop only contains a conditional move, which makes it a lot faster
+     * than a classic binary search on these small arrays. */
+    while(n > 1){
+        half = n/2;
+        base = base[half-1] < c ? base+half : base;
+        n -= half;
+    }
+    i = base-cmap->end_codes+(*base < c);
+
+    if(i >= cmap->seg_count || cmap->start_codes[i] > c) return 0;
+
+    if(!cmap->id_range_offsets[i]){
+        return (cmap->id_deltas[i]+c)&0xFFFF;
+    }
+
+    /* The offset is relative to the position of the offset in the id range
+     * offset array. */
+    index = cmap->id_range_offsets[i]/2+(c-cmap->start_codes[i])-
+            (cmap->seg_count-i);
+    if(index >= cmap->glyph_id_num) return 0;
+
+    id = cmap->glyph_ids[index];
+    if(!id) return 0;
+
+    return (cmap->id_deltas[i]+id)&0xFFFF;
+}
+
+size_t _mt_ttf_cmap12_get_glyph_id(MTTTFCmap *cmap, size_t c) {
+    const MTTTFCmapGroup *base = cmap->groups;
+
+    size_t n = cmap->group_num;
+    size_t half;
+
+    if(!n) return 0;
+
+    /* Find the first group whose end character is greater or equal to c,
+     * in the same way as for the format 4 segments. */
+    while(n > 1){
+        half = n/2;
+        base = base[half-1].end_char < c ? base+half : base;
+        n -= half;
+    }
+    if(base->end_char < c || base->start_char > c) return 0;
+
+    return c-base->start_char+base->start_index;
+}
+
+size_t mt_ttf_get_glyph_id(void *_data, void *_font, size_t c) {
+    MTTTF *ttf = _data;
+
+    (void)_font;
+
+    if(ttf->cmap.format == 4){
+        return _mt_ttf_cmap4_get_glyph_id(&ttf->cmap, c);
+    }else if(ttf->cmap.format == 12){
+        return _mt_ttf_cmap12_get_glyph_id(&ttf->cmap, c);
+    }
+
+#if MT_DEBUG
+    puts("mibitype: NO SUPPORTED CMAP TABLE FOUND!");
+#endif
+    return c;
+}
+
+int _mt_ttf_load_glyph_info(MTTTF *ttf, MTFont *font, MTGlyph *glyph,
+                            size_t id, int load_sizes, int load_metrics,
+                            MTTTFRecord *record) {
+    /* Load the glyph description. It is made up of:
+     * int16 the number of contours (useful to know if it is a simple glyph).
+     * int16 the minimum X coordinate.
+     * int16 the minimum Y coordinate.
+     * int16 the maximum X coordinate.
+     * int16 the maximum Y coordinate.
+     */
+
+    size_t start, end;
+
+    if(id >= ttf->glyph_num) return MT_E_CORRUPTED;
+
+    /* The offsets were checked to be in glyf. */
+    start = ttf->glyph_offsets[id];
+    end = ttf->glyph_offsets[id+1];
+
+    if(start > end) return MT_E_CORRUPTED;
+
+    if(load_metrics){
+        /* There are metrics for all the glyph ids. */
+        glyph->advance_width = font->metrics[id].advance_width;
+        glyph->left_side_bearing = font->metrics[id].left_side_bearing;
+    }
+
+    record->pos = start;
+    record->end = end;
+    record->contours = 0;
+
+    if(start == end){
+        /* The glyph has no outline. */
+        if(load_sizes){
+            glyph->xmin = 0;
+            glyph->ymin = 0;
+            glyph->xmax = 0;
+            glyph->ymax = 0;
+        }
+
+        return MT_E_NONE;
+    }
+
+    if(end-start < 5*2) return MT_E_CORRUPTED;
+
+    record->contours = MT_VIEW_U16(&ttf->glyf, start);
+    if(load_sizes){
+        glyph->xmin = MT_VIEW_S16(&ttf->glyf, start+2);
+        glyph->ymin = MT_VIEW_S16(&ttf->glyf, start+4);
+        glyph->xmax = MT_VIEW_S16(&ttf->glyf, start+6);
+        glyph->ymax = MT_VIEW_S16(&ttf->glyf, start+8);
+    }
+
+    record->pos = start+5*2;
+
+    return MT_E_NONE;
+}
+
+int _mt_ttf_load_simple_glyph(MTTTF *ttf, MTTTFRecord *record,
+                              MTTTFOutline *outline) {
+    /* Simple glyphs are stored as following:
+     * uint16 x contour_num is an array containing indices of the last
+     *                      points of a contour.
+     * uint16 the number of instruction (IDK what they are for).
+     * uint16 x instruction_num the instruction (IDK what they are for).
+     * uint16 x (depending on the flags) an array of flags.
+     * uint8/uint16 x the number of points X coordinates of the points.
+     * uint8/uint16 x the number of points Y coordinates of the points.
+     * the coordinates are relative to the previous point or (0;0) for the
+     * first point.
+     * The record was checked to be in the glyf table, so we only need to check
+     * that we stay in the record, once for each part of it.
+     */
+
+    const MTView *glyf = &ttf->glyf;
+
+    size_t i, n;
+
+    size_t pos = record->pos;
+    const size_t end = record->end;
+
+    const size_t new_contour_num = outline->contour_num+record->contours;
+    const size_t previous_point_num = outline->contour_num ?
+                                      outline->contour_ends[
+                                      outline->contour_num-1]+1 : 0;
+
+    size_t point_num;
+    unsigned short int instruction_num;
+
+    unsigned char flag, count;
+    size_t x_size, y_size;
+
+    int x, y;
+
+    int rc;
+
+    if(!record->contours) return MT_E_NONE;
+
+    if((size_t)record->contours*2+2 > end-pos) return MT_E_CORRUPTED;
+
+    if((rc = _mt_ttf_reserve(ttf, new_contour_num, 0, 0))) return rc;
+    outline->contour_ends = ttf->contour_buffer;
+
+    for(i=outline->contour_num;i<new_contour_num;i++,pos+=2){
+        outline->contour_ends[i] = MT_VIEW_U16(glyf, pos);
+
+        /* The contour ends must be increasing. */
+        if(i > outline->contour_num &&
+           outline->contour_ends[i] <= outline->contour_ends[i-1]){
+            return MT_E_CORRUPTED;
+        }
+    }
+
+    /* Skip all the instruction stuff for now. */
+    instruction_num = MT_VIEW_U16(glyf, pos);
+    pos += 2;
+    if(instruction_num > end-pos) return MT_E_CORRUPTED;
+    pos += instruction_num;
+
+    /* Read the points and flags. */
+    point_num = (size_t)outline->contour_ends[new_contour_num-1]+1;
+
 #if MT_DEBUG
-            printf("mibitype: cur: %016lx. Y (2 bytes) coordinate offset: "
-                   "%d\n", font->reader->cur, value);
+    printf("mibitype: Point num: %lu\n", (unsigned long int)point_num);
 #endif
-            y += value;
+
+    /* The contour ends are offset by the points of the previous components
+     * and the point count of the glyph is the last one plus one, so they all
+     * have to stay below 0xFFFF. */
+    if(previous_point_num+point_num > 0xFFFF) return MT_E_CORRUPTED;
+
+    if((rc = _mt_ttf_reserve(ttf, 0, 0, point_num))) return rc;
+
+    x_size = 0;
+    y_size = 0;
+
+    for(i=0;i<point_num;i++){
+        if(pos >= end) return MT_E_CORRUPTED;
+        flag = MT_VIEW_U8(glyf, pos++);
+        count = 0;
+
+        if(flag&(1<<3)){
+            if(pos >= end) return MT_E_CORRUPTED;
+            count = MT_VIEW_U8(glyf, pos++);
         }
+
+        for(n=0;n<=count;n++){
+            if(n && i+1 >= point_num){
 #if MT_DEBUG
-        else{
-            printf("mibitype: cur: %016lx. Repeated Y coordinate.\n",
-                   font->reader->cur);
+                puts("mibitype: Too many flags!");
+#endif
+                break;
+            }
+            if(n) i++;
+            ttf->flags[i] = flag;
+
+            /* Compute the size of the coordinates to check it at once. */
+            x_size += flag&(1<<1) ? 1 : flag&(1<<4) ? 0 : 2;
+            y_size += flag&(1<<2) ? 1 : flag&(1<<5) ? 0 : 2;
         }
+    }
+
+    if(x_size+y_size > end-pos) return MT_E_CORRUPTED;
+
+#if MT_DEBUG
+    for(i=0;i<point_num;i++){
+        printf("mibitype: Flag %ld: %02x\n", i+1, ttf->flags[i]);
+    }
 #endif
-        glyph->points[n].y = y;
+
+    if((rc = _mt_ttf_reserve(ttf, 0, previous_point_num+point_num, 0))){
+        return rc;
+    }
+    outline->points = ttf->point_buffer;
+
+    /* Load the X coordinates and set if the point is on the curve. */
+    x = 0;
+    y = 0;
+
+    for(n=previous_point_num,i=0;i<point_num;n++,i++){
+        outline->points[n].on_curve = ttf->flags[i]&1;
+        if(ttf->flags[i]&(1<<1)){
+            /* The X coordinate is a single byte long */
+            if(ttf->flags[i]&(1<<4)) x += MT_VIEW_U8(glyf, pos);
+            else x -= MT_VIEW_U8(glyf, pos);
+            pos++;
+        }else if(!(ttf->flags[i]&(1<<4))){
+            /* The X coordinate is two bytes long */
+            x += MT_VIEW_S16(glyf, pos);
+            pos += 2;
+        }
+        outline->points[n].x = x;
+    }
+
+    /* Load the Y coordinates. */
+    for(n=previous_point_num,i=0;i<point_num;n++,i++){
+        if(ttf->flags[i]&(1<<2)){
+            /* The Y coordinate is a single byte long */
+            if(ttf->flags[i]&(1<<5)) y += MT_VIEW_U8(glyf, pos);
+            else y -= MT_VIEW_U8(glyf, pos);
+            pos++;
+        }else if(!(ttf->flags[i]&(1<<5))){
+            /* The Y coordinate is two bytes long */
+            y += MT_VIEW_S16(glyf, pos);
+            pos += 2;
+        }
+        outline->points[n].y = y;
     }
 
 #if MT_DEBUG
     puts("mibitype: Glyph loaded. Coordinates:");
     for(n=previous_point_num,i=0;i<point_num;n++,i++){
-        printf("mibitype: Point %ld: (%d;%d)\n", i+1, glyph->points[n].x,
-               glyph->points[n].y);
+        printf("mibitype: Point %ld: (%d;%d)\n", i+1, outline->points[n].x,
+               outline->points[n].y);
     }
     puts("mibitype: ==========================");
 #endif
 
-    for(i=glyph->contour_num;i<new_contour_num;i++){
-        glyph->contour_ends[i] += previous_point_num;
+    for(i=outline->contour_num;i<new_contour_num;i++){
+        outline->contour_ends[i] += previous_point_num;
     }
 
-    glyph->contour_num = new_contour_num;
+    outline->contour_num = new_contour_num;
 
     return MT_E_NONE;
 }
 
-int _mt_ttf_load_compound_glyph(MTTTF *ttf, MTFont *font, MTGlyph *glyph) {
+int _mt_ttf_load_compound_glyph(MTTTF *ttf, MTFont *font, MTGlyph *glyph,
+                                MTTTFRecord *record, MTTTFOutline *outline) {
+    const MTView *glyf = &ttf->glyf;
+
+    size_t pos = record->pos;
+    const size_t end = record->end;
+
     unsigned short int flags;
     unsigned short int index;
 
     unsigned short int num1, num2;
-    short int x, y;
+    int x, y;
 
-    unsigned short int xscale, yscale, scale01, scale10;
+    size_t arg_size, transform_size;
 
-    size_t old_pos;
+    MTTTFRecord component;
 
     size_t i;
 
     size_t point_num;
     size_t old_point_num;
 
-    (void)xscale;
-    (void)yscale;
-    (void)scale01;
-    (void)scale10;
+    int rc;
 
     /* It is a compound glyph. */
 #if MT_DEBUG
     puts("mibitype: Compound glyph found!");
 #endif
 
+    num1 = 0;
+    num2 = 0;
+    x = 0;
+    y = 0;
+
     /* Read all the component glyph informations */
     do{
-        flags = mt_reader_read_short(font->reader);
+        if(end-pos < 2*2) return MT_E_CORRUPTED;
 
-        index = mt_reader_read_short(font->reader);
+        flags = MT_VIEW_U16(glyf, pos);
+        index = MT_VIEW_U16(glyf, pos+2);
+        pos += 2*2;
+
+        /* The size of the following items depend on the flags */
+        arg_size = flags&1 ? 2*2 : 2;
+        transform_size = flags&(1<<3) ? 2 : flags&(1<<6) ? 2*2 :
+                         flags&(1<<7) ? 4*2 : 0;
+        if(arg_size+transform_size > end-pos) return MT_E_CORRUPTED;
 
-        /* The following items depend on the flags */
         if(flags&(1<<1)){
             /* The following values are x/y coordinates */
 
             if(flags&1){
                 /* The following values are words */
-                x = mt_reader_read_short(font->reader);
-                y = mt_reader_read_short(font->reader);
+                x = MT_VIEW_S16(glyf, pos);
+                y = MT_VIEW_S16(glyf, pos+2);
             }else{
                 /* The following values are bytes */
-                x = mt_reader_read_char(font->reader);
-                y = mt_reader_read_char(font->reader);
-                if(x&(1<<7)) x |= 0xFF00;
-                if(y&(1<<7)) y |= 0xFF00;
+                x = (signed char)MT_VIEW_U8(glyf, pos);
+                y = (signed char)MT_VIEW_U8(glyf, pos+1);
 #if MT_DEBUG
                 printf("mibitype: Offsets: %d, %d\n", x, y);
 #endif
@@ -782,79 +2178,67 @@ int _mt_ttf_load_compound_glyph(MTTTF *ttf, MTFont *font, MTGlyph *glyph) {
 
             if(flags&1){
                 /* The following values are words */
-                num1 = mt_reader_read_short(font->reader);
-                num2 = mt_reader_read_short(font->reader);
+                num1 = MT_VIEW_U16(glyf, pos);
+                num2 = MT_VIEW_U16(glyf, pos+2);
             }else{
                 /* The following values are bytes */
-                num1 = mt_reader_read_char(font->reader);
-                num2 = mt_reader_read_char(font->reader);
+                num1 = MT_VIEW_U8(glyf, pos);
+                num2 = MT_VIEW_U8(glyf, pos+1);
             }
         }
 
+        /* TODO: Apply the transformations, we skip them for now. */
+        pos += arg_size+transform_size;
+
 #if MT_DEBUG
         printf("mibitype: Component glyph: index: %04x, %s as %s\n", index,
                flags&(1<<1) ? "point numbers" : "coordinates",
                flags&1 ? "words" : "bytes");
 #endif
 
-        old_pos = font->reader->cur;
-        old_point_num = glyph->contour_num ?
-                        glyph->contour_ends[glyph->contour_num-1]+1 : 0;
+        old_point_num = outline->contour_num ?
+                        outline->contour_ends[outline->contour_num-1]+1 : 0;
 
-        _mt_ttf_load_glyph_info(ttf, font, glyph, index, 0, flags&(1<<9));
+        if((rc = _mt_ttf_load_glyph_info(ttf, font, glyph, index, 0,
+                                         flags&(1<<9), &component))){
+            return rc;
+        }
 
-        if(!(ttf->added_contours&(1<<15))){
-            if(_mt_ttf_load_simple_glyph(ttf, font, glyph)){
-                return MT_E_CORRUPTED;
+        if(!(component.contours&(1<<15))){
+            if((rc = _mt_ttf_load_simple_glyph(ttf, &component, outline))){
+                return rc;
             }
         }else{
             return MT_E_NONE;
         }
 
-        point_num = glyph->contour_num ?
-                    glyph->contour_ends[glyph->contour_num-1]+1 : 0;
+        point_num = outline->contour_num ?
+                    outline->contour_ends[outline->contour_num-1]+1 : 0;
 #if MT_DEBUG
         puts("mibitype: Component loaded!");
 #endif
 
-        MT_READER_JMP(font->reader, old_pos);
-
         /* Move the glyph around as needed */
 
-        if(!(ttf->added_contours&(1<<15))){
-            if(!(flags&(1<<1))){
-                x = 0;
-                y = 0;
-
-                if(num2+old_point_num < point_num &&
-                   (size_t)num1 < point_num){
-                    x = glyph->points[num1].x-glyph->points[num2+point_num].x;
-                    y = glyph->points[num1].y-glyph->points[num2+point_num].y;
-                }
-            }
-
-            for(i=old_point_num;i<point_num;i++){
-                /* TODO: Apply the transformations */
-
-                /* Move the points around */
-                glyph->points[i].x += x;
-                glyph->points[i].y += y;
+        if(!(flags&(1<<1))){
+            x = 0;
+            y = 0;
+
+            /* Match a point of the glyph loaded so far with a point of the
+             * component. */
+            if(num2+old_point_num < point_num &&
+               (size_t)num1 < old_point_num){
+                x = outline->points[num1].x-
+                    outline->points[num2+old_point_num].x;
+                y = outline->points[num1].y-
+                    outline->points[num2+old_point_num].y;
             }
         }
 
-        if(flags&(1<<3)){
-            /* The component glyph has a scale */
-            xscale = mt_reader_read_short(font->reader);
-        }else if(flags&(1<<6)){
-            /* The component glyph has a different scale on the X and Y axis */
-            xscale = mt_reader_read_short(font->reader);
-            yscale = mt_reader_read_short(font->reader);
-        }else if(flags&(1<<7)){
-            /* The component glyph has a 2x2 transformation */
-            xscale = mt_reader_read_short(font->reader);
-            scale01 = mt_reader_read_short(font->reader);
-            scale10 = mt_reader_read_short(font->reader);
-            yscale = mt_reader_read_short(font->reader);
+        for(i=old_point_num;i<point_num;i++){
+            /* Move the points around */
+            outline->points[i].x += x;
+            outline->points[i].y += y;
         }
 
         /* If the 5th flag bit is set, another component glyph follows */
@@ -870,22 +2254,206 @@ int _mt_ttf_load_compound_glyph(MTTTF *ttf, MTFont *font, MTGlyph *glyph) {
     return MT_E_NONE;
 }
 
+int _mt_ttf_store_glyph(MTFont *font, MTGlyph *glyph,
+                        MTTTFOutline *outline) {
+    /* Pack the decoded outline in the compact format used by MTGlyph, in a
+     * single block allocated from the arena. */
+    const size_t point_num = outline->contour_num ?
+                             outline->contour_ends[outline->contour_num-1]+1 :
+                             0;
+
+    size_t i;
+
+    int x, y;
+
+    int rc;
+
+    /* The contour ends are stored as 16 bit integers. */
+    if(point_num > 0xFFFF) return MT_E_CORRUPTED;
+
+    if((rc = mt_glyph_alloc(glyph, &font->arena, point_num,
+                            outline->contour_num))){
+        return rc;
+    }
+
+    for(i=0;i<outline->contour_num;i++){
+        glyph->contour_ends[i] = outline->contour_ends[i];
+    }
+
+    for(i=0;i<(point_num+7)/8;i++){
+        glyph->on_curve[i] = 0;
+    }
+
+    for(i=0;i<point_num;i++){
+        /* Compound glyphs could move points out of the int16 range. */
+        x = outline->points[i].x;
+        y = outline->points[i].y;
+        glyph->x[i] = x < -32768 ? -32768 : x > 32767 ? 32767 : x;
+        glyph->y[i] = y < -32768 ? -32768 : y > 32767 ? 32767 : y;
+
+        glyph->on_curve[i>>3] |= (outline->points[i].on_curve&1)<<(i&7);
+    }
+
+    return MT_E_NONE;
+}
+
 int mt_ttf_load_glyph(void *_data, void *_font, void *_glyph, size_t id) {
     MTTTF *ttf = _data;
+    MTGlyph *glyph = _glyph;
+
+    MTTTFOutline outline;
+    MTTTFRecord record;
+
+    int rc;
 
-    _mt_ttf_load_glyph_info(ttf, _font, _glyph, id, 1, 1);
+    mt_glyph_init(glyph);
 
-    mt_glyph_init(_glyph);
+    if((rc = _mt_ttf_load_glyph_info(ttf, _font, glyph, id, 1, 1,
+                                        &record))){
+        return rc;
+    }
+
+    outline.contour_ends = ttf->contour_buffer;
+    outline.contour_num = 0;
+    outline.points = ttf->point_buffer;
 
-    if(!(ttf->added_contours&(1<<15))){
+    if(!(record.contours&(1<<15))){
         /* It is a simple glyph */
-        return _mt_ttf_load_simple_glyph(ttf, _font, _glyph);
+        rc = _mt_ttf_load_simple_glyph(ttf, &record, &outline);
     }else{
         /* It is a compound glyph */
-        return _mt_ttf_load_compound_glyph(ttf, _font, _glyph);
+        rc = _mt_ttf_load_compound_glyph(ttf, _font, glyph, &record,
+                                         &outline);
     }
 
-    return MT_E_NONE;
+    if(rc) return rc;
+
+    return _mt_ttf_store_glyph(_font, glyph, &outline);
+}
+
+int mt_ttf_load_bounds(void *_data, void *_font, void *_glyph, size_t id) {
+    MTTTF *ttf = _data;
+    MTFont *font = _font;
+
+    MTTTFRecord record;
+
+    /* glyf and loca are not loaded in metrics only mode. */
+    if(font->flags&MT_FONT_METRICS_ONLY) return MT_E_IMPLEMENTATION;
+
+    return _mt_ttf_load_glyph_info(ttf, font, _glyph, id, 1, 0, &record);
+}
+
+int mt_ttf_get_kerning(void *_data, void *_font, size_t left, size_t right) {
+    MTTTF *ttf = _data;
+    MTTTFPairLookup *lookup;
+    MTTTFPairClasses *classes;
+
+    size_t i, n;
+    size_t *value;
+    size_t class1, class2;
+
+    int kerning = 0;
+
+    (void)_font;
+
+    if(left >= ttf->glyph_num || right >= ttf->glyph_num) return 0;
+
+    for(i=0;i<ttf->pair_lookup_num;i++){
+        lookup = ttf->pair_lookups+i;
+
+        /* Most glyphs are never on the left side of a pair, this avoids
+         * hashing for them. */
+        if(MT_TTF_BIT_GET(lookup->left, left)){
+            value = mt_map_get(&lookup->pairs, (left<<16)|right);
+            if(value != NULL){
+                kerning += MT_TTF_EXTEND_SIGN(*value, 16);
+                continue;
+            }
+        }
+
+        /* The first class subtable that covers the left glyph gives the
+         * value. */
+        for(n=0;n<lookup->class_num;n++){
+            classes = lookup->classes+n;
+
+            if(!MT_TTF_BIT_GET(classes->coverage, left)) continue;
+
+            class1 = classes->class1[left];
+            class2 = classes->class2[right];
+            if(class1 < classes->class1_num && class2 < classes->class2_num){
+                kerning += classes->values[class1*classes->class2_num+class2];
+            }
+
+            break;
+        }
+    }
+
+    return kerning;
+}
+
+size_t mt_ttf_substitute(void *_data, void *_font, size_t *ids, size_t num) {
+    MTTTF *ttf = _data;
+    MTTTFSubstLookup *lookup;
+
+    size_t i, n;
+    size_t r, w;
+
+    size_t node;
+    size_t *next;
+
+    size_t best, best_num;
+
+    (void)_font;
+
+    for(i=0;i<ttf->subst_lookup_num;i++){
+        lookup = ttf->subst_lookups+i;
+
+        if(lookup->type == 1){
+            for(n=0;n<num;n++){
+                if(ids[n] < ttf->glyph_num){
+                    ids[n] = lookup->substitutes[ids[n]];
+                }
+            }
+
+            continue;
+        }
+
+        /* Replace the ligatures in place, the glyphs are read at r and
+         * written at w. */
+        for(r=0,w=0;r<num;){
+            best = 0;
+            best_num = 0;
+
+            if(ids[r] < ttf->glyph_num && MT_TTF_BIT_GET(lookup->first,
+                                                         ids[r])){
+                /* Walk the trie as long as the glyphs match a ligature and
+                 * keep the ligature that comes first in the font. */
+                node = 0;
+                for(n=r;n<num && ids[n] < ttf->glyph_num;n++){
+                    next = mt_map_get(&lookup->trie, (node<<16)|ids[n]);
+                    if(next == NULL) break;
+
+                    node = *next;
+                    if(lookup->ligatures[node].order <
+                       lookup->ligatures[best].order){
+                        best = node;
+                        best_num = n-r+1;
+                    }
+                }
+            }
+
+            if(best_num){
+                ids[w++] = lookup->ligatures[best].glyph;
+                r += best_num;
+            }else{
+                ids[w++] = ids[r++];
+            }
+        }
+
+        num = w;
+    }
+
+    return num;
 }
 
 int mt_ttf_load_missing(void *_data, void *_font, void *_glyph) {
@@ -901,11 +2469,47 @@ int mt_ttf_size_to_pixels(void *_data, void *_font, int points, int size) {
 void mt_ttf_free(void *_data, void *_font) {
     MTTTF *ttf = _data;
 
+    size_t i;
+
     (void)_font;
 
     free(ttf->flags);
     ttf->flags = NULL;
 
+    free(ttf->contour_buffer);
+    ttf->contour_buffer = NULL;
+    free(ttf->point_buffer);
+    ttf->point_buffer = NULL;
+
     free(ttf->table_dir);
     ttf->table_dir = NULL;
+
+    free(ttf->cmap.end_codes);
+    ttf->cmap.end_codes = NULL;
+
+    free(ttf->cmap.groups);
+    ttf->cmap.groups = NULL;
+
+    free(ttf->glyph_offsets);
+    ttf->glyph_offsets = NULL;
+
+    for(i=0;i<ttf->pair_lookup_num;i++){
+        _mt_ttf_free_pair_lookup(ttf->pair_lookups+i);
+    }
+    free(ttf->pair_lookups);
+    ttf->pair_lookups = NULL;
+    ttf->pair_lookup_num = 0;
+
+    for(i=0;i<ttf->class_def_num;i++) free(ttf->class_defs[i]);
+    free(ttf->class_defs);
+    ttf->class_defs = NULL;
+    ttf->class_def_num = 0;
+    mt_map_free(&ttf->class_def_map);
+
+    for(i=0;i<ttf->subst_lookup_num;i++){
+        _mt_ttf_free_subst_lookup(ttf->subst_lookups+i);
+    }
+    free(ttf->subst_lookups);
+    ttf->subst_lookups = NULL;
+    ttf->subst_lookup_num = 0;
 }
@@ -45,18 +45,110 @@ typedef struct {
     unsigned long int size;
 } MTTTFTableDir;
 
+typedef struct {
+    unsigned long int start_char;
+    unsigned long int end_char;
+    unsigned long int start_index;
+} MTTTFCmapGroup;
+
 typedef struct {
     unsigned short int format;
     unsigned short int platform_id;
     unsigned long int group_num;
     size_t data_cur;
+
+    /* Format 4 segments, decoded once when loading the font. */
+    unsigned short int seg_count;
+    unsigned short int *end_codes;
+    unsigned short int *start_codes;
+    unsigned short int *id_deltas;
+    unsigned short int *id_range_offsets;
+    unsigned short int *glyph_ids;
+    size_t glyph_id_num;
+
+    /* Format 12 groups, sorted by character code. */
+    MTTTFCmapGroup *groups;
 } MTTTFCmap;
 
+/* Kerning by classes, from GPOS PairPos format 2 subtables. */
+typedef struct {
+    /* Bitset of the left glyphs the subtable applies to. */
+    unsigned char *coverage;
+
+    /* The classes of all the glyph ids. The class definitions are often
+     * shared by multiple subtables, they are owned by the font. */
+    unsigned short int *class1;
+    unsigned short int *class2;
+    size_t class1_num, class2_num;
+
+    /* The X advance adjustment of each pair of classes, indexed by
+     * class1*class2_num+class2. */
+    short int *values;
+} MTTTFPairClasses;
+
+/* A kerning lookup. A pair gets its value from pairs if it is in it, and from
+ * the first class subtable that covers the left glyph otherwise. */
+typedef struct {
+    /* Pairs listed one by one, keyed by (left<<16)|right, the values are
+     * stored as uint16. left is a bitset of the glyphs on the left side of a
+     * pair. */
+    MTMap pairs;
+    unsigned char *left;
+
+    MTTTFPairClasses *classes;
+    size_t class_num;
+} MTTTFPairLookup;
+
+typedef struct {
+    unsigned short int glyph;
+
+    /* The position of the ligature in the lookup, MT_FONT_NONE if no
+     * ligature ends at this node. */
+    size_t order;
+} MTTTFLigature;
+
+/* A GSUB lookup, applied to the whole run before the next one. */
+typedef struct {
+    /* 1 for single substitutions, 4 for ligatures. */
+    unsigned short int type;
+
+    /* Single substitutions: the substitute of each glyph id. */
+    unsigned short int *substitutes;
+
+    /* Ligatures: a trie whose transitions are keyed by (node<<16)|glyph, the
+     * root is node 0. ligatures contains the ligature ending at each node,
+     * when multiple ligatures match the one with the lowest order wins. first
+     * is a bitset of the glyphs that start a ligature. */
+    MTMap trie;
+    MTTTFLigature *ligatures;
+    size_t node_num;
+    unsigned char *first;
+} MTTTFSubstLookup;
+
+/* The position of a glyph description in the glyf table. */
+typedef struct {
+    size_t pos;
+    size_t end;
+
+    unsigned short int contours;
+} MTTTFRecord;
+
+/* A glyph being decoded. */
+typedef struct {
+    size_t *contour_ends;
+    size_t contour_num;
+
+    MTPoint *points;
+} MTTTFOutline;
+
 typedef struct {
     unsigned short int table_num;
 
     unsigned short int glyph_num;
     unsigned short int simple_points_max;
+    unsigned short int simple_contours_max;
+    unsigned short int compound_points_max;
+    unsigned short int compound_contours_max;
 
     unsigned short int units_per_em;
 
@@ -65,17 +157,44 @@ typedef struct {
     size_t best_map;
     MTTTFCmap cmap;
 
-    size_t glyf_table_pos;
     size_t maxp_table_pos;
-    size_t loca_table_pos;
     size_t cmap_table_pos;
-    size_t htmx_table_pos;
 
-    unsigned short int added_contours;
+    /* The tables used when loading glyphs, validated when loading the
+     * font. */
+    MTView glyf;
+
+    /* The offsets of the glyphs in glyf, decoded from loca. The glyph id
+     * takes up glyph_offsets[id] to glyph_offsets[id+1]. */
+    size_t *glyph_offsets;
+
+    /* The kerning lookups, from GPOS or from the kern table, their values add
+     * up. */
+    MTTTFPairLookup *pair_lookups;
+    size_t pair_lookup_num;
+
+    /* The decoded class definitions, shared by the pair lookups.
+     * class_def_map maps the offsets of the class definitions to their index
+     * while GPOS is being loaded. */
+    unsigned short int **class_defs;
+    size_t class_def_num;
+    MTMap class_def_map;
+
+    MTTTFSubstLookup *subst_lookups;
+    size_t subst_lookup_num;
 
     unsigned short int advance_width_num;
 
+    /* Glyphs are decoded in these buffers before being packed in a single
+     * block allocated from the arena of the font. The flags are only needed
+     * for the points of the simple glyph that is being decoded. */
     unsigned char *flags;
+    size_t flag_buffer_size;
+
+    size_t *contour_buffer;
+    MTPoint *point_buffer;
+    size_t contour_buffer_size;
+    size_t point_buffer_size;
 
     MTTTFTableDir *table_dir;
 } MTTTF;
@@ -88,6 +207,12 @@ size_t mt_ttf_get_glyph_id(void *_data, void *_font, size_t c);
 
 int mt_ttf_load_glyph(void *_data, void *_font, void *_glyph, size_t id);
 
+int mt_ttf_load_bounds(void *_data, void *_font, void *_glyph, size_t id);
+
+int mt_ttf_get_kerning(void *_data, void *_font, size_t left, size_t right);
+
+size_t mt_ttf_substitute(void *_data, void *_font, size_t *ids, size_t num);
+
 int mt_ttf_load_missing(void *_data, void *_font, void *_glyph);
 
 int mt_ttf_size_to_pixels(void *_data, void *_font, int points, int size);
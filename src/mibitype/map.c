@@ -0,0 +1,193 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mibitype/map.h>
+#include <mibitype/errors.h>
+
+#include <stdlib.h>
+
+#define MT_MAP_MIN_SIZE 16
+
+size_t _mt_map_hash(size_t key) {
+    unsigned long int h = key;
+
+    /* Mix the bits a bit because the keys are often small consecutive
+     * numbers and the table size is a power of two. */
+    h ^= h>>16;
+    h *= 0x45D9F3BUL;
+    h ^= h>>16;
+
+    return h;
+}
+
+void _mt_map_empty(MTMapItem *items, size_t size) {
+    size_t i;
+
+    for(i=0;i<size;i++){
+        items[i].key = MT_MAP_EMPTY;
+    }
+}
+
+int _mt_map_resize(MTMap *map, size_t size) {
+    MTMapItem *old = map->items;
+    MTMapItem *items;
+
+    size_t old_size = map->size;
+    size_t i, n;
+
+    items = malloc(size*sizeof(MTMapItem));
+    if(items == NULL) return MT_E_OUT_OF_MEM;
+
+    _mt_map_empty(items, size);
+
+    for(i=0;i<old_size;i++){
+        if(old[i].key == MT_MAP_EMPTY) continue;
+
+        n = _mt_map_hash(old[i].key)&(size-1);
+        while(items[n].key != MT_MAP_EMPTY) n = (n+1)&(size-1);
+
+        items[n] = old[i];
+    }
+
+    free(old);
+
+    map->items = items;
+    map->size = size;
+
+    return MT_E_NONE;
+}
+
+int mt_map_init(MTMap *map) {
+    map->items = NULL;
+    map->size = 0;
+    map->num = 0;
+
+    return MT_E_NONE;
+}
+
+size_t *mt_map_get(MTMap *map, size_t key) {
+    size_t n;
+
+    if(!map->size) return NULL;
+
+    n = _mt_map_hash(key)&(map->size-1);
+
+    while(map->items[n].key != MT_MAP_EMPTY){
+        if(map->items[n].key == key) return &map->items[n].value;
+
+        n = (n+1)&(map->size-1);
+    }
+
+    return NULL;
+}
+
+int mt_map_set(MTMap *map, size_t key, size_t value) {
+    size_t n;
+
+    int rc;
+
+    /* Keep the load factor under 1/2 so that the probe sequences stay
+     * short. */
+    if((map->num+1)*2 > map->size){
+        rc = _mt_map_resize(map, map->size ? map->size*2 : MT_MAP_MIN_SIZE);
+        if(rc) return rc;
+    }
+
+    n = _mt_map_hash(key)&(map->size-1);
+
+    while(map->items[n].key != MT_MAP_EMPTY){
+        if(map->items[n].key == key){
+            map->items[n].value = value;
+
+            return MT_E_NONE;
+        }
+
+        n = (n+1)&(map->size-1);
+    }
+
+    map->items[n].key = key;
+    map->items[n].value = value;
+    map->num++;
+
+    return MT_E_NONE;
+}
+
+void mt_map_remove(MTMap *map, size_t key) {
+    size_t i, n;
+    size_t home;
+
+    size_t *value = mt_map_get(map, key);
+
+    if(value == NULL) return;
+
+    i = (MTMapItem*)((char*)value-offsetof(MTMapItem, value))-map->items;
+
+    /* Move the following items of the probe sequence back so that no
+     * tombstones are needed. */
+    n = i;
+    for(;;){
+        n = (n+1)&(map->size-1);
+
+        if(map->items[n].key == MT_MAP_EMPTY) break;
+
+        home = _mt_map_hash(map->items[n].key)&(map->size-1);
+
+        /* Only move the item if its home slot isn't between the hole and its
+         * current position. */
+        if(i <= n ? (home <= i || home > n) : (home <= i && home > n)){
+            map->items[i] = map->items[n];
+            i = n;
+        }
+    }
+
+    map->items[i].key = MT_MAP_EMPTY;
+    map->num--;
+}
+
+void mt_map_clear(MTMap *map) {
+    if(map->items != NULL) _mt_map_empty(map->items, map->size);
+
+    map->num = 0;
+}
+
+size_t mt_map_memory(MTMap *map) {
+    return map->size*sizeof(MTMapItem);
+}
+
+void mt_map_free(MTMap *map) {
+    free(map->items);
+    map->items = NULL;
+    map->size = 0;
+    map->num = 0;
+}
@@ -0,0 +1,73 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MT_MAP_H
+#define MT_MAP_H
+
+#include <stddef.h>
+
+/* A hash map from size_t keys to size_t values using open addressing with
+ * linear probing. MT_MAP_EMPTY can't be used as a key. */
+
+#define MT_MAP_EMPTY ((size_t)-1)
+
+typedef struct {
+    size_t key;
+    size_t value;
+} MTMapItem;
+
+typedef struct {
+    MTMapItem *items;
+    size_t size;
+    size_t num;
+} MTMap;
+
+int mt_map_init(MTMap *map);
+
+/* Returns a pointer to the value associated to key, or NULL if the key is not
+ * in the map. The pointer is only valid until the map is modified. */
+size_t *mt_map_get(MTMap *map, size_t key);
+
+int mt_map_set(MTMap *map, size_t key, size_t value);
+
+void mt_map_remove(MTMap *map, size_t key);
+
+void mt_map_clear(MTMap *map);
+
+/* Get the amount of memory used by the map in bytes. */
+size_t mt_map_memory(MTMap *map);
+
+void mt_map_free(MTMap *map);
+
+#endif
@@ -32,13 +32,26 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+/* mmap, open and fstat are not part of ANSI C. */
+#define _POSIX_C_SOURCE 200112L
+
 #include <mibitype/reader.h>
 #include <mibitype/errors.h>
+#include <mibitype/defs.h>
 
 #include <stdlib.h>
 #include <stdio.h>
 
+#if MT_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 int mt_reader_init(MTReader *reader, char *file) {
+    unsigned char *buffer;
+
     FILE *fp = fopen(file, "rb");
 
     if(fp == NULL) return MT_E_OPEN_FILE;
@@ -47,23 +60,89 @@ int mt_reader_init(MTReader *reader, char *file) {
     reader->size = ftell(fp);
     rewind(fp);
 
-    reader->buffer = malloc(reader->size);
+    buffer = malloc(reader->size);
 
-    if(reader->buffer == NULL){
+    if(buffer == NULL){
         fclose(fp);
 
         return MT_E_OUT_OF_MEM;
     }
 
-    fread(reader->buffer, 1, reader->size, fp);
+    if(fread(buffer, 1, reader->size, fp) != reader->size){
+        free(buffer);
+        fclose(fp);
+
+        return MT_E_OPEN_FILE;
+    }
 
     fclose(fp);
 
+    reader->buffer = buffer;
+    reader->cur = 0;
+    reader->type = MT_READER_HEAP;
+
+    return MT_E_NONE;
+}
+
+int mt_reader_init_mmap(MTReader *reader, char *file) {
+#if MT_MMAP
+    int fd;
+    struct stat st;
+    void *map;
+
+    fd = open(file, O_RDONLY);
+    if(fd < 0) return MT_E_OPEN_FILE;
+
+    if(fstat(fd, &st) || st.st_size <= 0){
+        close(fd);
+
+        return mt_reader_init(reader, file);
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    /* The mapping stays valid after closing the file descriptor. */
+    close(fd);
+
+    if(map == MAP_FAILED) return mt_reader_init(reader, file);
+
+    reader->buffer = map;
+    reader->size = st.st_size;
+    reader->cur = 0;
+    reader->type = MT_READER_MMAP;
+
+    return MT_E_NONE;
+#else
+    return mt_reader_init(reader, file);
+#endif
+}
+
+int mt_reader_init_memory(MTReader *reader, const unsigned char *buffer,
+                          size_t size, int owned) {
+    if(buffer == NULL) return MT_E_OPEN_FILE;
+
+    reader->buffer = buffer;
+    reader->size = size;
+    reader->cur = 0;
+    reader->type = owned ? MT_READER_HEAP : MT_READER_MEMORY;
+
+    return MT_E_NONE;
+}
+
+int mt_reader_view(MTReader *reader, size_t offset, size_t size,
+                   MTView *view) {
+    if(offset > reader->size || size > reader->size-offset){
+        return MT_E_CORRUPTED;
+    }
+
+    view->data = reader->buffer+offset;
+    view->size = size;
+
     return MT_E_NONE;
 }
 
 unsigned char mt_reader_read_char(MTReader *reader) {
-    if(reader->cur+1 >= reader->size) return 0;
+    if(reader->cur+1 > reader->size) return 0;
 
     return reader->buffer[reader->cur++];
 }
@@ -71,7 +150,7 @@ unsigned char mt_reader_read_char(MTReader *reader) {
 unsigned short int mt_reader_read_short(MTReader *reader) {
     unsigned char byte1, byte2;
 
-    if(reader->cur+2 >= reader->size) return 0;
+    if(reader->cur+2 > reader->size) return 0;
 
     byte1 = reader->buffer[reader->cur++];
     byte2 = reader->buffer[reader->cur++];
@@ -82,21 +161,22 @@ unsigned short int mt_reader_read_short(MTReader *reader) {
 unsigned long int mt_reader_read_int(MTReader *reader) {
     unsigned char byte1, byte2, byte3, byte4;
 
-    if(reader->cur+4 >= reader->size) return 0;
+    if(reader->cur+4 > reader->size) return 0;
 
     byte1 = reader->buffer[reader->cur++];
     byte2 = reader->buffer[reader->cur++];
     byte3 = reader->buffer[reader->cur++];
     byte4 = reader->buffer[reader->cur++];
 
-    return (byte1<<24) | (byte2<<16) | (byte3<<8) | byte4;
+    return ((unsigned long int)byte1<<24) | ((unsigned long int)byte2<<16) |
+           ((unsigned long int)byte3<<8) | byte4;
 }
 
 void mt_reader_read_array(MTReader *reader, unsigned char *array,
                           size_t bytes) {
     size_t i;
 
-    if(reader->cur+4 >= reader->size){
+    if(reader->cur+bytes > reader->size){
         for(i=0;i<bytes;i++){
             array[i] = 0;
         }
@@ -109,6 +189,14 @@ void mt_reader_read_array(MTReader *reader, unsigned char *array,
 }
 
 void mt_reader_free(MTReader *reader) {
-    free(reader->buffer);
+#if MT_MMAP
+    if(reader->type == MT_READER_MMAP){
+        munmap((void*)reader->buffer, reader->size);
+        reader->buffer = NULL;
+        return;
+    }
+#endif
+
+    if(reader->type == MT_READER_HEAP) free((void*)reader->buffer);
     reader->buffer = NULL;
 }
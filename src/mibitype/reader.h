@@ -37,17 +37,65 @@
 
 #include <stddef.h>
 
+enum {
+    MT_READER_HEAP,
+    MT_READER_MMAP,
+    MT_READER_MEMORY,
+
+    MT_READER_AMOUNT
+};
+
 typedef struct {
-    unsigned char *buffer;
+    const unsigned char *buffer;
     size_t size;
     size_t cur;
+
+    int type;
 } MTReader;
 
+/* A validated range of the file, for example a table. The MT_VIEW_* macros
+ * read big endian values from it without any bounds checking, the offsets
+ * must be checked against the size of the view beforehand. */
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+} MTView;
+
+#define MT_VIEW_U8(view, pos) ((view)->data[pos])
+#define MT_VIEW_U16(view, pos) (((unsigned short int)(view)->data[pos]<<8)| \
+                                (view)->data[(pos)+1])
+#define MT_VIEW_S16(view, pos) (((int)MT_VIEW_U16(view, pos)^0x8000)-0x8000)
+#define MT_VIEW_U32(view, pos) \
+    (((unsigned long int)(view)->data[pos]<<24)| \
+     ((unsigned long int)(view)->data[(pos)+1]<<16)| \
+     ((unsigned long int)(view)->data[(pos)+2]<<8)|(view)->data[(pos)+3])
+
+/* Check that bytes bytes can be read at pos without overflowing. */
+#define MT_VIEW_HAS(view, pos, bytes) ((pos) <= (view)->size && \
+                                       (bytes) <= (view)->size-(pos))
+
 #define MT_READER_JMP(reader, pos) (reader)->cur = (pos)
 #define MT_READER_SKIP(reader, bytes) (reader)->cur += (bytes)
 
 int mt_reader_init(MTReader *reader, char *file);
 
+/* Map the file into memory instead of copying it to the heap: the pages are
+ * shared with the page cache and only the ones that are actually read get
+ * loaded. Falls back to mt_reader_init if MT_MMAP is disabled or the file
+ * can't be mapped. */
+int mt_reader_init_mmap(MTReader *reader, char *file);
+
+/* Wrap an existing buffer (a font embedded in the executable for example)
+ * without copying it. If owned is set, the buffer must have been allocated
+ * with malloc and will be freed by mt_reader_free, otherwise it is left
+ * untouched and must outlive the reader. */
+int mt_reader_init_memory(MTReader *reader, const unsigned char *buffer,
+                          size_t size, int owned);
+
+/* Get a view of size bytes at offset, fails if it doesn't fit in the file. */
+int mt_reader_view(MTReader *reader, size_t offset, size_t size,
+                   MTView *view);
+
 unsigned char mt_reader_read_char(MTReader *reader);
 
 unsigned short int mt_reader_read_short(MTReader *reader);
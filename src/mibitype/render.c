@@ -33,5 +33,695 @@
  */
 
 #include <mibitype/render.h>
+#include <mibitype/errors.h>
 
+#include <math.h>
+#include <string.h>
 
+#if MT_RENDER_SIMD
+#include <immintrin.h>
+
+/* The SIMD kernels are compiled for their instruction set regardless of the
+ * flags of the build, and only called if the CPU supports it. */
+#define MT_RENDER_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+/* Divide a fixed point value by MT_RENDER_ONE, rounding towards negative
+ * infinity. */
+long int _mt_render_floor(long int v) {
+    if(v >= 0) return v/MT_RENDER_ONE;
+    return -((-v+MT_RENDER_ONE-1)/MT_RENDER_ONE);
+}
+
+long int _mt_render_ceil(long int v) {
+    return -_mt_render_floor(-v);
+}
+
+/* Scale a coordinate in font units to fixed point pixels. mt_render_get_box
+ * and mt_render_glyph must use the same conversion so that the outline always
+ * fits in the bitmap. */
+long int _mt_render_scale(int v, double scale) {
+    return (long int)floor(v*scale+0.5);
+}
+
+double _mt_render_get_scale(MTFont *font, int size) {
+    return (double)size*MT_RENDER_ONE/font->units_per_em;
+}
+
+void mt_rasterizer_init(MTRasterizer *rasterizer) {
+    int kernel;
+
+    rasterizer->cover = NULL;
+    rasterizer->area = NULL;
+    rasterizer->cell_max = 0;
+    rasterizer->width = 0;
+    rasterizer->height = 0;
+
+    for(kernel=MT_RENDER_KERNEL_AMOUNT-1;kernel>MT_RENDER_SCALAR;kernel--){
+        if(mt_render_kernel_supported(kernel)) break;
+    }
+    mt_rasterizer_set_kernel(rasterizer, kernel);
+}
+
+void mt_render_get_box(MTFont *font, MTGlyph *glyph, int size, int subpixel,
+                       MTBitmap *bitmap) {
+    long int xmin, ymin, xmax, ymax;
+    long int x, y;
+
+    double scale;
+
+    size_t i;
+
+    bitmap->width = 0;
+    bitmap->height = 0;
+    bitmap->pitch = 0;
+    bitmap->left = 0;
+    bitmap->top = 0;
+
+    if(!glyph->point_num || font->units_per_em <= 0 || size <= 0) return;
+
+    scale = _mt_render_get_scale(font, size);
+
+    /* The curves are contained in the hull of their control points, so the
+     * box of the points contains the whole outline. */
+    xmin = xmax = _mt_render_scale(MT_GLYPH_X(glyph, 0), scale);
+    ymin = ymax = _mt_render_scale(MT_GLYPH_Y(glyph, 0), scale);
+    for(i=1;i<glyph->point_num;i++){
+        x = _mt_render_scale(MT_GLYPH_X(glyph, i), scale);
+        y = _mt_render_scale(MT_GLYPH_Y(glyph, i), scale);
+        if(x < xmin) xmin = x;
+        if(x > xmax) xmax = x;
+        if(y < ymin) ymin = y;
+        if(y > ymax) ymax = y;
+    }
+
+    bitmap->left = _mt_render_floor(xmin+subpixel);
+    bitmap->top = _mt_render_ceil(ymax);
+    bitmap->width = _mt_render_ceil(xmax+subpixel)-bitmap->left;
+    bitmap->height = bitmap->top-_mt_render_floor(ymin);
+    bitmap->pitch = bitmap->width;
+}
+
+/* Accumulate the part of an edge that is in the row of cells row, from
+ * (x0, fy0) to (x1, fy1), where fy0 and fy1 are relative to the top of the
+ * row. */
+void _mt_render_row(MTRasterizer *rasterizer, long int row, long int x0,
+                    long int fy0, long int x1, long int fy1) {
+    int *cover = rasterizer->cover+row*rasterizer->width;
+    int *area = rasterizer->area+row*rasterizer->width;
+
+    long int ex0 = x0/MT_RENDER_ONE;
+    long int ex1 = x1/MT_RENDER_ONE;
+    long int ex;
+
+    long int x, y;
+    long int fx;
+    long int bound, by;
+    long int dy;
+
+    if(fy0 == fy1) return;
+
+    if(ex0 == ex1){
+        dy = fy1-fy0;
+        cover[ex0] += dy;
+        area[ex0] += dy*(x0-ex0*MT_RENDER_ONE+x1-ex0*MT_RENDER_ONE);
+        return;
+    }
+
+    /* Split the edge at each vertical cell boundary it crosses. The
+     * intersections are computed from the ends of the edge so that the errors
+     * don't add up. */
+    x = x0;
+    y = fy0;
+    if(x1 > x0){
+        for(ex=ex0;ex<ex1;ex++){
+            bound = (ex+1)*MT_RENDER_ONE;
+            by = fy0+(long int)floor((double)(fy1-fy0)*(bound-x0)/(x1-x0)+
+                                     0.5);
+            fx = x-ex*MT_RENDER_ONE;
+            cover[ex] += by-y;
+            area[ex] += (by-y)*(fx+MT_RENDER_ONE);
+            x = bound;
+            y = by;
+        }
+    }else{
+        for(ex=ex0;ex>ex1;ex--){
+            bound = ex*MT_RENDER_ONE;
+            by = fy0+(long int)floor((double)(fy1-fy0)*(x0-bound)/(x0-x1)+
+                                     0.5);
+            fx = x-ex*MT_RENDER_ONE;
+            cover[ex] += by-y;
+            area[ex] += (by-y)*fx;
+            x = bound;
+            y = by;
+        }
+    }
+
+    dy = fy1-y;
+    cover[ex1] += dy;
+    area[ex1] += dy*(x-ex1*MT_RENDER_ONE+x1-ex1*MT_RENDER_ONE);
+}
+
+void _mt_render_line(MTRasterizer *rasterizer, long int x0, long int y0,
+                     long int x1, long int y1) {
+    long int xa, ya, xb, yb;
+    long int row, last;
+    long int top, bottom;
+    long int xtop, xbottom;
+
+    const long int xmax = (rasterizer->width-1)*MT_RENDER_ONE;
+    const long int ymax = rasterizer->height*MT_RENDER_ONE;
+
+    /* The points should always be inside of the bitmap, but make sure that we
+     * never write out of it. */
+    if(x0 < 0) x0 = 0;
+    if(x0 > xmax) x0 = xmax;
+    if(x1 < 0) x1 = 0;
+    if(x1 > xmax) x1 = xmax;
+    if(y0 < 0) y0 = 0;
+    if(y0 > ymax) y0 = ymax;
+    if(y1 < 0) y1 = 0;
+    if(y1 > ymax) y1 = ymax;
+
+    if(y0 == y1) return;
+
+    /* Walk the rows from top to bottom, (xa, ya) being the top end. */
+    if(y0 < y1){
+        xa = x0;
+        ya = y0;
+        xb = x1;
+        yb = y1;
+    }else{
+        xa = x1;
+        ya = y1;
+        xb = x0;
+        yb = y0;
+    }
+
+    last = (yb-1)/MT_RENDER_ONE;
+    for(row=ya/MT_RENDER_ONE;row<=last;row++){
+        top = row*MT_RENDER_ONE;
+        bottom = top+MT_RENDER_ONE;
+        if(top < ya) top = ya;
+        if(bottom > yb) bottom = yb;
+
+        xtop = xa+(long int)floor((double)(xb-xa)*(top-ya)/(yb-ya)+0.5);
+        xbottom = xa+(long int)floor((double)(xb-xa)*(bottom-ya)/(yb-ya)+
+                                     0.5);
+
+        top -= row*MT_RENDER_ONE;
+        bottom -= row*MT_RENDER_ONE;
+
+        /* Keep the direction of the edge, it gives the sign of the cover. */
+        if(y0 < y1){
+            _mt_render_row(rasterizer, row, xtop, top, xbottom, bottom);
+        }else{
+            _mt_render_row(rasterizer, row, xbottom, bottom, xtop, top);
+        }
+    }
+}
+
+/* Find the root of a*t^2+b*t+c in [t0, t1]. The caller makes sure that
+ * there is one, but it may be slightly out of the interval because of
+ * rounding errors, so it gets clamped. */
+double _mt_render_root(double a, double b, double c, double t0, double t1) {
+    double d, q;
+    double r0, r1;
+    double e0, e1;
+
+    if(a == 0){
+        r0 = b != 0 ? -c/b : t0;
+    }else{
+        /* Avoid the cancellation in -b+sqrt(b^2-4ac) when 4ac is small. */
+        d = b*b-4*a*c;
+        if(d < 0) d = 0;
+        q = b < 0 ? -(b-sqrt(d))/2 : -(b+sqrt(d))/2;
+        r0 = q/a;
+        r1 = q != 0 ? c/q : r0;
+
+        /* Keep the root closest to the interval. */
+        e0 = r0 < t0 ? t0-r0 : r0 > t1 ? r0-t1 : 0;
+        e1 = r1 < t0 ? t0-r1 : r1 > t1 ? r1-t1 : 0;
+        if(e1 < e0) r0 = r1;
+    }
+
+    if(r0 < t0) r0 = t0;
+    if(r0 > t1) r0 = t1;
+
+    return r0;
+}
+
+/* Add the part of a curve between t0 and t1 to a cell, its x coefficients
+ * being relative to the left of the cell. The area is twice the integral of
+ * x*dy, like in _mt_render_row. */
+void _mt_render_cell(MTRasterizer *rasterizer, long int row, long int col,
+                     double *x, double *y, double t0, double t1,
+                     long int dy) {
+    /* The integral of (x[0]*t^2+x[1]*t+x[2])*(2*y[0]*t+y[1]). */
+    const double c4 = x[0]*y[0]/2;
+    const double c3 = (x[0]*y[1]+2*x[1]*y[0])/3;
+    const double c2 = (x[1]*y[1]+2*x[2]*y[0])/2;
+    const double c1 = x[2]*y[1];
+
+    double area;
+
+    if(row < 0 || row >= rasterizer->height || !dy) return;
+    if(col < 0) col = 0;
+    if(col > rasterizer->width-1) col = rasterizer->width-1;
+
+    area = 2*((((c4*t1+c3)*t1+c2)*t1+c1)*t1-(((c4*t0+c3)*t0+c2)*t0+c1)*t0);
+
+    rasterizer->cover[row*rasterizer->width+col] += dy;
+    rasterizer->area[row*rasterizer->width+col] += (long int)floor(area+0.5);
+}
+
+/* Walk the cells crossed by a part of a curve that is monotonic on both axes,
+ * from t0 to t1, and add it to them. The curve is x[0]*t^2+x[1]*t+x[2] on the
+ * x axis and the same with y on the y axis, and it goes from y0 to y1 once
+ * rounded. */
+void _mt_render_monotonic(MTRasterizer *rasterizer, double *x, double *y,
+                          double t0, double t1, long int y0, long int y1) {
+    double xs = (x[0]*t0+x[1])*t0+x[2];
+    double xe = (x[0]*t1+x[1])*t1+x[2];
+    double ye = (y[0]*t1+y[1])*t1+y[2];
+    double cx[3];
+    double tx, ty, t;
+
+    long int col, row;
+    long int next;
+    long int bound;
+
+    int dx = xe > xs ? 1 : xe < xs ? -1 : 0;
+    int dy = y1 > y0 ? 1 : -1;
+
+    if(y0 == y1) return;
+
+    col = dx < 0 ? _mt_render_ceil((long int)ceil(xs))-1 :
+                   _mt_render_floor((long int)floor(xs));
+    row = dy < 0 ? _mt_render_ceil(y0)-1 : _mt_render_floor(y0);
+
+    cx[0] = x[0];
+    cx[1] = x[1];
+
+    while(1){
+        /* Find where the curve leaves the current cell, through its left or
+         * right side or through its top or its bottom. */
+        tx = 2;
+        bound = (dx > 0 ? col+1 : col)*MT_RENDER_ONE;
+        if((dx > 0 && bound < xe) || (dx < 0 && bound > xe)){
+            tx = _mt_render_root(x[0], x[1], x[2]-bound, t0, t1);
+        }
+
+        ty = 2;
+        bound = (dy > 0 ? row+1 : row)*MT_RENDER_ONE;
+        if((dy > 0 && bound < ye) || (dy < 0 && bound > ye)){
+            ty = _mt_render_root(y[0], y[1], y[2]-bound, t0, t1);
+        }
+
+        /* The crossings of the row boundaries are exactly on the fixed point
+         * grid, the other ones get rounded, so that the cover of each row
+         * adds up to the height of the curve in that row. */
+        if(tx > 1 && ty > 1){
+            t = t1;
+            next = y1;
+        }else if(ty <= tx){
+            t = ty;
+            next = bound;
+        }else{
+            t = tx;
+            next = (long int)floor((y[0]*t+y[1])*t+y[2]+0.5);
+        }
+
+        cx[2] = x[2]-col*MT_RENDER_ONE;
+        _mt_render_cell(rasterizer, row, col, cx, y, t0, t, next-y0);
+
+        if(tx > 1 && ty > 1) break;
+
+        if(tx <= ty) col += dx;
+        if(ty <= tx) row += dy;
+
+        t0 = t;
+        y0 = next;
+    }
+}
+
+void _mt_render_curve(MTRasterizer *rasterizer, long int x0, long int y0,
+                      long int x1, long int y1, long int x2, long int y2) {
+    /* The curve is split where it changes of direction on either axis, and
+     * each part is walked cell by cell. The area covered in each cell is
+     * computed exactly from the polynomial form of the curve, so unlike with
+     * flattening, the only errors come from rounding. */
+    double x[3], y[3];
+    double t[4];
+    double s, u;
+
+    long int py, ny;
+
+    int i, n = 1;
+
+    x[0] = x0-2*x1+x2;
+    x[1] = 2*(x1-x0);
+    x[2] = x0;
+    y[0] = y0-2*y1+y2;
+    y[1] = 2*(y1-y0);
+    y[2] = y0;
+
+    t[0] = 0;
+    if(x[0] != 0){
+        s = -x[1]/(2*x[0]);
+        if(s > 0 && s < 1) t[n++] = s;
+    }
+    if(y[0] != 0){
+        s = -y[1]/(2*y[0]);
+        if(s > 0 && s < 1){
+            if(n > 1 && s < t[1]){
+                t[2] = t[1];
+                t[1] = s;
+            }else{
+                t[n] = s;
+            }
+            n++;
+        }
+    }
+    t[n] = 1;
+
+    py = y0;
+    for(i=0;i<n;i++){
+        u = t[i+1];
+        ny = i < n-1 ? (long int)floor((y[0]*u+y[1])*u+y[2]+0.5) : y2;
+        _mt_render_monotonic(rasterizer, x, y, t[i], u, py, ny);
+        py = ny;
+    }
+}
+
+void _mt_render_contour(MTRasterizer *rasterizer, MTGlyph *glyph,
+                        size_t first, size_t last, double scale, long int left,
+                        long int top) {
+    size_t num = last-first+1;
+    size_t start;
+    size_t i, n;
+
+    long int sx, sy;
+    long int cx = 0, cy = 0;
+    long int x, y;
+    long int px, py;
+
+    int pending = 0;
+
+    /* Start from an on curve point if there is one. Otherwise the contour
+     * only contains off curve points, and the midpoint between the last and
+     * the first point is on the curve. */
+    for(start=first;start<=last;start++){
+        if(MT_GLYPH_ON_CURVE(glyph, start)) break;
+    }
+
+    if(start <= last){
+        sx = _mt_render_scale(MT_GLYPH_X(glyph, start), scale)-left;
+        sy = top-_mt_render_scale(MT_GLYPH_Y(glyph, start), scale);
+        start++;
+        num--;
+    }else{
+        start = first;
+        sx = (_mt_render_scale(MT_GLYPH_X(glyph, first), scale)-left+
+              _mt_render_scale(MT_GLYPH_X(glyph, last), scale)-left)/2;
+        sy = (top-_mt_render_scale(MT_GLYPH_Y(glyph, first), scale)+
+              top-_mt_render_scale(MT_GLYPH_Y(glyph, last), scale))/2;
+    }
+
+    px = sx;
+    py = sy;
+
+    for(i=0;i<num;i++){
+        n = start+i;
+        if(n > last) n -= last-first+1;
+
+        x = _mt_render_scale(MT_GLYPH_X(glyph, n), scale)-left;
+        y = top-_mt_render_scale(MT_GLYPH_Y(glyph, n), scale);
+
+        if(MT_GLYPH_ON_CURVE(glyph, n)){
+            if(pending){
+                _mt_render_curve(rasterizer, px, py, cx, cy, x, y);
+            }else{
+                _mt_render_line(rasterizer, px, py, x, y);
+            }
+            px = x;
+            py = y;
+            pending = 0;
+        }else{
+            if(pending){
+                /* Two consecutive off curve points imply an on curve point
+                 * between them. */
+                _mt_render_curve(rasterizer, px, py, cx, cy, (cx+x)/2,
+                                 (cy+y)/2);
+                px = (cx+x)/2;
+                py = (cy+y)/2;
+            }
+            cx = x;
+            cy = y;
+            pending = 1;
+        }
+    }
+
+    if(pending){
+        _mt_render_curve(rasterizer, px, py, cx, cy, sx, sy);
+    }else{
+        _mt_render_line(rasterizer, px, py, sx, sy);
+    }
+}
+
+/* Sweep the cells from x to width, c being the sum of the covers of the cells
+ * on the left of x. */
+void _mt_render_sweep_tail(int *cover, int *area, unsigned char *out, int x,
+                           int width, int c) {
+    int v;
+
+    for(;x<width;x++){
+        c += cover[x];
+        v = c*(2*MT_RENDER_ONE)-area[x];
+        if(v < 0) v = -v;
+        /* A fully covered cell has v = 2*MT_RENDER_ONE*MT_RENDER_ONE. With
+         * the nonzero rule the overlapping parts of the contours add up, so
+         * the coverage is clamped. */
+        v >>= 2*MT_RENDER_BITS+1-8;
+        out[x] = v > 255 ? 255 : v;
+        cover[x] = 0;
+        area[x] = 0;
+    }
+
+    /* The last cell only holds edges at the right border. */
+    cover[width] = 0;
+    area[width] = 0;
+}
+
+/* Turn the accumulated cells of a row into alpha values, and clear them for
+ * the next glyph. The SIMD kernels must give exactly the same results. */
+void _mt_render_sweep_scalar(int *cover, int *area, unsigned char *out,
+                             int width) {
+    _mt_render_sweep_tail(cover, area, out, 0, width, 0);
+}
+
+#if MT_RENDER_SIMD
+
+/* The prefix sum of the covers is computed in log2(lanes) shifts and adds,
+ * then the carry of the previous vector is added. */
+
+MT_RENDER_TARGET("sse2")
+__m128i _mt_render_alpha_sse2(int *cover, int *area, __m128i *carry) {
+    __m128i v = _mm_loadu_si128((__m128i*)cover);
+    __m128i sign;
+
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+    v = _mm_add_epi32(v, *carry);
+    *carry = _mm_shuffle_epi32(v, 0xFF);
+
+    v = _mm_sub_epi32(_mm_slli_epi32(v, MT_RENDER_BITS+1),
+                      _mm_loadu_si128((__m128i*)area));
+    sign = _mm_srai_epi32(v, 31);
+    v = _mm_sub_epi32(_mm_xor_si128(v, sign), sign);
+
+    _mm_storeu_si128((__m128i*)cover, _mm_setzero_si128());
+    _mm_storeu_si128((__m128i*)area, _mm_setzero_si128());
+
+    return _mm_srli_epi32(v, 2*MT_RENDER_BITS+1-8);
+}
+
+MT_RENDER_TARGET("sse2")
+void _mt_render_sweep_sse2(int *cover, int *area, unsigned char *out,
+                           int width) {
+    __m128i carry = _mm_setzero_si128();
+    __m128i a, b, c, d;
+
+    int x;
+
+    for(x=0;x+16<=width;x+=16){
+        a = _mt_render_alpha_sse2(cover+x, area+x, &carry);
+        b = _mt_render_alpha_sse2(cover+x+4, area+x+4, &carry);
+        c = _mt_render_alpha_sse2(cover+x+8, area+x+8, &carry);
+        d = _mt_render_alpha_sse2(cover+x+12, area+x+12, &carry);
+        /* The values are positive, the saturating packs clamp them to
+         * 255. */
+        _mm_storeu_si128((__m128i*)(out+x),
+                         _mm_packus_epi16(_mm_packs_epi32(a, b),
+                                          _mm_packs_epi32(c, d)));
+    }
+
+    _mt_render_sweep_tail(cover, area, out, x, width,
+                          _mm_cvtsi128_si32(carry));
+}
+
+MT_RENDER_TARGET("avx2")
+__m256i _mt_render_alpha_avx2(int *cover, int *area, __m256i *carry) {
+    __m256i v = _mm256_loadu_si256((__m256i*)cover);
+    __m256i sign;
+
+    /* The shifts work on each 128-bit lane, the sum of the low lane is then
+     * added to the high lane. */
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+    sign = _mm256_shuffle_epi32(v, 0xFF);
+    v = _mm256_add_epi32(v, _mm256_permute2x128_si256(sign, sign, 0x08));
+    v = _mm256_add_epi32(v, *carry);
+    *carry = _mm256_permutevar8x32_epi32(v, _mm256_set1_epi32(7));
+
+    v = _mm256_sub_epi32(_mm256_slli_epi32(v, MT_RENDER_BITS+1),
+                         _mm256_loadu_si256((__m256i*)area));
+    v = _mm256_abs_epi32(v);
+
+    _mm256_storeu_si256((__m256i*)cover, _mm256_setzero_si256());
+    _mm256_storeu_si256((__m256i*)area, _mm256_setzero_si256());
+
+    return _mm256_srli_epi32(v, 2*MT_RENDER_BITS+1-8);
+}
+
+MT_RENDER_TARGET("avx2")
+void _mt_render_sweep_avx2(int *cover, int *area, unsigned char *out,
+                           int width) {
+    __m256i carry = _mm256_setzero_si256();
+    __m256i a, b;
+
+    int x;
+
+    for(x=0;x+16<=width;x+=16){
+        a = _mt_render_alpha_avx2(cover+x, area+x, &carry);
+        b = _mt_render_alpha_avx2(cover+x+8, area+x+8, &carry);
+        /* The packs work on each 128-bit lane, so the 64-bit blocks are put
+         * back in order after each of them. */
+        a = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        a = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, a), 0xD8);
+        _mm_storeu_si128((__m128i*)(out+x), _mm256_castsi256_si128(a));
+    }
+
+    _mt_render_sweep_tail(cover, area, out, x, width,
+                          _mm_cvtsi128_si32(_mm256_castsi256_si128(carry)));
+}
+
+#endif
+
+int mt_render_kernel_supported(int kernel) {
+    if(kernel == MT_RENDER_SCALAR) return 1;
+
+#if MT_RENDER_SIMD
+    __builtin_cpu_init();
+    if(kernel == MT_RENDER_SSE2) return __builtin_cpu_supports("sse2") != 0;
+    if(kernel == MT_RENDER_AVX2) return __builtin_cpu_supports("avx2") != 0;
+#endif
+
+    return 0;
+}
+
+int mt_rasterizer_set_kernel(MTRasterizer *rasterizer, int kernel) {
+    if(kernel < 0 || kernel >= MT_RENDER_KERNEL_AMOUNT ||
+       !mt_render_kernel_supported(kernel)){
+        return MT_E_IMPLEMENTATION;
+    }
+
+    rasterizer->kernel = kernel;
+    rasterizer->sweep = _mt_render_sweep_scalar;
+#if MT_RENDER_SIMD
+    if(kernel == MT_RENDER_SSE2) rasterizer->sweep = _mt_render_sweep_sse2;
+    if(kernel == MT_RENDER_AVX2) rasterizer->sweep = _mt_render_sweep_avx2;
+#endif
+
+    return MT_E_NONE;
+}
+
+int mt_render_glyph(MTRasterizer *rasterizer, MTFont *font, MTGlyph *glyph,
+                    int size, int subpixel, MTBitmap *bitmap) {
+    size_t cells;
+    size_t first;
+    size_t i;
+
+    int y;
+
+    double scale;
+
+    if(bitmap->width <= 0 || bitmap->height <= 0) return MT_E_NONE;
+    if(font->units_per_em <= 0) return MT_E_CORRUPTED;
+
+    cells = (size_t)(bitmap->width+1)*bitmap->height;
+    if(cells > rasterizer->cell_max){
+        /* The cells are cleared after each glyph, so they only need to be
+         * cleared when they are allocated. */
+        free(rasterizer->cover);
+        free(rasterizer->area);
+        rasterizer->cover = calloc(cells, sizeof(int));
+        rasterizer->area = calloc(cells, sizeof(int));
+        if(rasterizer->cover == NULL || rasterizer->area == NULL){
+            free(rasterizer->cover);
+            free(rasterizer->area);
+            rasterizer->cover = NULL;
+            rasterizer->area = NULL;
+            rasterizer->cell_max = 0;
+            return MT_E_OUT_OF_MEM;
+        }
+        rasterizer->cell_max = cells;
+    }
+
+    rasterizer->width = bitmap->width+1;
+    rasterizer->height = bitmap->height;
+
+    scale = _mt_render_get_scale(font, size);
+
+    first = 0;
+    for(i=0;i<glyph->contour_num;i++){
+        if(glyph->contour_ends[i] >= glyph->point_num) break;
+        if(glyph->contour_ends[i] >= first){
+            _mt_render_contour(rasterizer, glyph, first,
+                               glyph->contour_ends[i], scale,
+                               (long int)bitmap->left*MT_RENDER_ONE-
+                               subpixel,
+                               (long int)bitmap->top*MT_RENDER_ONE);
+        }
+        first = glyph->contour_ends[i]+1;
+    }
+
+    for(y=0;y<bitmap->height;y++){
+        rasterizer->sweep(rasterizer->cover+y*rasterizer->width,
+                          rasterizer->area+y*rasterizer->width,
+                          bitmap->data+y*bitmap->pitch, bitmap->width);
+    }
+
+    return MT_E_NONE;
+}
+
+int mt_bitmap_alloc(MTBitmap *bitmap) {
+    bitmap->data = malloc(bitmap->height > 0 && bitmap->pitch > 0 ?
+                          (size_t)bitmap->pitch*bitmap->height : 1);
+    if(bitmap->data == NULL) return MT_E_OUT_OF_MEM;
+
+    return MT_E_NONE;
+}
+
+void mt_bitmap_free(MTBitmap *bitmap) {
+    free(bitmap->data);
+    bitmap->data = NULL;
+}
+
+void mt_rasterizer_free(MTRasterizer *rasterizer) {
+    free(rasterizer->cover);
+    free(rasterizer->area);
+    rasterizer->cover = NULL;
+    rasterizer->area = NULL;
+    rasterizer->cell_max = 0;
+}
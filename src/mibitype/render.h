@@ -35,6 +35,85 @@
 #ifndef MT_RENDER_H
 #define MT_RENDER_H
 
+#include <mibitype/font.h>
 
+/* The rasterizer works in fixed point with MT_RENDER_BITS fractional bits.
+ * The outlines aren't flattened: the area under the quadratic Bezier curves
+ * is integrated exactly in each cell they cross, like it is for the lines.
+ * The only errors come from rounding the points to the fixed point grid,
+ * which moves them by up to 1/(2*MT_RENDER_ONE) pixel on each axis and
+ * changes the alpha of a pixel by less than 1 out of 255, and from
+ * truncating the coverage to 8 bits. */
+#define MT_RENDER_BITS 8
+#define MT_RENDER_ONE (1<<MT_RENDER_BITS)
+
+/* The kernels that turn the accumulated cells into alpha values. They all
+ * give exactly the same results. */
+enum {
+    MT_RENDER_SCALAR,
+    MT_RENDER_SSE2,
+    MT_RENDER_AVX2,
+
+    MT_RENDER_KERNEL_AMOUNT
+};
+
+/* An 8-bit alpha bitmap. left and top are the position of the top left corner
+ * of the bitmap relative to the origin of the glyph, with Y going up, like
+ * the coordinates of the outlines. */
+typedef struct {
+    unsigned char *data;
+    int width, height;
+    /* The size of a row of data in bytes. */
+    int pitch;
+
+    int left, top;
+} MTBitmap;
+
+/* The state of the rasterizer. Each cell of the bitmap accumulates the signed
+ * height of the edges that cross it (cover) and the area they leave on their
+ * left (area). The buffers are kept between glyphs to avoid reallocating
+ * them. */
+typedef struct {
+    int *cover;
+    int *area;
+    size_t cell_max;
+
+    /* The size of the rows of cells, one more than the width of the bitmap,
+     * and the number of rows. */
+    int width, height;
+
+    /* Accumulate a row of width cells into out and clear them. */
+    void (*sweep)(int *cover, int *area, unsigned char *out, int width);
+    int kernel;
+} MTRasterizer;
+
+/* Initialize the rasterizer with the fastest kernel the CPU supports. */
+void mt_rasterizer_init(MTRasterizer *rasterizer);
+
+/* Check if the CPU supports one of the kernels. */
+int mt_render_kernel_supported(int kernel);
+
+/* Force the rasterizer to use another kernel, returns MT_E_IMPLEMENTATION if
+ * it isn't supported. */
+int mt_rasterizer_set_kernel(MTRasterizer *rasterizer, int kernel);
+
+/* Get the size and position of the bitmap of a glyph rendered with size
+ * pixels per em, with its origin moved right by subpixel/MT_RENDER_ONE
+ * pixels. The data pointer is left untouched. */
+void mt_render_get_box(MTFont *font, MTGlyph *glyph, int size, int subpixel,
+                       MTBitmap *bitmap);
+
+/* Render a glyph with size pixels per em into bitmap, of which the box was
+ * set by mt_render_get_box with the same subpixel offset and data points to
+ * height rows of pitch bytes. The nonzero winding rule is used. */
+int mt_render_glyph(MTRasterizer *rasterizer, MTFont *font, MTGlyph *glyph,
+                    int size, int subpixel, MTBitmap *bitmap);
+
+/* Allocate the data of a bitmap of which the box is set. */
+int mt_bitmap_alloc(MTBitmap *bitmap);
+
+void mt_bitmap_free(MTBitmap *bitmap);
+
+void mt_rasterizer_free(MTRasterizer *rasterizer);
 
 #endif
@@ -0,0 +1,376 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mibitype/runcache.h>
+#include <mibitype/errors.h>
+#include <mibitype/utf8.h>
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+size_t _mt_run_memory(size_t len, size_t glyph_num) {
+    /* The string, then the glyph ids and the positions. The string is padded
+     * so that the ids are aligned. Empty runs still take a byte, as malloc(0)
+     * may return NULL. */
+    const size_t size = (len+sizeof(size_t)-1)/sizeof(size_t)*sizeof(size_t)+
+                        glyph_num*(sizeof(size_t)+3*sizeof(int));
+
+    return size ? size : 1;
+}
+
+void _mt_run_set_arrays(MTRun *run, void *block, size_t len,
+                        size_t glyph_num) {
+    run->ids = (size_t*)((char*)block+(len+sizeof(size_t)-1)/sizeof(size_t)*
+                                      sizeof(size_t));
+    run->x = (int*)(run->ids+glyph_num);
+    run->y = run->x+glyph_num;
+    run->phase = run->y+glyph_num;
+}
+
+int _mt_run_to_pixels(MTFont *font, int points, long int size) {
+    /* Like mt_font_size_to_pixels, but size*points*dpi would overflow an int
+     * for long texts. The result is clamped so that it fits in the run. */
+    const double pixels = (double)size*points*font->dpi/
+                          (72.0*font->units_per_em);
+
+    if(pixels >= INT_MAX) return INT_MAX;
+    if(pixels <= INT_MIN) return INT_MIN;
+
+    return (int)pixels;
+}
+
+void _mt_run_set_x(MTRun *run, size_t n, MTFont *font, int points,
+                   int phases, long int x) {
+    /* Round to the nearest phase, a position that rounds up to the next pixel
+     * gets the phase 0 of that pixel. */
+    double pos = floor((double)x*points*font->dpi*phases/
+                       (72.0*font->units_per_em)+0.5);
+
+    run->x[n] = (int)floor(pos/phases);
+    run->phase[n] = (int)(pos-(double)run->x[n]*phases);
+}
+
+int _mt_run_layout(MTRun *run, MTFont *font, int points, int phases,
+                   const char *str, size_t len) {
+    /* The arrays of the run must be able to hold len glyphs, as there can't
+     * be more characters than bytes. */
+
+    unsigned long int chars[64];
+    size_t char_num;
+
+    long int *x;
+    long int advance;
+
+    size_t pos = 0;
+    size_t read;
+
+    size_t i;
+    size_t start = 0;
+    size_t num;
+
+    const long int line_height = font->ascender-font->descender+
+                                 font->line_gap;
+
+    run->num = 0;
+    run->advance = 0;
+    run->line_num = len ? 1 : 0;
+
+    /* Positions are computed in font units before being converted. */
+    x = malloc((len ? len : 1)*sizeof(long int));
+    if(x == NULL) return MT_E_OUT_OF_MEM;
+
+    while(1){
+        char_num = 0;
+        if(pos < len){
+            char_num = mt_utf8_decode(str+pos, len-pos, chars,
+                                      sizeof(chars)/sizeof(chars[0]), &read);
+            pos += read;
+        }
+
+        for(i=0;i<=char_num;i++){
+            if(i < char_num && chars[i] != '\n'){
+                run->ids[run->num++] = mt_font_get_glyph_id(font, chars[i]);
+                continue;
+            }
+            if(i == char_num && pos < len) break;
+
+            /* A line is complete, shape it. */
+            num = mt_font_substitute(font, run->ids+start, run->num-start);
+            advance = mt_font_position(font, run->ids+start, num, x+start);
+
+            num += start;
+            for(;start<num;start++){
+                _mt_run_set_x(run, start, font, points, phases, x[start]);
+                run->y[start] = _mt_run_to_pixels(font, points,
+                                                  line_height*
+                                                  (long int)(run->line_num-1));
+            }
+            run->num = num;
+
+            advance = _mt_run_to_pixels(font, points, advance);
+            if(advance > run->advance) run->advance = advance;
+
+            if(i < char_num) run->line_num++;
+        }
+
+        if(pos >= len) break;
+    }
+
+    free(x);
+
+    return MT_E_NONE;
+}
+
+int mt_run_layout(MTRun *run, MTFont *font, int points, int phases,
+                  const char *str, size_t len) {
+    void *block;
+
+    int rc;
+
+    block = malloc(_mt_run_memory(0, len));
+    if(block == NULL) return MT_E_OUT_OF_MEM;
+
+    _mt_run_set_arrays(run, block, 0, len);
+
+    if(phases < 1) phases = 1;
+
+    if((rc = _mt_run_layout(run, font, points, phases, str, len))){
+        mt_run_free(run);
+        return rc;
+    }
+
+    return MT_E_NONE;
+}
+
+void mt_run_free(MTRun *run) {
+    /* The ids are at the start of the block allocated by mt_run_layout. */
+    free(run->ids);
+    run->ids = NULL;
+    run->x = NULL;
+    run->y = NULL;
+    run->phase = NULL;
+    run->num = 0;
+}
+
+int mt_run_cache_init(MTRunCache *cache, size_t max_runs) {
+    size_t i;
+
+    if(!max_runs) max_runs = 1;
+
+    cache->entries = malloc(max_runs*sizeof(MTRunCacheEntry));
+    if(cache->entries == NULL) return MT_E_OUT_OF_MEM;
+
+    cache->entry_max = max_runs;
+
+    mt_map_init(&cache->map);
+
+    cache->lru_first = MT_RUN_NONE;
+    cache->lru_last = MT_RUN_NONE;
+
+    /* All the entries start free. */
+    for(i=0;i<max_runs;i++){
+        cache->entries[i].str = NULL;
+        cache->entries[i].next = i+1 < max_runs ? i+1 : MT_RUN_NONE;
+    }
+    cache->free_entry = 0;
+
+    cache->stats.hits = 0;
+    cache->stats.misses = 0;
+    cache->stats.evictions = 0;
+
+    return MT_E_NONE;
+}
+
+size_t _mt_run_cache_hash(MTFont *font, int points, int phases,
+                          const char *str, size_t len) {
+    /* FNV-1a over the string, mixed with the font, the size and the number of
+     * phases. */
+    unsigned long int hash = 2166136261UL;
+
+    size_t i;
+
+    for(i=0;i<len;i++){
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619UL;
+    }
+
+    hash ^= (size_t)font/sizeof(MTFont);
+    hash *= 16777619UL;
+    hash ^= points;
+    hash *= 16777619UL;
+    hash ^= phases;
+    hash *= 16777619UL;
+
+    /* This key is used for empty slots by the map. */
+    if((size_t)hash == MT_MAP_EMPTY) hash--;
+
+    return hash;
+}
+
+void _mt_run_cache_lru_remove(MTRunCache *cache, size_t n) {
+    MTRunCacheEntry *entry = cache->entries+n;
+
+    if(entry->prev != MT_RUN_NONE){
+        cache->entries[entry->prev].next = entry->next;
+    }else{
+        cache->lru_first = entry->next;
+    }
+
+    if(entry->next != MT_RUN_NONE){
+        cache->entries[entry->next].prev = entry->prev;
+    }else{
+        cache->lru_last = entry->prev;
+    }
+}
+
+void _mt_run_cache_lru_push(MTRunCache *cache, size_t n) {
+    MTRunCacheEntry *entry = cache->entries+n;
+
+    entry->prev = MT_RUN_NONE;
+    entry->next = cache->lru_first;
+
+    if(cache->lru_first != MT_RUN_NONE){
+        cache->entries[cache->lru_first].prev = n;
+    }else{
+        cache->lru_last = n;
+    }
+
+    cache->lru_first = n;
+}
+
+void _mt_run_cache_remove(MTRunCache *cache, size_t n) {
+    MTRunCacheEntry *entry = cache->entries+n;
+
+    _mt_run_cache_lru_remove(cache, n);
+    mt_map_remove(&cache->map, entry->hash);
+
+    free(entry->str);
+    entry->str = NULL;
+
+    entry->next = cache->free_entry;
+    cache->free_entry = n;
+}
+
+MTRun *mt_run_cache_get(MTRunCache *cache, MTFont *font, int points,
+                        int phases, const char *str, size_t len) {
+    MTRunCacheEntry *entry;
+
+    size_t hash;
+    size_t *slot;
+    size_t n;
+
+    if(phases < 1) phases = 1;
+
+    hash = _mt_run_cache_hash(font, points, phases, str, len);
+
+    slot = mt_map_get(&cache->map, hash);
+    if(slot != NULL){
+        entry = cache->entries+*slot;
+
+        if(entry->font == font && entry->points == points &&
+           entry->phases == phases && entry->len == len &&
+           !memcmp(entry->str, str, len)){
+            cache->stats.hits++;
+
+            _mt_run_cache_lru_remove(cache, *slot);
+            _mt_run_cache_lru_push(cache, *slot);
+
+            return &entry->run;
+        }
+
+        /* Another run has the same hash, replace it. */
+        _mt_run_cache_remove(cache, *slot);
+    }
+
+    cache->stats.misses++;
+
+    if(cache->free_entry == MT_RUN_NONE){
+        _mt_run_cache_remove(cache, cache->lru_last);
+        cache->stats.evictions++;
+    }
+
+    n = cache->free_entry;
+    entry = cache->entries+n;
+
+    entry->str = malloc(_mt_run_memory(len, len));
+    if(entry->str == NULL) return NULL;
+
+    _mt_run_set_arrays(&entry->run, entry->str, len, len);
+
+    if(_mt_run_layout(&entry->run, font, points, phases, str, len) ||
+       mt_map_set(&cache->map, hash, n)){
+        free(entry->str);
+        entry->str = NULL;
+        return NULL;
+    }
+
+    memcpy(entry->str, str, len);
+    entry->len = len;
+    entry->font = font;
+    entry->points = points;
+    entry->phases = phases;
+    entry->hash = hash;
+
+    cache->free_entry = entry->next;
+    _mt_run_cache_lru_push(cache, n);
+
+    return &entry->run;
+}
+
+void mt_run_cache_invalidate(MTRunCache *cache, MTFont *font) {
+    size_t n, next;
+
+    for(n=cache->lru_first;n!=MT_RUN_NONE;n=next){
+        next = cache->entries[n].next;
+
+        if(cache->entries[n].font == font) _mt_run_cache_remove(cache, n);
+    }
+}
+
+void mt_run_cache_clear(MTRunCache *cache) {
+    while(cache->lru_first != MT_RUN_NONE){
+        _mt_run_cache_remove(cache, cache->lru_first);
+    }
+}
+
+void mt_run_cache_free(MTRunCache *cache) {
+    mt_run_cache_clear(cache);
+
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->entry_max = 0;
+
+    mt_map_free(&cache->map);
+}
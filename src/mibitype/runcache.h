@@ -0,0 +1,121 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MT_RUNCACHE_H
+#define MT_RUNCACHE_H
+
+#include <mibitype/font.h>
+
+#define MT_RUN_NONE ((size_t)-1)
+
+/* A laid out run of text: the glyph ids after substitution and their
+ * positions in pixels. The positions are relative to the origin of the first
+ * line, X grows to the right and Y grows downwards, from one line to the
+ * next. The horizontal positions are rounded to 1/phases pixels: the glyph i
+ * is at x[i]+phase[i]/phases. */
+typedef struct {
+    size_t *ids;
+    int *x;
+    int *y;
+    int *phase;
+    size_t num;
+
+    /* The advance of the longest line in pixels. */
+    int advance;
+    size_t line_num;
+} MTRun;
+
+typedef struct {
+    MTRun run;
+
+    MTFont *font;
+    int points;
+    int phases;
+    /* The copy of the string, the arrays of the run are allocated in the
+     * same block. */
+    char *str;
+    size_t len;
+    size_t hash;
+
+    /* Links of the LRU list, next links the free entries together. */
+    size_t prev, next;
+} MTRunCacheEntry;
+
+typedef struct {
+    unsigned long int hits;
+    unsigned long int misses;
+    unsigned long int evictions;
+} MTRunCacheStats;
+
+/* A bounded cache of runs keyed by font, size and string. The entries are
+ * found with a hash of the key and the least recently used run is evicted
+ * when the cache is full. */
+typedef struct {
+    MTRunCacheEntry *entries;
+    size_t entry_max;
+
+    /* Maps the hashes of the keys to entries. */
+    MTMap map;
+
+    size_t lru_first, lru_last;
+    size_t free_entry;
+
+    MTRunCacheStats stats;
+} MTRunCache;
+
+/* Lay out len bytes of UTF-8 text at the size points. Lines are separated by
+ * '\n'. The glyph ids are substituted and positioned with kerning, with
+ * phases subpixel positions per pixel horizontally. The arrays of the run are
+ * allocated with malloc, use mt_run_free to free them. */
+int mt_run_layout(MTRun *run, MTFont *font, int points, int phases,
+                  const char *str, size_t len);
+
+void mt_run_free(MTRun *run);
+
+int mt_run_cache_init(MTRunCache *cache, size_t max_runs);
+
+/* Get the run of a string, laying it out if it isn't in the cache. The run
+ * stays valid until the next call that modifies the cache. Returns NULL if
+ * the run could not be laid out. */
+MTRun *mt_run_cache_get(MTRunCache *cache, MTFont *font, int points,
+                        int phases, const char *str, size_t len);
+
+/* Remove all the runs of a font, for example when it is freed. */
+void mt_run_cache_invalidate(MTRunCache *cache, MTFont *font);
+
+void mt_run_cache_clear(MTRunCache *cache);
+
+void mt_run_cache_free(MTRunCache *cache);
+
+#endif
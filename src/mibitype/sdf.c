@@ -0,0 +1,579 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mibitype/sdf.h>
+#include <mibitype/errors.h>
+
+#include <math.h>
+#include <string.h>
+
+/* Make sure that *array can hold num items of size bytes. */
+int _mt_sdf_reserve(void **array, size_t *max, size_t num, size_t size) {
+    void *new;
+    size_t new_max;
+
+    if(num <= *max) return MT_E_NONE;
+
+    new_max = *max ? *max : 64;
+    while(new_max < num) new_max *= 2;
+
+    new = realloc(*array, new_max*size);
+    if(new == NULL) return MT_E_OUT_OF_MEM;
+
+    *array = new;
+    *max = new_max;
+
+    return MT_E_NONE;
+}
+
+int _mt_sdf_add_line(MTSdf *sdf, double x0, double y0, double x1,
+                     double y1) {
+    MTSdfEdge *line;
+
+    if(_mt_sdf_reserve((void**)&sdf->lines, &sdf->line_max,
+                       sdf->line_num+1, sizeof(MTSdfEdge))){
+        return MT_E_OUT_OF_MEM;
+    }
+
+    line = sdf->lines+sdf->line_num++;
+    line->x0 = x0;
+    line->y0 = y0;
+    line->x2 = x1;
+    line->y2 = y1;
+    line->curve = 0;
+
+    return MT_E_NONE;
+}
+
+/* Add an edge, and the lines it is flattened to. */
+int _mt_sdf_add_edge(MTSdf *sdf, int curve, double x0, double y0, double x1,
+                     double y1, double x2, double y2) {
+    MTSdfEdge *edge;
+
+    double dx, dy;
+    double t, u;
+    double px = x0, py = y0;
+    double x, y;
+
+    long int i, n;
+
+    if(_mt_sdf_reserve((void**)&sdf->edges, &sdf->edge_max,
+                       sdf->edge_num+1, sizeof(MTSdfEdge))){
+        return MT_E_OUT_OF_MEM;
+    }
+
+    edge = sdf->edges+sdf->edge_num++;
+    edge->x0 = x0;
+    edge->y0 = y0;
+    edge->x1 = x1;
+    edge->y1 = y1;
+    edge->x2 = x2;
+    edge->y2 = y2;
+    edge->curve = curve;
+
+    if(!curve) return _mt_sdf_add_line(sdf, x0, y0, x2, y2);
+
+    /* The distance between a quadratic curve and its chord is at most a
+     * quarter of the length of p0-2p1+p2, and splitting the curve in n
+     * segments divides it by n*n. */
+    dx = x0-2*x1+x2;
+    dy = y0-2*y1+y2;
+    n = (long int)ceil(sqrt(sqrt(dx*dx+dy*dy)/4/MT_SDF_TOLERANCE));
+    if(n > 1024) n = 1024;
+    if(n < 1) n = 1;
+
+    for(i=1;i<=n;i++){
+        t = (double)i/n;
+        u = 1-t;
+        x = i < n ? u*u*x0+2*u*t*x1+t*t*x2 : x2;
+        y = i < n ? u*u*y0+2*u*t*y1+t*t*y2 : y2;
+        if(_mt_sdf_add_line(sdf, px, py, x, y)) return MT_E_OUT_OF_MEM;
+        px = x;
+        py = y;
+    }
+
+    return MT_E_NONE;
+}
+
+int _mt_sdf_contour(MTSdf *sdf, MTGlyph *glyph, size_t first, size_t last,
+                    double scale, double left, double top) {
+    size_t num = last-first+1;
+    size_t start;
+    size_t i, n;
+
+    double sx, sy;
+    double cx = 0, cy = 0;
+    double x, y;
+    double px, py;
+
+    int pending = 0;
+
+    int rc;
+
+    /* See _mt_render_contour. */
+    for(start=first;start<=last;start++){
+        if(MT_GLYPH_ON_CURVE(glyph, start)) break;
+    }
+
+    if(start <= last){
+        sx = MT_GLYPH_X(glyph, start)*scale-left;
+        sy = top-MT_GLYPH_Y(glyph, start)*scale;
+        start++;
+        num--;
+    }else{
+        start = first;
+        sx = (MT_GLYPH_X(glyph, first)+MT_GLYPH_X(glyph, last))*scale/2-left;
+        sy = top-(MT_GLYPH_Y(glyph, first)+MT_GLYPH_Y(glyph, last))*scale/2;
+    }
+
+    px = sx;
+    py = sy;
+
+    for(i=0;i<num;i++){
+        n = start+i;
+        if(n > last) n -= last-first+1;
+
+        x = MT_GLYPH_X(glyph, n)*scale-left;
+        y = top-MT_GLYPH_Y(glyph, n)*scale;
+
+        if(MT_GLYPH_ON_CURVE(glyph, n)){
+            if(pending){
+                rc = _mt_sdf_add_edge(sdf, 1, px, py, cx, cy, x, y);
+            }else{
+                rc = _mt_sdf_add_edge(sdf, 0, px, py, px, py, x, y);
+            }
+            if(rc) return rc;
+            px = x;
+            py = y;
+            pending = 0;
+        }else{
+            if(pending){
+                if((rc = _mt_sdf_add_edge(sdf, 1, px, py, cx, cy, (cx+x)/2,
+                                          (cy+y)/2))){
+                    return rc;
+                }
+                px = (cx+x)/2;
+                py = (cy+y)/2;
+            }
+            cx = x;
+            cy = y;
+            pending = 1;
+        }
+    }
+
+    if(pending) return _mt_sdf_add_edge(sdf, 1, px, py, cx, cy, sx, sy);
+
+    return _mt_sdf_add_edge(sdf, 0, px, py, px, py, sx, sy);
+}
+
+double _mt_sdf_cbrt(double v) {
+    return v < 0 ? -pow(-v, 1.0/3) : pow(v, 1.0/3);
+}
+
+/* Find the real roots of a*t^3+b*t^2+c*t+d. Returns the number of roots. */
+int _mt_sdf_solve(double a, double b, double c, double d, double *roots) {
+    double scale = fabs(a)+fabs(b)+fabs(c)+fabs(d);
+    double p, q, offset;
+    double disc;
+    double r, phi;
+    double f, df;
+
+    int num;
+    int i, n;
+
+    if(fabs(a) <= 1e-12*scale){
+        if(fabs(b) <= 1e-12*scale){
+            if(fabs(c) <= 1e-12*scale) return 0;
+            roots[0] = -d/c;
+            return 1;
+        }
+
+        disc = c*c-4*b*d;
+        if(disc < 0) return 0;
+
+        /* Avoid the cancellation of -c+sqrt(disc). */
+        q = -(c+(c < 0 ? -sqrt(disc) : sqrt(disc)))/2;
+        roots[0] = q/b;
+        if(q == 0) return 1;
+        roots[1] = d/q;
+        return 2;
+    }
+
+    b /= a;
+    c /= a;
+    d /= a;
+
+    /* Solve the depressed cubic t^3+p*t+q. */
+    p = c-b*b/3;
+    q = 2*b*b*b/27-b*c/3+d;
+    offset = -b/3;
+
+    disc = q*q/4+p*p*p/27;
+    if(disc > 0){
+        roots[0] = _mt_sdf_cbrt(-q/2+sqrt(disc))+
+                   _mt_sdf_cbrt(-q/2-sqrt(disc))+offset;
+        num = 1;
+    }else if(p > -1e-12){
+        roots[0] = _mt_sdf_cbrt(-q)+offset;
+        num = 1;
+    }else{
+        r = sqrt(-p/3);
+        phi = 3*q/(2*p)*sqrt(-3/p);
+        if(phi > 1) phi = 1;
+        if(phi < -1) phi = -1;
+        phi = acos(phi)/3;
+        for(i=0;i<3;i++){
+            roots[i] = 2*r*cos(phi-2*3.14159265358979323846*i/3)+offset;
+        }
+        num = 3;
+    }
+
+    /* Polish the roots with Newton's method. */
+    for(i=0;i<num;i++){
+        for(n=0;n<2;n++){
+            f = ((roots[i]+b)*roots[i]+c)*roots[i]+d;
+            df = (3*roots[i]+2*b)*roots[i]+c;
+            if(df == 0) break;
+            roots[i] -= f/df;
+        }
+    }
+
+    return num;
+}
+
+/* Get the squared distance between the point (x, y) and an edge. */
+double _mt_sdf_distance(MTSdfEdge *edge, double x, double y) {
+    double ax, ay, bx, by, mx, my;
+    double dx, dy;
+    double roots[3];
+    double t, u;
+    double dist, best;
+
+    int i, num;
+
+    mx = edge->x0-x;
+    my = edge->y0-y;
+
+    if(!edge->curve){
+        ax = edge->x2-edge->x0;
+        ay = edge->y2-edge->y0;
+        t = ax*ax+ay*ay;
+        t = t > 0 ? -(mx*ax+my*ay)/t : 0;
+        if(t < 0) t = 0;
+        if(t > 1) t = 1;
+        dx = mx+t*ax;
+        dy = my+t*ay;
+        return dx*dx+dy*dy;
+    }
+
+    /* The closest point of the curve B(t) is either an end or a point where
+     * (B(t)-P).B'(t) = 0, which is a cubic in t. */
+    ax = edge->x1-edge->x0;
+    ay = edge->y1-edge->y0;
+    bx = edge->x2-2*edge->x1+edge->x0;
+    by = edge->y2-2*edge->y1+edge->y0;
+
+    dx = edge->x2-x;
+    dy = edge->y2-y;
+    best = dx*dx+dy*dy;
+    dist = mx*mx+my*my;
+    if(dist < best) best = dist;
+
+    num = _mt_sdf_solve(bx*bx+by*by, 3*(ax*bx+ay*by),
+                        2*(ax*ax+ay*ay)+mx*bx+my*by, mx*ax+my*ay, roots);
+    for(i=0;i<num;i++){
+        t = roots[i];
+        if(!(t > 0 && t < 1)) continue;
+        u = 1-t;
+        dx = u*u*edge->x0+2*u*t*edge->x1+t*t*edge->x2-x;
+        dy = u*u*edge->y0+2*u*t*edge->y1+t*t*edge->y2-y;
+        dist = dx*dx+dy*dy;
+        if(dist < best) best = dist;
+    }
+
+    return best;
+}
+
+/* Get the range of buckets covered by the edge n grown by spread pixels. */
+void _mt_sdf_bucket_range(MTSdf *sdf, size_t n, int spread, int *bx0,
+                          int *by0, int *bx1, int *by1) {
+    MTSdfEdge *edge = sdf->edges+n;
+
+    /* The curves are contained in the hull of their control points. */
+    double xmin = edge->x0, xmax = edge->x0;
+    double ymin = edge->y0, ymax = edge->y0;
+
+    if(edge->x2 < xmin) xmin = edge->x2;
+    if(edge->x2 > xmax) xmax = edge->x2;
+    if(edge->y2 < ymin) ymin = edge->y2;
+    if(edge->y2 > ymax) ymax = edge->y2;
+    if(edge->curve){
+        if(edge->x1 < xmin) xmin = edge->x1;
+        if(edge->x1 > xmax) xmax = edge->x1;
+        if(edge->y1 < ymin) ymin = edge->y1;
+        if(edge->y1 > ymax) ymax = edge->y1;
+    }
+
+    *bx0 = (int)floor((xmin-spread)/sdf->bucket_size);
+    *by0 = (int)floor((ymin-spread)/sdf->bucket_size);
+    *bx1 = (int)floor((xmax+spread)/sdf->bucket_size);
+    *by1 = (int)floor((ymax+spread)/sdf->bucket_size);
+
+    if(*bx0 < 0) *bx0 = 0;
+    if(*by0 < 0) *by0 = 0;
+    if(*bx1 >= sdf->bucket_width) *bx1 = sdf->bucket_width-1;
+    if(*by1 >= sdf->bucket_height) *by1 = sdf->bucket_height-1;
+}
+
+int _mt_sdf_fill_buckets(MTSdf *sdf, int width, int height, int spread) {
+    size_t bucket_num;
+    size_t total;
+    size_t i, n;
+
+    int bx0, by0, bx1, by1;
+    int x, y;
+
+    sdf->bucket_size = spread < 4 ? 4 : spread;
+    sdf->bucket_width = (width+sdf->bucket_size-1)/sdf->bucket_size;
+    sdf->bucket_height = (height+sdf->bucket_size-1)/sdf->bucket_size;
+    bucket_num = (size_t)sdf->bucket_width*sdf->bucket_height;
+
+    if(_mt_sdf_reserve((void**)&sdf->bucket_starts, &sdf->bucket_max,
+                       bucket_num+1, sizeof(size_t))){
+        return MT_E_OUT_OF_MEM;
+    }
+
+    /* Count the edges of each bucket, then turn the counts into the starts of
+     * the buckets. */
+    memset(sdf->bucket_starts, 0, (bucket_num+1)*sizeof(size_t));
+    for(n=0;n<sdf->edge_num;n++){
+        _mt_sdf_bucket_range(sdf, n, spread, &bx0, &by0, &bx1, &by1);
+        for(y=by0;y<=by1;y++){
+            for(x=bx0;x<=bx1;x++){
+                sdf->bucket_starts[y*sdf->bucket_width+x+1]++;
+            }
+        }
+    }
+
+    for(i=0;i<bucket_num;i++){
+        sdf->bucket_starts[i+1] += sdf->bucket_starts[i];
+    }
+    total = sdf->bucket_starts[bucket_num];
+
+    if(_mt_sdf_reserve((void**)&sdf->bucket_edges, &sdf->bucket_edge_max,
+                       total ? total : 1, sizeof(size_t))){
+        return MT_E_OUT_OF_MEM;
+    }
+
+    /* Fill the buckets, this moves each start to the start of the next
+     * bucket, so they are shifted back afterwards. */
+    for(n=0;n<sdf->edge_num;n++){
+        _mt_sdf_bucket_range(sdf, n, spread, &bx0, &by0, &bx1, &by1);
+        for(y=by0;y<=by1;y++){
+            for(x=bx0;x<=bx1;x++){
+                sdf->bucket_edges[sdf->bucket_starts[y*sdf->bucket_width+
+                                                     x]++] = n;
+            }
+        }
+    }
+
+    for(i=bucket_num;i>0;i--) sdf->bucket_starts[i] = sdf->bucket_starts[i-1];
+    sdf->bucket_starts[0] = 0;
+
+    return MT_E_NONE;
+}
+
+/* Find where the row of pixel centers y crosses the outline, sorted from left
+ * to right. Returns the number of crossings. */
+size_t _mt_sdf_crossings(MTSdf *sdf, double y) {
+    MTSdfEdge *line;
+    MTSdfCrossing crossing;
+
+    size_t num = 0;
+    size_t i, n;
+
+    for(n=0;n<sdf->line_num;n++){
+        line = sdf->lines+n;
+        if((line->y0 <= y) == (line->y2 <= y)) continue;
+
+        crossing.x = line->x0+(y-line->y0)*(line->x2-line->x0)/
+                     (line->y2-line->y0);
+        crossing.dir = line->y2 > line->y0 ? 1 : -1;
+
+        /* There are only a few crossings per row, insert them in order. */
+        for(i=num;i>0&&sdf->crossings[i-1].x>crossing.x;i--){
+            sdf->crossings[i] = sdf->crossings[i-1];
+        }
+        sdf->crossings[i] = crossing;
+        num++;
+    }
+
+    return num;
+}
+
+void mt_sdf_init(MTSdf *sdf) {
+    sdf->edges = NULL;
+    sdf->edge_num = 0;
+    sdf->edge_max = 0;
+
+    sdf->lines = NULL;
+    sdf->line_num = 0;
+    sdf->line_max = 0;
+
+    sdf->bucket_size = 0;
+    sdf->bucket_width = 0;
+    sdf->bucket_height = 0;
+    sdf->bucket_starts = NULL;
+    sdf->bucket_max = 0;
+    sdf->bucket_edges = NULL;
+    sdf->bucket_edge_max = 0;
+
+    sdf->crossings = NULL;
+    sdf->crossing_max = 0;
+}
+
+void mt_sdf_get_box(MTFont *font, MTGlyph *glyph, int size, int spread,
+                    MTBitmap *bitmap) {
+    mt_render_get_box(font, glyph, size, 0, bitmap);
+    if(bitmap->width <= 0 || bitmap->height <= 0 || spread <= 0) return;
+
+    bitmap->left -= spread;
+    bitmap->top += spread;
+    bitmap->width += 2*spread;
+    bitmap->height += 2*spread;
+    bitmap->pitch = bitmap->width;
+}
+
+int mt_sdf_glyph(MTSdf *sdf, MTFont *font, MTGlyph *glyph, int size,
+                 int spread, MTBitmap *bitmap) {
+    MTSdfCrossing *crossings;
+    unsigned char *out;
+
+    size_t first;
+    size_t i, n;
+    size_t crossing_num, crossing;
+    size_t *edges;
+    size_t edge_num;
+
+    double scale;
+    double px, py;
+    double dist, best;
+    double v;
+
+    int winding;
+    int x, y;
+
+    int rc;
+
+    if(bitmap->width <= 0 || bitmap->height <= 0) return MT_E_NONE;
+    if(spread <= 0) return MT_E_IMPLEMENTATION;
+    if(font->units_per_em <= 0) return MT_E_CORRUPTED;
+
+    scale = (double)size/font->units_per_em;
+
+    sdf->edge_num = 0;
+    sdf->line_num = 0;
+
+    first = 0;
+    for(i=0;i<glyph->contour_num;i++){
+        if(glyph->contour_ends[i] >= glyph->point_num) break;
+        if(glyph->contour_ends[i] >= first){
+            if((rc = _mt_sdf_contour(sdf, glyph, first,
+                                     glyph->contour_ends[i], scale,
+                                     bitmap->left, bitmap->top))){
+                return rc;
+            }
+        }
+        first = glyph->contour_ends[i]+1;
+    }
+
+    if((rc = _mt_sdf_fill_buckets(sdf, bitmap->width, bitmap->height,
+                                  spread))){
+        return rc;
+    }
+
+    /* A row can't cross more lines than there are. */
+    if(_mt_sdf_reserve((void**)&sdf->crossings, &sdf->crossing_max,
+                       sdf->line_num+1, sizeof(MTSdfCrossing))){
+        return MT_E_OUT_OF_MEM;
+    }
+    crossings = sdf->crossings;
+
+    for(y=0;y<bitmap->height;y++){
+        py = y+0.5;
+        out = bitmap->data+y*bitmap->pitch;
+
+        crossing_num = _mt_sdf_crossings(sdf, py);
+        crossing = 0;
+        winding = 0;
+
+        for(x=0;x<bitmap->width;x++){
+            px = x+0.5;
+
+            for(;crossing<crossing_num&&crossings[crossing].x<px;crossing++){
+                winding += crossings[crossing].dir;
+            }
+
+            /* The edges that aren't in the bucket are further than spread,
+             * where the distance is clamped anyway. */
+            n = (y/sdf->bucket_size)*sdf->bucket_width+x/sdf->bucket_size;
+            edges = sdf->bucket_edges+sdf->bucket_starts[n];
+            edge_num = sdf->bucket_starts[n+1]-sdf->bucket_starts[n];
+
+            best = (double)spread*spread;
+            for(i=0;i<edge_num;i++){
+                dist = _mt_sdf_distance(sdf->edges+edges[i], px, py);
+                if(dist < best) best = dist;
+            }
+
+            dist = sqrt(best);
+            if(!winding) dist = -dist;
+
+            v = floor(128+dist*128/spread+0.5);
+            out[x] = v < 0 ? 0 : v > 255 ? 255 : (unsigned char)v;
+        }
+    }
+
+    return MT_E_NONE;
+}
+
+void mt_sdf_free(MTSdf *sdf) {
+    free(sdf->edges);
+    free(sdf->lines);
+    free(sdf->bucket_starts);
+    free(sdf->bucket_edges);
+    free(sdf->crossings);
+
+    mt_sdf_init(sdf);
+}
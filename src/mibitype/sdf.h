@@ -0,0 +1,104 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MT_SDF_H
+#define MT_SDF_H
+
+#include <mibitype/font.h>
+#include <mibitype/render.h>
+
+/* The maximum distance between a curve and the lines it is flattened to when
+ * finding if a pixel is inside of the glyph, in pixels. */
+#define MT_SDF_TOLERANCE (1.0/64)
+
+/* A line (curve = 0) or a quadratic Bezier curve of the outline, in pixels
+ * relative to the top left corner of the bitmap, with Y going down. Lines
+ * only use the first and the last point. */
+typedef struct {
+    double x0, y0;
+    double x1, y1;
+    double x2, y2;
+    int curve;
+} MTSdfEdge;
+
+typedef struct {
+    double x;
+    /* 1 if the edge goes down, -1 if it goes up. */
+    int dir;
+} MTSdfCrossing;
+
+/* The state of the signed distance field generator, the buffers are kept
+ * between glyphs to avoid reallocating them. */
+typedef struct {
+    MTSdfEdge *edges;
+    size_t edge_num, edge_max;
+
+    /* The outline flattened to lines, used to find the sign. */
+    MTSdfEdge *lines;
+    size_t line_num, line_max;
+
+    /* The edges are sorted in square buckets of bucket_size pixels: the edges
+     * that may be less than spread pixels away from a pixel of the bucket i
+     * are bucket_edges[bucket_starts[i]] to
+     * bucket_edges[bucket_starts[i+1]-1]. */
+    int bucket_size;
+    int bucket_width, bucket_height;
+    size_t *bucket_starts;
+    size_t bucket_max;
+    size_t *bucket_edges;
+    size_t bucket_edge_max;
+
+    MTSdfCrossing *crossings;
+    size_t crossing_max;
+} MTSdf;
+
+void mt_sdf_init(MTSdf *sdf);
+
+/* Get the size and position of the distance field of a glyph rendered with
+ * size pixels per em: the box of mt_render_get_box with spread more pixels on
+ * each side. */
+void mt_sdf_get_box(MTFont *font, MTGlyph *glyph, int size, int spread,
+                    MTBitmap *bitmap);
+
+/* Generate the signed distance field of a glyph into bitmap, of which the box
+ * was set by mt_sdf_get_box. Each pixel is set to 128+d*128/spread clamped to
+ * 0-255, where d is the distance in pixels from its center to the outline,
+ * positive inside of the glyph according to the nonzero winding rule. The
+ * outline is at 128 at any scale the bitmap is sampled at. */
+int mt_sdf_glyph(MTSdf *sdf, MTFont *font, MTGlyph *glyph, int size,
+                 int spread, MTBitmap *bitmap);
+
+void mt_sdf_free(MTSdf *sdf);
+
+#endif
@@ -0,0 +1,296 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mibitype/utf8.h>
+#include <mibitype/defs.h>
+
+#include <string.h>
+
+#if MT_UTF8_SIMD
+#include <immintrin.h>
+
+/* The SIMD kernels are compiled for their instruction set regardless of the
+ * flags of the build, and only called if the CPU supports it. */
+#define MT_UTF8_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+/* The high bit of each byte of an unsigned long int. */
+#define MT_UTF8_HIGH_BITS (((unsigned long int)-1)/0xFF*0x80)
+
+unsigned long int mt_utf8_next(const char *str, size_t len, size_t *pos) {
+    const unsigned char *s = (const unsigned char*)str;
+
+    size_t i = *pos;
+    size_t n, byte_num;
+
+    unsigned long int c;
+    unsigned char min, max;
+
+    c = s[i++];
+
+    if(c < 0x80){
+        *pos = i;
+        return c;
+    }
+
+    /* The allowed range of the second byte excludes overlong encodings,
+     * surrogates and characters above U+10FFFF. */
+    min = 0x80;
+    max = 0xBF;
+
+    if(c >= 0xC2 && c <= 0xDF){
+        byte_num = 2;
+        c &= 0x1F;
+    }else if(c >= 0xE0 && c <= 0xEF){
+        byte_num = 3;
+        if(c == 0xE0) min = 0xA0;
+        if(c == 0xED) max = 0x9F;
+        c &= 0x0F;
+    }else if(c >= 0xF0 && c <= 0xF4){
+        byte_num = 4;
+        if(c == 0xF0) min = 0x90;
+        if(c == 0xF4) max = 0x8F;
+        c &= 0x07;
+    }else{
+        /* Continuation bytes and bytes that can't appear in UTF-8. */
+        *pos = i;
+        return MT_UTF8_REPLACEMENT;
+    }
+
+    for(n=1;n<byte_num;n++){
+        if(i >= len || s[i] < min || s[i] > max){
+            /* Only skip the bytes that were valid so far. */
+            *pos = i;
+            return MT_UTF8_REPLACEMENT;
+        }
+
+        c = (c<<6)|(s[i++]&0x3F);
+
+        min = 0x80;
+        max = 0xBF;
+    }
+
+    *pos = i;
+
+    return c;
+}
+
+/* The ASCII kernels copy the run of ASCII characters at the start of s, that
+ * is len bytes long, to out, that has room for out_size characters, a block
+ * at a time. They stop at the first block that isn't only made of ASCII, or
+ * when less than a block is left, and return the number of characters
+ * copied. */
+
+size_t _mt_utf8_ascii_word(const unsigned char *s, size_t len,
+                           unsigned long int *out, size_t out_size) {
+    unsigned long int word;
+
+    size_t n = 0;
+    size_t i;
+
+    while(len-n >= sizeof(unsigned long int) &&
+          out_size-n >= sizeof(unsigned long int)){
+        memcpy(&word, s+n, sizeof(unsigned long int));
+        if(word&MT_UTF8_HIGH_BITS) break;
+
+        for(i=0;i<sizeof(unsigned long int);i++) out[n+i] = s[n+i];
+        n += sizeof(unsigned long int);
+    }
+
+    return n;
+}
+
+#if MT_UTF8_SIMD
+
+/* Store 4 characters held in 32-bit lanes, widening them if unsigned long
+ * int is 64 bits long. */
+MT_UTF8_TARGET("sse2")
+void _mt_utf8_store_sse2(unsigned long int *out, __m128i v) {
+    if(sizeof(unsigned long int) == 8){
+        _mm_storeu_si128((__m128i*)out,
+                         _mm_unpacklo_epi32(v, _mm_setzero_si128()));
+        _mm_storeu_si128((__m128i*)(out+2),
+                         _mm_unpackhi_epi32(v, _mm_setzero_si128()));
+    }else{
+        _mm_storeu_si128((__m128i*)out, v);
+    }
+}
+
+MT_UTF8_TARGET("sse2")
+size_t _mt_utf8_ascii_sse2(const unsigned char *s, size_t len,
+                           unsigned long int *out, size_t out_size) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i v, low, high;
+
+    size_t n = 0;
+
+    while(len-n >= 16 && out_size-n >= 16){
+        v = _mm_loadu_si128((const __m128i*)(s+n));
+        if(_mm_movemask_epi8(v)) break;
+
+        /* Widen the bytes to 16 bits, then to 32 bits. */
+        low = _mm_unpacklo_epi8(v, zero);
+        high = _mm_unpackhi_epi8(v, zero);
+        _mt_utf8_store_sse2(out+n, _mm_unpacklo_epi16(low, zero));
+        _mt_utf8_store_sse2(out+n+4, _mm_unpackhi_epi16(low, zero));
+        _mt_utf8_store_sse2(out+n+8, _mm_unpacklo_epi16(high, zero));
+        _mt_utf8_store_sse2(out+n+12, _mm_unpackhi_epi16(high, zero));
+        n += 16;
+    }
+
+    return n;
+}
+
+/* Store the 16 characters held in the bytes of v. */
+MT_UTF8_TARGET("avx2")
+void _mt_utf8_store_avx2(unsigned long int *out, __m128i v) {
+    if(sizeof(unsigned long int) == 8){
+        _mm256_storeu_si256((__m256i*)out, _mm256_cvtepu8_epi64(v));
+        _mm256_storeu_si256((__m256i*)(out+4),
+                            _mm256_cvtepu8_epi64(_mm_srli_si128(v, 4)));
+        _mm256_storeu_si256((__m256i*)(out+8),
+                            _mm256_cvtepu8_epi64(_mm_srli_si128(v, 8)));
+        _mm256_storeu_si256((__m256i*)(out+12),
+                            _mm256_cvtepu8_epi64(_mm_srli_si128(v, 12)));
+    }else{
+        _mm256_storeu_si256((__m256i*)out, _mm256_cvtepu8_epi32(v));
+        _mm256_storeu_si256((__m256i*)(out+8),
+                            _mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+    }
+}
+
+MT_UTF8_TARGET("avx2")
+size_t _mt_utf8_ascii_avx2(const unsigned char *s, size_t len,
+                           unsigned long int *out, size_t out_size) {
+    __m256i v;
+
+    size_t n = 0;
+
+    while(len-n >= 32 && out_size-n >= 32){
+        v = _mm256_loadu_si256((const __m256i*)(s+n));
+        if(_mm256_movemask_epi8(v)) break;
+
+        _mt_utf8_store_avx2(out+n, _mm256_castsi256_si128(v));
+        _mt_utf8_store_avx2(out+n+16, _mm256_extracti128_si256(v, 1));
+        n += 32;
+    }
+
+    return n;
+}
+
+#endif
+
+size_t mt_utf8_decode(const char *str, size_t len, unsigned long int *out,
+                      size_t out_size, size_t *read) {
+    const unsigned char *s = (const unsigned char*)str;
+
+    size_t (*ascii)(const unsigned char *s, size_t len,
+                    unsigned long int *out, size_t out_size);
+    size_t block;
+
+    size_t pos = 0;
+    size_t num = 0;
+    size_t n;
+    size_t run;
+
+    unsigned long int c;
+
+    ascii = _mt_utf8_ascii_word;
+    block = sizeof(unsigned long int);
+
+#if MT_UTF8_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        ascii = _mt_utf8_ascii_avx2;
+        block = 32;
+    }else if(__builtin_cpu_supports("sse2")){
+        ascii = _mt_utf8_ascii_sse2;
+        block = 16;
+    }
+#endif
+
+    /* The ASCII kernel is only tried once a block of ASCII characters was
+     * decoded since the last time, so that text that is mostly not ASCII
+     * doesn't pay for blocks that fail. */
+    run = block;
+
+    while(pos < len && num < out_size){
+        c = s[pos];
+
+        if(c < 0x80){
+            if(run >= block){
+                n = ascii(s+pos, len-pos, out+num, out_size-num);
+                pos += n;
+                num += n;
+                run = 0;
+                if(n) continue;
+            }
+
+            out[num++] = c;
+            pos++;
+            run++;
+            continue;
+        }
+
+        run = 0;
+
+        /* Decode the valid two and three bytes long sequences here, the
+         * others are left to mt_utf8_next. */
+        if(c >= 0xC2 && c <= 0xDF && len-pos >= 2 &&
+           (s[pos+1]&0xC0) == 0x80){
+            out[num++] = (c&0x1F)<<6|(s[pos+1]&0x3F);
+            pos += 2;
+            continue;
+        }
+
+        if((c&0xF0) == 0xE0 && len-pos >= 3 && (s[pos+1]&0xC0) == 0x80 &&
+           (s[pos+2]&0xC0) == 0x80){
+            c = (c&0x0F)<<12|(unsigned long int)(s[pos+1]&0x3F)<<6|
+                (s[pos+2]&0x3F);
+
+            /* Overlong encodings and surrogates. */
+            if(c >= 0x800 && (c < 0xD800 || c > 0xDFFF)){
+                out[num++] = c;
+                pos += 3;
+                continue;
+            }
+        }
+
+        out[num++] = mt_utf8_next(str, len, &pos);
+    }
+
+    *read = pos;
+
+    return num;
+}
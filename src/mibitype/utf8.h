@@ -0,0 +1,58 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MT_UTF8_H
+#define MT_UTF8_H
+
+#include <stddef.h>
+
+/* The character returned for malformed sequences. */
+#define MT_UTF8_REPLACEMENT 0xFFFD
+
+/* Decode the character starting at *pos in str, that is len bytes long, and
+ * move *pos to the next character. Malformed sequences (unexpected
+ * continuation bytes, overlong encodings, surrogates, characters above
+ * U+10FFFF and truncated sequences) are decoded as MT_UTF8_REPLACEMENT, one
+ * per maximal invalid subpart. *pos must be smaller than len. */
+unsigned long int mt_utf8_next(const char *str, size_t len, size_t *pos);
+
+/* Decode up to out_size characters of str, that is len bytes long, to out.
+ * Returns the number of characters written, *read is set to the number of
+ * bytes that were decoded. Malformed sequences are handled like in
+ * mt_utf8_next. Long runs of ASCII are decoded 8 to 32 bytes at a time,
+ * depending on what the CPU supports. */
+size_t mt_utf8_decode(const char *str, size_t len, unsigned long int *out,
+                      size_t out_size, size_t *read);
+
+#endif
@@ -0,0 +1,183 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+
+#include <mibitype/arena.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Some blocks are bigger than a chunk, so that they get their own. */
+#define ARENA_CHUNK 4096
+#define ARENA_SIZE_MAX 6000
+#define ARENA_BLOCKS 4000
+#define ARENA_ROUNDS 8
+
+typedef struct {
+    unsigned char *ptr;
+    size_t size;
+} ArenaBlock;
+
+void arena_fill(ArenaBlock *block, size_t n) {
+    size_t i;
+
+    for(i=0;i<block->size;i++) block->ptr[i] = (n*7+i)&0xFF;
+}
+
+/* Check that a block wasn't overwritten by another one. */
+int arena_check(ArenaBlock *block, size_t n) {
+    size_t i;
+
+    for(i=0;i<block->size;i++){
+        if(block->ptr[i] != ((n*7+i)&0xFF)) return 0;
+    }
+
+    return 1;
+}
+
+/* Release and reallocate random blocks, trimming the arena each time. */
+int arena_blocks(void) {
+    MTArena arena;
+    ArenaBlock *blocks;
+
+    unsigned long int seed = 8;
+
+    size_t i, n;
+    int round;
+
+    int failures = 0;
+
+    blocks = malloc(ARENA_BLOCKS*sizeof(ArenaBlock));
+    if(!TEST_CHECK(blocks != NULL, failures)) return failures;
+
+    mt_arena_init(&arena, ARENA_CHUNK);
+
+    for(i=0;i<ARENA_BLOCKS;i++) blocks[i].ptr = NULL;
+
+    for(round=0;round<ARENA_ROUNDS;round++){
+        for(i=0;i<ARENA_BLOCKS;i++){
+            if(blocks[i].ptr != NULL) continue;
+
+            blocks[i].size = test_random(&seed)%ARENA_SIZE_MAX+1;
+            blocks[i].ptr = mt_arena_alloc(&arena, blocks[i].size);
+            if(!TEST_CHECK(blocks[i].ptr != NULL, failures)) goto END;
+            arena_fill(blocks+i, i);
+        }
+
+        /* Release long runs of blocks so that whole chunks get empty. */
+        n = test_random(&seed)%ARENA_BLOCKS;
+        for(i=0;i<ARENA_BLOCKS;i++){
+            if((i+n)%ARENA_BLOCKS < ARENA_BLOCKS/2 ||
+               test_random(&seed)%4 == 0){
+                mt_arena_release(&arena, blocks[i].ptr, blocks[i].size);
+                blocks[i].ptr = NULL;
+            }
+        }
+
+        arena.trim_at = 0;
+        mt_arena_trim(&arena);
+
+        for(i=0;i<ARENA_BLOCKS;i++){
+            if(blocks[i].ptr == NULL) continue;
+
+            if(!TEST_CHECK(arena_check(blocks+i, i), failures)){
+                printf("block %lu was overwritten in round %d\n",
+                       (unsigned long int)i, round);
+                goto END;
+            }
+        }
+    }
+
+    for(i=0;i<ARENA_BLOCKS;i++){
+        mt_arena_release(&arena, blocks[i].ptr, blocks[i].size);
+    }
+
+    arena.trim_at = 0;
+    mt_arena_trim(&arena);
+
+    /* Only the chunk of the bump pointer is kept. */
+    TEST_CHECK(arena.chunk_num <= 1, failures);
+    TEST_CHECK(arena.memory <= ARENA_CHUNK, failures);
+    TEST_CHECK(arena.released == 0, failures);
+    for(n=0;n<MT_ARENA_CLASSES;n++){
+        TEST_CHECK(arena.free_lists[n] == NULL, failures);
+    }
+
+END:
+    mt_arena_free(&arena);
+    free(blocks);
+
+    return failures;
+}
+
+/* Evicting all the glyphs must give the chunks of the arena back. */
+int arena_font(char *file) {
+    MTReader reader;
+    MTFont font;
+
+    size_t i;
+    size_t memory;
+
+    int failures = 0;
+
+    if(test_font_init(&font, &reader, file)) return 1;
+
+    for(i=1;i<font.metrics_num;i++) mt_font_get_glyph_by_id(&font, i);
+
+    memory = font.arena.memory;
+
+    mt_font_set_budget(&font, 1);
+
+    /* The missing glyph and the bump pointer keep up to two chunks. */
+    TEST_CHECK(font.stats.memory == 0, failures);
+    if(!TEST_CHECK(font.arena.memory <= 2*font.arena.chunk_size, failures)){
+        printf("%lu bytes of chunks are kept out of %lu\n",
+               (unsigned long int)font.arena.memory,
+               (unsigned long int)memory);
+    }
+
+    test_font_free(&font, &reader);
+
+    return failures;
+}
+
+int test_arena(char *file) {
+    int failures;
+
+    failures = arena_blocks();
+    failures += arena_font(file);
+
+    return failures;
+}
@@ -0,0 +1,239 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+
+#include <mibitype/atlas.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ATLAS_PAGE_SIZE 64
+#define ATLAS_PAGE_MAX 2
+#define ATLAS_PHASES 4
+
+#define ATLAS_ID_NUM 48
+#define ATLAS_SIZE_MIN 8
+#define ATLAS_SIZE_NUM 12
+#define ATLAS_OPS 4000
+#define ATLAS_CHECK_EVERY 100
+
+/* Check that a glyph is the same as when it is rendered on its own. */
+int atlas_pixels(MTAtlas *atlas, MTRasterizer *rasterizer,
+                 MTAtlasEntry *entry) {
+    MTAtlasGlyph *glyph = &entry->glyph;
+    MTGlyph *outline;
+    MTBitmap bitmap;
+    unsigned char *data;
+
+    int row;
+
+    int failures = 0;
+
+    outline = mt_font_get_glyph_by_id(atlas->font, entry->id);
+    mt_render_get_box(atlas->font, outline, entry->size, entry->subpixel,
+                      &bitmap);
+    if(!TEST_CHECK(bitmap.width == glyph->width &&
+                   bitmap.height == glyph->height &&
+                   bitmap.left == glyph->left && bitmap.top == glyph->top,
+                   failures)){
+        return failures;
+    }
+    if(!TEST_CHECK(!mt_bitmap_alloc(&bitmap), failures)) return failures;
+    TEST_CHECK(!mt_render_glyph(rasterizer, atlas->font, outline,
+                                entry->size, entry->subpixel, &bitmap),
+               failures);
+
+    data = atlas->pages[glyph->page].data+
+           (size_t)glyph->y*atlas->page_size+glyph->x;
+    for(row=0;row<glyph->height;row++){
+        if(!TEST_CHECK(!memcmp(data+(size_t)row*atlas->page_size,
+                               bitmap.data+(size_t)row*bitmap.pitch,
+                               glyph->width), failures)){
+            printf("glyph %lu at %d px moved to page %lu at %d, %d has the "
+                   "wrong pixels\n", (unsigned long int)entry->id,
+                   entry->size, (unsigned long int)glyph->page, glyph->x,
+                   glyph->y);
+            break;
+        }
+    }
+
+    mt_bitmap_free(&bitmap);
+
+    return failures;
+}
+
+/* Check that the rectangles of the glyphs, padding included, are in their
+ * page and don't overlap, and that the padding is empty. If rasterizer isn't
+ * NULL, the pixels of the glyphs are checked too. */
+int atlas_check(MTAtlas *atlas, MTRasterizer *rasterizer) {
+    const size_t page_area = (size_t)atlas->page_size*atlas->page_size;
+
+    MTAtlasEntry *entry;
+    MTAtlasGlyph *glyph;
+    unsigned char *used;
+    unsigned char *data;
+
+    size_t n;
+    int x, y;
+
+    int failures = 0;
+
+    used = calloc(atlas->page_max, page_area);
+    if(!TEST_CHECK(used != NULL, failures)) return failures;
+
+    for(n=0;n<atlas->entry_num && !failures;n++){
+        entry = atlas->entries+n;
+        glyph = &entry->glyph;
+        if(entry->hash == MT_MAP_EMPTY || glyph->page == MT_ATLAS_NONE){
+            continue;
+        }
+
+        if(!TEST_CHECK(glyph->page < atlas->page_num && glyph->x >= 0 &&
+                       glyph->y >= 0 &&
+                       glyph->x+glyph->width+MT_ATLAS_PADDING <=
+                       atlas->page_size &&
+                       glyph->y+glyph->height+MT_ATLAS_PADDING <=
+                       atlas->page_size, failures)){
+            break;
+        }
+
+        data = atlas->pages[glyph->page].data;
+        for(y=glyph->y;y<glyph->y+glyph->height+MT_ATLAS_PADDING;y++){
+            for(x=glyph->x;x<glyph->x+glyph->width+MT_ATLAS_PADDING;x++){
+                if(!TEST_CHECK(!used[glyph->page*page_area+
+                                     (size_t)y*atlas->page_size+x],
+                               failures)){
+                    printf("glyph %lu at %d px overlaps another one at %d, "
+                           "%d on page %lu\n", (unsigned long int)entry->id,
+                           entry->size, x, y,
+                           (unsigned long int)glyph->page);
+                    y = atlas->page_size;
+                    break;
+                }
+                used[glyph->page*page_area+(size_t)y*atlas->page_size+x] = 1;
+
+                if(x >= glyph->x+glyph->width ||
+                   y >= glyph->y+glyph->height){
+                    TEST_CHECK(!data[(size_t)y*atlas->page_size+x],
+                               failures);
+                }
+            }
+        }
+
+        if(rasterizer != NULL && !failures){
+            failures += atlas_pixels(atlas, rasterizer, entry);
+        }
+    }
+
+    free(used);
+
+    return failures;
+}
+
+int test_atlas(char *file) {
+    MTReader reader;
+    MTFont font;
+    MTAtlas atlas;
+    MTAtlasGlyph *glyph;
+    MTAtlasEntry *entry;
+    MTRasterizer rasterizer;
+
+    unsigned long int seed = 22;
+    unsigned long int compactions = 0;
+
+    size_t id;
+    int size, subpixel;
+    int i;
+
+    int failures = 0;
+
+    if(test_font_init(&font, &reader, file)) return 1;
+    if(!TEST_CHECK(!mt_atlas_init(&atlas, &font, ATLAS_PAGE_SIZE,
+                                  ATLAS_PAGE_MAX, ATLAS_PHASES), failures)){
+        test_font_free(&font, &reader);
+        return failures;
+    }
+    mt_rasterizer_init(&rasterizer);
+
+    for(i=0;i<ATLAS_OPS && !failures;i++){
+        id = test_random(&seed)%ATLAS_ID_NUM%font.metrics_num;
+        size = ATLAS_SIZE_MIN+test_random(&seed)%ATLAS_SIZE_NUM;
+        subpixel = test_random(&seed)%ATLAS_PHASES*MT_RENDER_ONE/
+                   ATLAS_PHASES;
+
+        /* Remove some glyphs, so that there is space to reclaim by
+         * compacting the pages. */
+        if(test_random(&seed)%3 == 0){
+            mt_atlas_remove(&atlas, id, size, subpixel);
+            continue;
+        }
+
+        glyph = mt_atlas_get(&atlas, id, size, subpixel);
+        if(!TEST_CHECK(glyph != NULL, failures)) break;
+
+        entry = (MTAtlasEntry*)glyph;
+        if(!TEST_CHECK(entry->hash != MT_MAP_EMPTY && entry->id == id &&
+                       entry->size == size && entry->subpixel == subpixel,
+                       failures)){
+            break;
+        }
+
+        /* The pixels are checked after each compaction, which moves
+         * them. */
+        if(atlas.stats.compactions != compactions ||
+           !(i%ATLAS_CHECK_EVERY)){
+            failures += atlas_check(&atlas, &rasterizer);
+            compactions = atlas.stats.compactions;
+        }else{
+            failures += atlas_check(&atlas, NULL);
+        }
+    }
+
+    failures += atlas_check(&atlas, &rasterizer);
+
+    /* Otherwise the test didn't check what it is for. */
+    TEST_CHECK(atlas.stats.compactions > 0 && atlas.stats.evictions > 0,
+               failures);
+
+    mt_atlas_clear(&atlas);
+    failures += atlas_check(&atlas, NULL);
+
+    mt_rasterizer_free(&rasterizer);
+    mt_atlas_free(&atlas);
+    test_font_free(&font, &reader);
+
+    return failures;
+}
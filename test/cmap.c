@@ -0,0 +1,195 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CMAP_BMP_NUM 0x10000
+#define CMAP_CHAR_NUM 0x110000
+
+/* Compare the glyph ids of all the characters of a format 4 subtable at pos
+ * with the ones of the font. The segments are walked one after the other
+ * instead of being searched. */
+int cmap_format4(MTView *cmap, size_t pos, MTFont *font) {
+    size_t length = MT_VIEW_U16(cmap, pos+2);
+    size_t seg_num = MT_VIEW_U16(cmap, pos+6)/2;
+    size_t ends = pos+14;
+    size_t starts = ends+seg_num*2+2;
+    size_t deltas = starts+seg_num*2;
+    size_t offsets = deltas+seg_num*2;
+    size_t glyphs = offsets+seg_num*2;
+    size_t end = pos+length;
+    size_t addr;
+
+    size_t c, s = 0;
+    size_t id, expected;
+
+    int failures = 0;
+
+    if(end > cmap->size) end = cmap->size;
+    if(!TEST_CHECK(glyphs <= end, failures)) return failures;
+
+    for(c=0;c<CMAP_BMP_NUM && !failures;c++){
+        while(s < seg_num && (size_t)MT_VIEW_U16(cmap, ends+s*2) < c) s++;
+
+        expected = 0;
+        if(s < seg_num && (size_t)MT_VIEW_U16(cmap, starts+s*2) <= c){
+            if(!MT_VIEW_U16(cmap, offsets+s*2)){
+                expected = (c+MT_VIEW_U16(cmap, deltas+s*2))&0xFFFF;
+            }else{
+                /* The offset is relative to its own position. */
+                addr = offsets+s*2+MT_VIEW_U16(cmap, offsets+s*2)+
+                       (c-MT_VIEW_U16(cmap, starts+s*2))*2;
+                if(addr >= glyphs && addr+2 <= end &&
+                   MT_VIEW_U16(cmap, addr)){
+                    expected = (MT_VIEW_U16(cmap, addr)+
+                                MT_VIEW_U16(cmap, deltas+s*2))&0xFFFF;
+                }
+            }
+        }
+
+        id = mt_font_get_glyph_id(font, c);
+        if(!TEST_CHECK(id == expected, failures)){
+            printf("U+%04lX: glyph %lu instead of %lu\n",
+                   (unsigned long int)c, (unsigned long int)id,
+                   (unsigned long int)expected);
+        }
+    }
+
+    return failures;
+}
+
+/* The same with the groups of a format 12 subtable, over all the planes. */
+int cmap_format12(MTView *cmap, size_t pos, MTFont *font) {
+    size_t group_num;
+    size_t groups = pos+16;
+    size_t group;
+
+    size_t c, g = 0;
+    size_t id, expected;
+
+    int failures = 0;
+
+    if(!TEST_CHECK(MT_VIEW_HAS(cmap, pos, 16), failures)) return failures;
+    group_num = MT_VIEW_U32(cmap, pos+12);
+    if(!TEST_CHECK(group_num <= (cmap->size-groups)/12, failures)){
+        return failures;
+    }
+
+    for(c=0;c<CMAP_CHAR_NUM && !failures;c++){
+        while(g < group_num && MT_VIEW_U32(cmap, groups+g*12+4) < c) g++;
+
+        expected = 0;
+        group = groups+g*12;
+        if(g < group_num && MT_VIEW_U32(cmap, group) <= c){
+            expected = c-MT_VIEW_U32(cmap, group)+MT_VIEW_U32(cmap, group+8);
+        }
+
+        id = mt_font_get_glyph_id(font, c);
+        if(!TEST_CHECK(id == expected, failures)){
+            printf("U+%04lX: glyph %lu instead of %lu\n",
+                   (unsigned long int)c, (unsigned long int)id,
+                   (unsigned long int)expected);
+        }
+    }
+
+    return failures;
+}
+
+int test_cmap(char *file) {
+    MTReader reader;
+    MTFont font;
+    MTView cmap;
+
+    unsigned short int *ids;
+
+    size_t i, num;
+    size_t pos;
+    unsigned short int platform, encoding, format;
+
+    int failures = 0;
+
+    if(test_font_init(&font, &reader, file)) return 1;
+
+    if(!TEST_CHECK(!test_font_table(&reader, "cmap", &cmap) &&
+                   cmap.size >= 4, failures)){
+        test_font_free(&font, &reader);
+        return failures;
+    }
+
+    /* Check every Unicode subtable the font could have picked: when a font
+     * has both formats, they map the BMP in the same way. */
+    num = MT_VIEW_U16(&cmap, 2);
+    for(i=0;i<num && MT_VIEW_HAS(&cmap, 4+i*8, 8);i++){
+        platform = MT_VIEW_U16(&cmap, 4+i*8);
+        encoding = MT_VIEW_U16(&cmap, 4+i*8+2);
+        pos = MT_VIEW_U32(&cmap, 4+i*8+4);
+        if(!MT_VIEW_HAS(&cmap, pos, 8)) continue;
+        if(platform && (platform != 3 || (encoding != 1 && encoding != 10))){
+            continue;
+        }
+
+        format = MT_VIEW_U16(&cmap, pos);
+        if(format == 4){
+            failures += cmap_format4(&cmap, pos, &font);
+        }else if(format == 12){
+            failures += cmap_format12(&cmap, pos, &font);
+        }
+    }
+
+    /* The glyph table must give the same ids as the loader. */
+    ids = malloc(CMAP_BMP_NUM*sizeof(unsigned short int));
+    if(TEST_CHECK(ids != NULL, failures)){
+        for(i=0;i<CMAP_BMP_NUM;i++) ids[i] = mt_font_get_glyph_id(&font, i);
+
+        if(TEST_CHECK(!mt_font_build_glyph_table(&font), failures)){
+            for(i=0;i<CMAP_BMP_NUM;i++){
+                if(!TEST_CHECK(mt_font_get_glyph_id(&font, i) == ids[i],
+                               failures)){
+                    printf("U+%04lX differs in the glyph table\n",
+                           (unsigned long int)i);
+                    break;
+                }
+            }
+        }
+
+        free(ids);
+    }
+
+    test_font_free(&font, &reader);
+
+    return failures;
+}
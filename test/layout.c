@@ -0,0 +1,734 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LAYOUT_TABLE_MAX 1024
+
+/* The longest string substituted by the GSUB test. */
+#define LAYOUT_GLYPH_MAX 8
+
+/* The pairs of glyphs checked are made of these ids and of the last glyph of
+ * the font. */
+#define LAYOUT_ID_NUM 6
+
+/* A table built by the tests, written in big endian. */
+typedef struct {
+    unsigned char data[LAYOUT_TABLE_MAX];
+    size_t size;
+} LayoutTable;
+
+/* A kerning value that the font must return. */
+typedef struct {
+    size_t left, right;
+    int value;
+} LayoutPair;
+
+void layout_set16(LayoutTable *table, size_t pos, unsigned long int value) {
+    if(pos+2 > LAYOUT_TABLE_MAX) return;
+    table->data[pos] = (value>>8)&0xFF;
+    table->data[pos+1] = value&0xFF;
+}
+
+void layout_u16(LayoutTable *table, unsigned long int value) {
+    if(table->size+2 > LAYOUT_TABLE_MAX) return;
+    layout_set16(table, table->size, value);
+    table->size += 2;
+}
+
+void layout_u32(LayoutTable *table, unsigned long int value) {
+    layout_u16(table, value>>16);
+    layout_u16(table, value&0xFFFF);
+}
+
+/* Point the offset written at pos to the end of the table, the offset being
+ * relative to base. */
+void layout_offset(LayoutTable *table, size_t pos, size_t base) {
+    layout_set16(table, pos, table->size-base);
+}
+
+/* Start a lookup list with num lookups, returns the position of the list. */
+size_t layout_lookup_list(LayoutTable *table, size_t num) {
+    const size_t list = table->size;
+
+    size_t i;
+
+    layout_u16(table, num);
+    for(i=0;i<num;i++) layout_u16(table, 0);
+
+    return list;
+}
+
+/* Write the header of the GPOS or GSUB table, with no scripts and the
+ * features of the tags given. Feature n uses the lookup n. The lookup list
+ * follows. */
+void layout_header(LayoutTable *table, char **tags, size_t tag_num) {
+    size_t i;
+    size_t features;
+
+    table->size = 0;
+    layout_u32(table, 0x00010000UL);
+    layout_u16(table, 10);
+    layout_u16(table, 12);
+    layout_u16(table, 0);
+
+    /* The script list isn't used by the font. */
+    layout_u16(table, 0);
+
+    features = table->size;
+    layout_u16(table, tag_num);
+    for(i=0;i<tag_num;i++){
+        layout_u16(table, (tags[i][0]<<8)|tags[i][1]);
+        layout_u16(table, (tags[i][2]<<8)|tags[i][3]);
+        layout_u16(table, 0);
+    }
+    for(i=0;i<tag_num;i++){
+        layout_offset(table, features+2+i*6+4, features);
+        layout_u16(table, 0);
+        layout_u16(table, 1);
+        layout_u16(table, i);
+    }
+
+    layout_offset(table, 8, 0);
+}
+
+/* Start the lookup n of a list, with subtable_num subtables. Returns its
+ * position, the subtable k is pointed to with
+ * layout_offset(table, lookup+6+k*2, lookup). */
+size_t layout_lookup(LayoutTable *table, size_t list, size_t n,
+                     unsigned int type, size_t subtable_num) {
+    const size_t lookup = table->size;
+
+    size_t i;
+
+    layout_offset(table, list+2+n*2, list);
+    layout_u16(table, type);
+    layout_u16(table, 0);
+    layout_u16(table, subtable_num);
+    for(i=0;i<subtable_num;i++) layout_u16(table, 0);
+
+    return lookup;
+}
+
+/* Load a font file with its GPOS, GSUB and kern tables replaced by a single
+ * table built by the test, so that we know everything it contains. The other
+ * tables are moved 16 bytes further to make room for the new record. */
+int layout_font_init(MTFont *font, MTReader *reader, char *file, char *tag,
+                     LayoutTable *table) {
+    const char *dropped[3] = {"GPOS", "GSUB", "kern"};
+
+    MTReader original;
+    unsigned char *data;
+    unsigned char *record;
+
+    size_t i, n;
+    size_t num, dir_size, end, size;
+    unsigned long int offset;
+
+    int rc;
+
+    if((rc = mt_reader_init(&original, file))){
+        printf("Failed to open %s (error %d)!\n", file, rc);
+        return rc;
+    }
+
+    num = original.size < 12 ? 0 : ((size_t)original.buffer[4]<<8)|
+                                   original.buffer[5];
+    dir_size = 12+num*16;
+    if(original.size < 12 || original.size < dir_size){
+        mt_reader_free(&original);
+        return 1;
+    }
+
+    end = (original.size+16+3)&~(size_t)3;
+    size = end+table->size;
+    data = calloc(size, 1);
+    if(data == NULL){
+        mt_reader_free(&original);
+        return 1;
+    }
+
+    memcpy(data, original.buffer, 12);
+    data[4] = ((num+1)>>8)&0xFF;
+    data[5] = (num+1)&0xFF;
+    memcpy(data+12, original.buffer+12, num*16);
+    memcpy(data+dir_size+16, original.buffer+dir_size,
+           original.size-dir_size);
+
+    mt_reader_free(&original);
+
+    for(i=0;i<num;i++){
+        record = data+12+i*16;
+        for(n=0;n<3;n++){
+            if(!memcmp(record, dropped[n], 4)) memcpy(record, "skip", 4);
+        }
+
+        offset = ((unsigned long int)record[8]<<24)|
+                 ((unsigned long int)record[9]<<16)|(record[10]<<8)|
+                 record[11];
+        offset += 16;
+        record[8] = (offset>>24)&0xFF;
+        record[9] = (offset>>16)&0xFF;
+        record[10] = (offset>>8)&0xFF;
+        record[11] = offset&0xFF;
+    }
+
+    record = data+dir_size;
+    memcpy(record, tag, 4);
+    record[8] = (end>>24)&0xFF;
+    record[9] = (end>>16)&0xFF;
+    record[10] = (end>>8)&0xFF;
+    record[11] = end&0xFF;
+    record[12] = (table->size>>24)&0xFF;
+    record[13] = (table->size>>16)&0xFF;
+    record[14] = (table->size>>8)&0xFF;
+    record[15] = table->size&0xFF;
+    memcpy(data+end, table->data, table->size);
+
+    if((rc = mt_reader_init_memory(reader, data, size, 1))){
+        free(data);
+        return rc;
+    }
+
+    if((rc = mt_font_init(font, reader, 96))){
+        printf("Failed to load %s with a new %s table (error %d)!\n", file,
+               tag, rc);
+        mt_reader_free(reader);
+        return rc;
+    }
+
+    return 0;
+}
+
+/* Check the kerning of all the pairs of the first glyphs and of the last
+ * one, and that the positions of a run include it. */
+int layout_check_pairs(MTFont *font, const LayoutPair *pairs,
+                       size_t pair_num) {
+    size_t ids[LAYOUT_ID_NUM+1];
+    size_t run[2];
+
+    long int x[2];
+    long int advance;
+
+    size_t i, n, p;
+    int expected, value;
+
+    int failures = 0;
+
+    for(i=0;i<LAYOUT_ID_NUM;i++) ids[i] = i;
+    ids[LAYOUT_ID_NUM] = font->metrics_num-1;
+
+    for(i=0;i<=LAYOUT_ID_NUM;i++){
+        for(n=0;n<=LAYOUT_ID_NUM;n++){
+            expected = 0;
+            for(p=0;p<pair_num;p++){
+                if(pairs[p].left == ids[i] && pairs[p].right == ids[n]){
+                    expected = pairs[p].value;
+                }
+            }
+
+            value = mt_font_get_kerning(font, ids[i], ids[n]);
+            if(!TEST_CHECK(value == expected, failures)){
+                printf("pair (%lu, %lu): %d instead of %d\n",
+                       (unsigned long int)ids[i], (unsigned long int)ids[n],
+                       value, expected);
+            }
+
+            run[0] = ids[i];
+            run[1] = ids[n];
+            advance = mt_font_get_metrics(font, ids[i])->advance_width+
+                      expected;
+            TEST_CHECK(mt_font_position(font, run, 2, x) == advance+
+                       mt_font_get_metrics(font, ids[n])->advance_width,
+                       failures);
+            TEST_CHECK(x[0] == 0 && x[1] == advance, failures);
+        }
+    }
+
+    /* Glyphs that aren't in the font never kern. */
+    TEST_CHECK(!mt_font_get_kerning(font, 1, font->metrics_num), failures);
+    TEST_CHECK(!mt_font_get_kerning(font, font->metrics_num, 2), failures);
+
+    return failures;
+}
+
+/* Add a format 0 kern subtable with the given coverage. */
+void layout_kern_subtable(LayoutTable *table, unsigned int coverage,
+                          const LayoutPair *pairs, size_t pair_num) {
+    size_t i;
+
+    layout_u16(table, 0);
+    layout_u16(table, 14+pair_num*6);
+    layout_u16(table, coverage);
+    layout_u16(table, pair_num);
+    /* The binary search fields aren't used. */
+    layout_u16(table, 0);
+    layout_u16(table, 0);
+    layout_u16(table, 0);
+
+    for(i=0;i<pair_num;i++){
+        layout_u16(table, pairs[i].left);
+        layout_u16(table, pairs[i].right);
+        layout_u16(table, pairs[i].value&0xFFFF);
+    }
+}
+
+int test_kern(char *file) {
+    MTReader reader;
+    MTFont font;
+    LayoutTable table;
+
+    /* The values of the horizontal subtables add up, the cross stream and
+     * the vertical ones are ignored. The last pair of the first subtable is
+     * out of the font. */
+    LayoutPair first[5] = {
+        {1, 2, -120},
+        {1, 3, 45},
+        {2, 1, -3},
+        {0, 1, 77},
+        {0, 1, 99}
+    };
+    const LayoutPair cross[1] = {{1, 2, 1000}};
+    const LayoutPair second[2] = {
+        {1, 2, 20},
+        {3, 3, -1}
+    };
+    LayoutPair expected[5] = {
+        {1, 2, -100},
+        {1, 3, 45},
+        {2, 1, -3},
+        {0, 1, 77},
+        {3, 3, -1}
+    };
+
+    int failures = 0;
+
+    /* The font is needed to know the id of its last glyph. */
+    if(test_font_init(&font, &reader, file)) return 1;
+    first[3].left = expected[3].left = font.metrics_num-1;
+    first[4].left = font.metrics_num;
+    test_font_free(&font, &reader);
+
+    table.size = 0;
+    layout_u16(&table, 0);
+    layout_u16(&table, 4);
+    layout_kern_subtable(&table, 0x0001, first, 5);
+    layout_kern_subtable(&table, 0x0005, cross, 1);
+    layout_kern_subtable(&table, 0x0000, cross, 1);
+    layout_kern_subtable(&table, 0x0001, second, 2);
+
+    if(layout_font_init(&font, &reader, file, "kern", &table)) return 1;
+
+    failures += layout_check_pairs(&font, expected, 5);
+
+    test_font_free(&font, &reader);
+
+    return failures;
+}
+
+/* Add a PairPos format 1 subtable for the pairs, sorted by left glyph, with
+ * only an X advance for the first glyph. */
+void layout_pair_pos1(LayoutTable *table, const LayoutPair *pairs,
+                      size_t pair_num) {
+    const size_t start = table->size;
+
+    size_t i, n, p;
+    size_t end;
+    size_t set_num = 0;
+
+    for(i=0;i<pair_num;i++){
+        if(!i || pairs[i].left != pairs[i-1].left) set_num++;
+    }
+
+    layout_u16(table, 1);
+    layout_u16(table, 0);
+    layout_u16(table, 0x0004);
+    layout_u16(table, 0);
+    layout_u16(table, set_num);
+    for(i=0;i<set_num;i++) layout_u16(table, 0);
+
+    layout_offset(table, start+2, start);
+    layout_u16(table, 1);
+    layout_u16(table, set_num);
+    for(i=0;i<pair_num;i++){
+        if(!i || pairs[i].left != pairs[i-1].left){
+            layout_u16(table, pairs[i].left);
+        }
+    }
+
+    for(i=0,n=0;i<pair_num;i=end,n++){
+        for(end=i;end<pair_num && pairs[end].left == pairs[i].left;end++);
+
+        layout_offset(table, start+10+n*2, start);
+        layout_u16(table, end-i);
+        for(p=i;p<end;p++){
+            layout_u16(table, pairs[p].right);
+            layout_u16(table, pairs[p].value&0xFFFF);
+        }
+    }
+}
+
+int test_gpos(char *file) {
+    MTReader reader;
+    MTFont font;
+    LayoutTable table;
+
+    /* The first lookup has a PairPos format 1 subtable whose records also
+     * contain placements and a value for the second glyph, then a class
+     * based one that covers the glyphs 1 to 4. The glyphs 1, 3 and 4 are in
+     * the class 1 of the left glyphs and 2 in the class 0, 2 and 5 are in
+     * the class 1 of the right glyphs, the pairs of the first subtable win
+     * over the classes. The second lookup is in an extension subtable and
+     * adds to the first one, and the third one isn't used by the kern
+     * feature. */
+    char *tags[3] = {"kern", "kern", "mark"};
+    LayoutPair extension[3] = {
+        {1, 2, 10},
+        {5, 1, 8},
+        {0, 0, 5}
+    };
+    const LayoutPair unused[2] = {
+        {1, 2, 999},
+        {4, 4, 999}
+    };
+    LayoutPair expected[14] = {
+        {1, 2, -50},
+        {1, 3, 15},
+        {1, 5, -33},
+        {2, 0, 3},
+        {2, 1, -5},
+        {2, 3, 3},
+        {2, 4, 3},
+        {2, 0, 3},
+        {3, 2, -33},
+        {3, 5, -33},
+        {4, 2, -33},
+        {4, 5, -33},
+        {5, 1, 8},
+        {0, 0, 5}
+    };
+
+    size_t lookups, lookup;
+    size_t start;
+
+    int failures = 0;
+
+    if(test_font_init(&font, &reader, file)) return 1;
+    extension[2].left = extension[2].right = font.metrics_num-1;
+    expected[7].right = font.metrics_num-1;
+    expected[13].left = expected[13].right = font.metrics_num-1;
+    test_font_free(&font, &reader);
+
+    layout_header(&table, tags, 3);
+    lookups = layout_lookup_list(&table, 3);
+
+    lookup = layout_lookup(&table, lookups, 0, 2, 2);
+
+    /* PairPos format 1 with X and Y placements and an X advance for the
+     * first glyph and an X placement for the second one. */
+    layout_offset(&table, lookup+6, lookup);
+    start = table.size;
+    layout_u16(&table, 1);
+    layout_u16(&table, 14);
+    layout_u16(&table, 0x0007);
+    layout_u16(&table, 0x0001);
+    layout_u16(&table, 2);
+    layout_u16(&table, 22);
+    layout_u16(&table, 44);
+    /* The coverage. */
+    layout_u16(&table, 1);
+    layout_u16(&table, 2);
+    layout_u16(&table, 1);
+    layout_u16(&table, 2);
+    /* The pairs of the glyph 1. */
+    layout_u16(&table, 2);
+    layout_u16(&table, 2);
+    layout_u16(&table, 7);
+    layout_u16(&table, 9);
+    layout_u16(&table, -60&0xFFFF);
+    layout_u16(&table, 3);
+    layout_u16(&table, 3);
+    layout_u16(&table, 0);
+    layout_u16(&table, 0);
+    layout_u16(&table, 15);
+    layout_u16(&table, 0);
+    /* The pairs of the glyph 2. */
+    layout_u16(&table, 1);
+    layout_u16(&table, 1);
+    layout_u16(&table, 0);
+    layout_u16(&table, 0);
+    layout_u16(&table, -5&0xFFFF);
+    layout_u16(&table, 0);
+    TEST_CHECK(table.size == start+56, failures);
+
+    /* PairPos format 2, with 2 classes on each side. */
+    layout_offset(&table, lookup+8, lookup);
+    start = table.size;
+    layout_u16(&table, 2);
+    layout_u16(&table, 24);
+    layout_u16(&table, 0x0004);
+    layout_u16(&table, 0);
+    layout_u16(&table, 34);
+    layout_u16(&table, 48);
+    layout_u16(&table, 2);
+    layout_u16(&table, 2);
+    /* The values of the classes (0, 0), (0, 1), (1, 0) and (1, 1). */
+    layout_u16(&table, 3);
+    layout_u16(&table, 0);
+    layout_u16(&table, 0);
+    layout_u16(&table, -33&0xFFFF);
+    /* The coverage, a range from 1 to 4. */
+    layout_u16(&table, 2);
+    layout_u16(&table, 1);
+    layout_u16(&table, 1);
+    layout_u16(&table, 4);
+    layout_u16(&table, 0);
+    /* The classes of the left glyphs, an array starting at 1. */
+    layout_u16(&table, 1);
+    layout_u16(&table, 1);
+    layout_u16(&table, 4);
+    layout_u16(&table, 1);
+    layout_u16(&table, 0);
+    layout_u16(&table, 1);
+    layout_u16(&table, 1);
+    /* The classes of the right glyphs, as ranges. */
+    layout_u16(&table, 2);
+    layout_u16(&table, 2);
+    layout_u16(&table, 2);
+    layout_u16(&table, 2);
+    layout_u16(&table, 1);
+    layout_u16(&table, 5);
+    layout_u16(&table, 5);
+    layout_u16(&table, 1);
+    TEST_CHECK(table.size == start+64, failures);
+
+    /* An extension subtable. */
+    lookup = layout_lookup(&table, lookups, 1, 9, 1);
+    layout_offset(&table, lookup+6, lookup);
+    layout_u16(&table, 1);
+    layout_u16(&table, 2);
+    layout_u32(&table, 8);
+    layout_pair_pos1(&table, extension, 3);
+
+    lookup = layout_lookup(&table, lookups, 2, 2, 1);
+    layout_offset(&table, lookup+6, lookup);
+    layout_pair_pos1(&table, unused, 2);
+
+    if(failures || layout_font_init(&font, &reader, file, "GPOS", &table)){
+        return 1;
+    }
+
+    failures += layout_check_pairs(&font, expected, 14);
+
+    test_font_free(&font, &reader);
+
+    return failures;
+}
+
+/* Substitute the glyphs of a string and compare them with the glyphs of
+ * another one, in which the characters from '1' to '5' stand for the glyphs
+ * of the ligatures. */
+int layout_substitute(MTFont *font, char *str, char *expected,
+                      size_t *ligatures) {
+    size_t ids[LAYOUT_GLYPH_MAX];
+    size_t id;
+
+    size_t i, num;
+
+    int failures = 0;
+
+    for(i=0;str[i];i++) ids[i] = mt_font_get_glyph_id(font, str[i]);
+    num = mt_font_substitute(font, ids, i);
+
+    if(!TEST_CHECK(num == strlen(expected), failures)){
+        printf("\"%s\" gives %lu glyphs\n", str, (unsigned long int)num);
+        return failures;
+    }
+
+    for(i=0;i<num;i++){
+        if(expected[i] >= '1' && expected[i] <= '5'){
+            id = ligatures[expected[i]-'1'];
+        }else{
+            id = mt_font_get_glyph_id(font, expected[i]);
+        }
+
+        if(!TEST_CHECK(ids[i] == id, failures)){
+            printf("glyph %lu of \"%s\" is %lu instead of %lu\n",
+                   (unsigned long int)i, str, (unsigned long int)ids[i],
+                   (unsigned long int)id);
+        }
+    }
+
+    return failures;
+}
+
+/* Add a ligature subtable for the ligatures starting with f, each one being
+ * a string of components followed by its glyph. */
+void layout_ligatures(LayoutTable *table, size_t f, size_t **ligatures,
+                      size_t ligature_num) {
+    const size_t start = table->size;
+    size_t set;
+
+    size_t i, n;
+
+    layout_u16(table, 1);
+    layout_u16(table, 0);
+    layout_u16(table, 1);
+    layout_u16(table, 0);
+
+    layout_offset(table, start+2, start);
+    layout_u16(table, 1);
+    layout_u16(table, 1);
+    layout_u16(table, f);
+
+    layout_offset(table, start+6, start);
+    set = table->size;
+    layout_u16(table, ligature_num);
+    for(i=0;i<ligature_num;i++) layout_u16(table, 0);
+
+    for(i=0;i<ligature_num;i++){
+        layout_offset(table, set+2+i*2, set);
+        for(n=1;ligatures[i][n] != MT_FONT_NONE;n++);
+        layout_u16(table, ligatures[i][n-1]);
+        layout_u16(table, n-1);
+        for(n=1;ligatures[i][n+1] != MT_FONT_NONE;n++){
+            layout_u16(table, ligatures[i][n]);
+        }
+    }
+}
+
+int test_gsub(char *file) {
+    MTReader reader;
+    MTFont font;
+    LayoutTable table;
+
+    /* The ligatures of the liga feature are tried in order: ffi is formed
+     * rather than ff, but fff never is as ff comes first. The ligature of the
+     * smcp feature isn't used, and the rlig feature replaces the ff ligature
+     * by a fourth glyph after the ligatures were formed. */
+    char *tags[3] = {"liga", "smcp", "rlig"};
+
+    size_t ffi[5], fi[4], ff[4], fff[5], ifl[4];
+    size_t *ligatures[4];
+    size_t glyphs[5];
+    size_t f, i;
+
+    size_t lookups, lookup;
+    size_t start;
+
+    int failures = 0;
+
+    if(test_font_init(&font, &reader, file)) return 1;
+    f = mt_font_get_glyph_id(&font, 'f');
+    i = mt_font_get_glyph_id(&font, 'i');
+    for(start=0;start<5;start++) glyphs[start] = font.metrics_num-5+start;
+    test_font_free(&font, &reader);
+
+    if(!TEST_CHECK(f && i && f < glyphs[0] && i < glyphs[0], failures)){
+        return failures;
+    }
+
+    ffi[0] = f;
+    ffi[1] = f;
+    ffi[2] = i;
+    ffi[3] = glyphs[0];
+    ffi[4] = MT_FONT_NONE;
+    fi[0] = f;
+    fi[1] = i;
+    fi[2] = glyphs[1];
+    fi[3] = MT_FONT_NONE;
+    ff[0] = f;
+    ff[1] = f;
+    ff[2] = glyphs[2];
+    ff[3] = MT_FONT_NONE;
+    fff[0] = f;
+    fff[1] = f;
+    fff[2] = f;
+    fff[3] = glyphs[4];
+    fff[4] = MT_FONT_NONE;
+    ifl[0] = i;
+    ifl[1] = f;
+    ifl[2] = glyphs[0];
+    ifl[3] = MT_FONT_NONE;
+    ligatures[0] = ffi;
+    ligatures[1] = fi;
+    ligatures[2] = ff;
+    ligatures[3] = fff;
+
+    layout_header(&table, tags, 3);
+    lookups = layout_lookup_list(&table, 3);
+
+    lookup = layout_lookup(&table, lookups, 0, 4, 1);
+    layout_offset(&table, lookup+6, lookup);
+    layout_ligatures(&table, f, ligatures, 4);
+
+    ligatures[0] = ifl;
+    lookup = layout_lookup(&table, lookups, 1, 4, 1);
+    layout_offset(&table, lookup+6, lookup);
+    layout_ligatures(&table, i, ligatures, 1);
+
+    /* A SingleSubst format 2 subtable replacing the ff ligature. */
+    lookup = layout_lookup(&table, lookups, 2, 1, 1);
+    layout_offset(&table, lookup+6, lookup);
+    start = table.size;
+    layout_u16(&table, 2);
+    layout_u16(&table, 8);
+    layout_u16(&table, 1);
+    layout_u16(&table, glyphs[3]);
+    layout_u16(&table, 1);
+    layout_u16(&table, 1);
+    layout_u16(&table, glyphs[2]);
+    TEST_CHECK(table.size == start+14, failures);
+
+    if(failures || layout_font_init(&font, &reader, file, "GSUB", &table)){
+        return 1;
+    }
+
+    failures += layout_substitute(&font, "fi", "2", glyphs);
+    failures += layout_substitute(&font, "ffi", "1", glyphs);
+    failures += layout_substitute(&font, "ff", "4", glyphs);
+    failures += layout_substitute(&font, "fff", "4f", glyphs);
+    failures += layout_substitute(&font, "fffi", "42", glyphs);
+    failures += layout_substitute(&font, "xfixf", "x2xf", glyphs);
+    failures += layout_substitute(&font, "if", "if", glyphs);
+    failures += layout_substitute(&font, "", "", glyphs);
+
+    test_font_free(&font, &reader);
+
+    return failures;
+}
@@ -0,0 +1,209 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+
+#include <mibitype/map.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAP_KEY_NUM 600
+#define MAP_OPS 40000
+#define MAP_CHECK_EVERY 500
+
+/* Get the slot a key lands in when it is alone in a table of size slots, or
+ * size if it couldn't be found. */
+size_t map_home(size_t key, size_t size) {
+    MTMap map;
+
+    size_t i;
+
+    mt_map_init(&map);
+    if(mt_map_set(&map, key, 0) || map.size != size){
+        mt_map_free(&map);
+        return size;
+    }
+
+    for(i=0;i<map.size && map.items[i].key != key;i++);
+
+    mt_map_free(&map);
+
+    return i;
+}
+
+/* Check that every key of the reference is in the map with its value, and
+ * that the map doesn't contain anything else. */
+int map_compare(MTMap *map, size_t *values, int *present) {
+    size_t i, num = 0;
+    size_t *value;
+
+    int failures = 0;
+
+    for(i=0;i<MAP_KEY_NUM;i++){
+        value = mt_map_get(map, i*0x9E3779B1UL);
+        if(present[i]){
+            num++;
+            if(!TEST_CHECK(value != NULL && *value == values[i], failures)){
+                printf("key %lu is missing or wrong\n", (unsigned long int)i);
+            }
+        }else{
+            TEST_CHECK(value == NULL, failures);
+        }
+    }
+
+    TEST_CHECK(map->num == num, failures);
+
+    /* Backward shift deletion doesn't leave tombstones behind. */
+    for(i=0,num=0;i<map->size;i++){
+        if(map->items[i].key != MT_MAP_EMPTY) num++;
+    }
+    TEST_CHECK(map->num == num, failures);
+
+    return failures;
+}
+
+/* Remove the first key of a cluster that wraps around the end of the table,
+ * the following ones must be shifted back across the wraparound. */
+int map_wraparound(void) {
+    MTMap map;
+
+    /* The first three keys belong to the last slot, the two other ones to
+     * the first and the second slot. */
+    size_t keys[5];
+    const size_t homes[5] = {15, 15, 15, 0, 1};
+    const size_t after[4] = {15, 0, 1, 2};
+
+    size_t i, n;
+    size_t key;
+    size_t *value;
+
+    int failures = 0;
+
+    for(i=0;i<5;i++){
+        key = i && homes[i] == homes[i-1] ? keys[i-1]+1 : 0;
+        while(map_home(key, 16) != homes[i]) key++;
+        keys[i] = key;
+    }
+
+    mt_map_init(&map);
+    for(i=0;i<5;i++){
+        if(!TEST_CHECK(!mt_map_set(&map, keys[i], i), failures)) break;
+    }
+    if(!TEST_CHECK(map.size == 16 && map.num == 5, failures)){
+        mt_map_free(&map);
+        return failures;
+    }
+
+    /* The cluster starts at the last slot and goes on at the first one. */
+    TEST_CHECK(map.items[15].key == keys[0] && map.items[0].key == keys[1] &&
+               map.items[1].key == keys[2] && map.items[2].key == keys[3] &&
+               map.items[3].key == keys[4], failures);
+
+    mt_map_remove(&map, keys[0]);
+    TEST_CHECK(mt_map_get(&map, keys[0]) == NULL, failures);
+    TEST_CHECK(map.num == 4 && map.items[3].key == MT_MAP_EMPTY, failures);
+
+    for(n=1;n<5;n++){
+        value = mt_map_get(&map, keys[n]);
+        TEST_CHECK(value != NULL && *value == n, failures);
+        TEST_CHECK(map.items[after[n-1]].key == keys[n], failures);
+    }
+
+    /* Removing a key that isn't in the map does nothing. */
+    mt_map_remove(&map, keys[0]);
+    TEST_CHECK(map.num == 4, failures);
+
+    mt_map_free(&map);
+
+    return failures;
+}
+
+/* Set and remove random keys, comparing the map with a plain array. */
+int map_random(void) {
+    MTMap map;
+
+    size_t values[MAP_KEY_NUM];
+    int present[MAP_KEY_NUM];
+
+    unsigned long int seed = 6;
+
+    size_t i, n;
+
+    int failures = 0;
+
+    mt_map_init(&map);
+    for(i=0;i<MAP_KEY_NUM;i++) present[i] = 0;
+
+    for(i=0;i<MAP_OPS && !failures;i++){
+        n = test_random(&seed)%MAP_KEY_NUM;
+
+        /* Remove a bit more often than we set, so that the map fills up and
+         * empties again. */
+        if(test_random(&seed)%(i%10000 < 5000 ? 3 : 5) < 2){
+            values[n] = test_random(&seed);
+            TEST_CHECK(!mt_map_set(&map, n*0x9E3779B1UL, values[n]),
+                       failures);
+            present[n] = 1;
+        }else{
+            mt_map_remove(&map, n*0x9E3779B1UL);
+            present[n] = 0;
+        }
+
+        if(!(i%MAP_CHECK_EVERY)){
+            failures += map_compare(&map, values, present);
+        }
+    }
+
+    failures += map_compare(&map, values, present);
+
+    mt_map_clear(&map);
+    for(i=0;i<MAP_KEY_NUM;i++) present[i] = 0;
+    failures += map_compare(&map, values, present);
+
+    mt_map_free(&map);
+
+    return failures;
+}
+
+int test_map(char *file) {
+    int failures = 0;
+
+    (void)file;
+
+    failures += map_wraparound();
+    failures += map_random();
+
+    return failures;
+}
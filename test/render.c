@@ -0,0 +1,459 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+
+#include <mibitype/render.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Random rows go up to this width, to cover all the tails of the 4 and 8
+ * cells wide kernels. */
+#define KERNEL_WIDTH_MAX 70
+#define KERNEL_ROWS 20000
+
+#define KERNEL_SIZE_NUM 3
+
+/* The reference coverage samples each row of pixels on this many lines, and
+ * cuts the curves in this many lines. */
+#define COVERAGE_SAMPLES 256
+#define COVERAGE_STEPS 128
+#define COVERAGE_SIZE_NUM 4
+#define COVERAGE_SUBPIXEL_NUM 2
+
+/* The alpha values may be off by one for the truncation to 8 bits, and by
+ * one for the rounding of the points to the fixed point grid and the
+ * sampling of the reference. */
+#define COVERAGE_TOLERANCE 2
+
+/* Fill a row of width cells (plus the border cell) like edges would, with up
+ * to three edges per cell. Some rows get a lot of overlapping edges, so that
+ * the coverage has to be clamped. */
+void kernel_random_row(int *cover, int *area, int width,
+                       unsigned long int *seed) {
+    int x;
+    int n, edges;
+    int dy;
+    int overlap;
+
+    overlap = test_random(seed)%4 == 0 ? 8 : 1;
+
+    for(x=0;x<=width;x++){
+        cover[x] = 0;
+        area[x] = 0;
+
+        edges = test_random(seed)%4;
+        for(n=0;n<edges;n++){
+            dy = (int)(test_random(seed)%(2*MT_RENDER_ONE+1))-MT_RENDER_ONE;
+            dy *= overlap;
+            cover[x] += dy;
+            area[x] += dy*(int)(test_random(seed)%(MT_RENDER_ONE+1)+
+                                test_random(seed)%(MT_RENDER_ONE+1));
+        }
+    }
+}
+
+int kernel_random_rows(MTRasterizer *reference, MTRasterizer *rasterizer) {
+    int cover[2][KERNEL_WIDTH_MAX+1];
+    int area[2][KERNEL_WIDTH_MAX+1];
+    /* One more byte to catch kernels that write after the row. */
+    unsigned char out[2][KERNEL_WIDTH_MAX+1];
+
+    unsigned long int seed = 21;
+
+    int width;
+    int row;
+    int x;
+
+    int failures = 0;
+
+    for(row=0;row<KERNEL_ROWS;row++){
+        /* Go through all the widths first, then random ones. */
+        width = row < KERNEL_WIDTH_MAX ? row+1 :
+                (int)(test_random(&seed)%KERNEL_WIDTH_MAX)+1;
+
+        kernel_random_row(cover[0], area[0], width, &seed);
+        memcpy(cover[1], cover[0], sizeof(cover[0]));
+        memcpy(area[1], area[0], sizeof(area[0]));
+        memset(out, 0xAA, sizeof(out));
+
+        reference->sweep(cover[0], area[0], out[0], width);
+        rasterizer->sweep(cover[1], area[1], out[1], width);
+
+        if(!TEST_CHECK(!memcmp(out[0], out[1], sizeof(out[0])), failures)){
+            printf("row %d of width %d differs\n", row, width);
+            return failures;
+        }
+        for(x=0;x<=width;x++){
+            if(!TEST_CHECK(!cover[1][x] && !area[1][x], failures)){
+                printf("cell %d of row %d isn't cleared\n", x, row);
+                return failures;
+            }
+        }
+    }
+
+    return failures;
+}
+
+int kernel_glyph_rows(MTRasterizer *reference, MTRasterizer *rasterizer,
+                      MTFont *font) {
+    const int sizes[KERNEL_SIZE_NUM] = {9, 31, 120};
+
+    MTGlyph *glyph;
+    MTBitmap bitmap[2];
+
+    size_t id;
+    size_t i;
+    int subpixel;
+
+    int failures = 0;
+
+    for(id=0;id<font->metrics_num;id++){
+        glyph = mt_font_get_glyph_by_id(font, id);
+
+        for(i=0;i<KERNEL_SIZE_NUM;i++){
+            subpixel = (int)(id*37%MT_RENDER_ONE);
+
+            mt_render_get_box(font, glyph, sizes[i], subpixel, bitmap);
+            bitmap[1] = bitmap[0];
+            if(mt_bitmap_alloc(bitmap)) return failures+1;
+            if(mt_bitmap_alloc(bitmap+1)){
+                mt_bitmap_free(bitmap);
+                return failures+1;
+            }
+
+            TEST_CHECK(!mt_render_glyph(reference, font, glyph, sizes[i],
+                                        subpixel, bitmap), failures);
+            TEST_CHECK(!mt_render_glyph(rasterizer, font, glyph, sizes[i],
+                                        subpixel, bitmap+1), failures);
+            if(!TEST_CHECK(!memcmp(bitmap[0].data, bitmap[1].data,
+                                   (size_t)bitmap[0].pitch*bitmap[0].height),
+                           failures)){
+                printf("glyph %lu at %d px differs\n",
+                       (unsigned long int)id, sizes[i]);
+            }
+
+            mt_bitmap_free(bitmap);
+            mt_bitmap_free(bitmap+1);
+
+            if(failures) return failures;
+        }
+    }
+
+    return failures;
+}
+
+int test_kernels(char *file) {
+    char *names[MT_RENDER_KERNEL_AMOUNT] = {"scalar", "SSE2", "AVX2"};
+
+    MTReader reader;
+    MTFont font;
+    MTRasterizer reference, rasterizer;
+
+    int kernel;
+    int failures = 0;
+
+    if(test_font_init(&font, &reader, file)) return 1;
+
+    mt_rasterizer_init(&reference);
+    mt_rasterizer_set_kernel(&reference, MT_RENDER_SCALAR);
+
+    /* The scalar kernel is checked against itself too, which checks the
+     * test. */
+    for(kernel=0;kernel<MT_RENDER_KERNEL_AMOUNT;kernel++){
+        if(!mt_render_kernel_supported(kernel)){
+            printf("%s kernel not supported, skipped\n", names[kernel]);
+            continue;
+        }
+
+        mt_rasterizer_init(&rasterizer);
+        TEST_CHECK(!mt_rasterizer_set_kernel(&rasterizer, kernel), failures);
+
+        failures += kernel_random_rows(&reference, &rasterizer);
+        failures += kernel_glyph_rows(&reference, &rasterizer, &font);
+
+        mt_rasterizer_free(&rasterizer);
+
+        if(failures){
+            printf("%s kernel failed\n", names[kernel]);
+            break;
+        }
+    }
+
+    mt_rasterizer_free(&reference);
+    test_font_free(&font, &reader);
+
+    return failures;
+}
+
+/* The exact signed coverage of the pixels is accumulated in acc, and the
+ * winding added for all the pixels on the right of a sample in carry, that
+ * has one more cell per row. */
+typedef struct {
+    double *acc;
+    double *carry;
+    int width, height;
+} Coverage;
+
+void coverage_line(Coverage *coverage, double xa, double ya, double xb,
+                   double yb) {
+    double d = yb > ya ? 1.0/COVERAGE_SAMPLES : -1.0/COVERAGE_SAMPLES;
+    double ymin = ya < yb ? ya : yb;
+    double ymax = ya < yb ? yb : ya;
+    double x, y;
+
+    long int k, last;
+    long int row, p;
+
+    if(ya == yb) return;
+
+    /* The samples are in the middle of the lines, the ones at ymin are
+     * counted and the ones at ymax aren't so that the joints aren't counted
+     * twice. */
+    k = (long int)ceil(ymin*COVERAGE_SAMPLES-0.5);
+    last = (long int)ceil(ymax*COVERAGE_SAMPLES-0.5)-1;
+    for(;k<=last;k++){
+        row = k/COVERAGE_SAMPLES;
+        if(k < 0 || row >= coverage->height) continue;
+
+        y = (k+0.5)/COVERAGE_SAMPLES;
+        x = xa+(xb-xa)*(y-ya)/(yb-ya);
+        p = (long int)floor(x);
+
+        if(p < 0){
+            coverage->carry[row*(coverage->width+1)] += d;
+        }else if(p < coverage->width){
+            coverage->acc[row*coverage->width+p] += d*(p+1-x);
+            coverage->carry[row*(coverage->width+1)+p+1] += d;
+        }
+    }
+}
+
+void coverage_curve(Coverage *coverage, double x0, double y0, double x1,
+                    double y1, double x2, double y2) {
+    double px = x0, py = y0;
+    double x, y;
+    double t, u;
+
+    int i;
+
+    for(i=1;i<=COVERAGE_STEPS;i++){
+        t = (double)i/COVERAGE_STEPS;
+        u = 1-t;
+        x = i < COVERAGE_STEPS ? u*u*x0+2*u*t*x1+t*t*x2 : x2;
+        y = i < COVERAGE_STEPS ? u*u*y0+2*u*t*y1+t*t*y2 : y2;
+        coverage_line(coverage, px, py, x, y);
+        px = x;
+        py = y;
+    }
+}
+
+/* Decode a contour like the rasterizer does, but without rounding the
+ * points. */
+void coverage_contour(Coverage *coverage, MTGlyph *glyph, size_t first,
+                      size_t last, double scale, double left, double top) {
+    size_t num = last-first+1;
+    size_t start;
+    size_t i, n;
+
+    double sx, sy;
+    double cx = 0, cy = 0;
+    double x, y;
+    double px, py;
+
+    int pending = 0;
+
+    for(start=first;start<=last;start++){
+        if(MT_GLYPH_ON_CURVE(glyph, start)) break;
+    }
+
+    if(start <= last){
+        sx = MT_GLYPH_X(glyph, start)*scale-left;
+        sy = top-MT_GLYPH_Y(glyph, start)*scale;
+        start++;
+        num--;
+    }else{
+        start = first;
+        sx = (MT_GLYPH_X(glyph, first)+MT_GLYPH_X(glyph, last))*scale/2-left;
+        sy = top-(MT_GLYPH_Y(glyph, first)+MT_GLYPH_Y(glyph, last))*scale/2;
+    }
+
+    px = sx;
+    py = sy;
+
+    for(i=0;i<num;i++){
+        n = start+i;
+        if(n > last) n -= last-first+1;
+
+        x = MT_GLYPH_X(glyph, n)*scale-left;
+        y = top-MT_GLYPH_Y(glyph, n)*scale;
+
+        if(MT_GLYPH_ON_CURVE(glyph, n)){
+            if(pending){
+                coverage_curve(coverage, px, py, cx, cy, x, y);
+            }else{
+                coverage_line(coverage, px, py, x, y);
+            }
+            px = x;
+            py = y;
+            pending = 0;
+        }else{
+            if(pending){
+                coverage_curve(coverage, px, py, cx, cy, (cx+x)/2,
+                               (cy+y)/2);
+                px = (cx+x)/2;
+                py = (cy+y)/2;
+            }
+            cx = x;
+            cy = y;
+            pending = 1;
+        }
+    }
+
+    if(pending){
+        coverage_curve(coverage, px, py, cx, cy, sx, sy);
+    }else{
+        coverage_line(coverage, px, py, sx, sy);
+    }
+}
+
+/* Compare a rendered glyph to its reference coverage, and return the biggest
+ * difference, or -1 if the memory could not be allocated. */
+int coverage_glyph(MTFont *font, MTGlyph *glyph, int size, int subpixel,
+                   MTBitmap *bitmap) {
+    Coverage coverage;
+
+    size_t i, first;
+    int x, y;
+    int diff, max = 0;
+
+    double scale = (double)size/font->units_per_em;
+    double sum, ref;
+
+    coverage.width = bitmap->width;
+    coverage.height = bitmap->height;
+    coverage.acc = calloc((size_t)bitmap->width*bitmap->height,
+                          sizeof(double));
+    coverage.carry = calloc((size_t)(bitmap->width+1)*bitmap->height,
+                            sizeof(double));
+    if(coverage.acc == NULL || coverage.carry == NULL){
+        free(coverage.acc);
+        free(coverage.carry);
+        return -1;
+    }
+
+    first = 0;
+    for(i=0;i<glyph->contour_num;i++){
+        if(glyph->contour_ends[i] >= glyph->point_num) break;
+        if(glyph->contour_ends[i] >= first){
+            coverage_contour(&coverage, glyph, first, glyph->contour_ends[i],
+                             scale, bitmap->left-(double)subpixel/
+                             MT_RENDER_ONE, bitmap->top);
+        }
+        first = glyph->contour_ends[i]+1;
+    }
+
+    /* The sweep maps a full coverage to 256 and clamps it. */
+    for(y=0;y<bitmap->height;y++){
+        sum = 0;
+        for(x=0;x<bitmap->width;x++){
+            sum += coverage.carry[y*(bitmap->width+1)+x];
+            ref = fabs(sum+coverage.acc[y*bitmap->width+x])*256;
+            diff = (ref > 255 ? 255 : (int)ref)-
+                   bitmap->data[y*bitmap->pitch+x];
+            if(diff < 0) diff = -diff;
+            if(diff > max) max = diff;
+        }
+    }
+
+    free(coverage.acc);
+    free(coverage.carry);
+
+    return max;
+}
+
+int test_coverage(char *file) {
+    const int sizes[COVERAGE_SIZE_NUM] = {9, 16, 31, 64};
+    const int subpixels[COVERAGE_SUBPIXEL_NUM] = {0, MT_RENDER_ONE*3/10};
+
+    MTReader reader;
+    MTFont font;
+    MTRasterizer rasterizer;
+    MTGlyph *glyph;
+    MTBitmap bitmap;
+
+    size_t c;
+    size_t i, n;
+    int diff;
+
+    int failures = 0;
+
+    if(test_font_init(&font, &reader, file)) return 1;
+    mt_rasterizer_init(&rasterizer);
+
+    for(c=' ';c<='~' && !failures;c++){
+        glyph = mt_font_get_glyph(&font, c);
+
+        for(i=0;i<COVERAGE_SIZE_NUM*COVERAGE_SUBPIXEL_NUM;i++){
+            n = i%COVERAGE_SUBPIXEL_NUM;
+
+            mt_render_get_box(&font, glyph, sizes[i/COVERAGE_SUBPIXEL_NUM],
+                              subpixels[n], &bitmap);
+            if(bitmap.width <= 0 || bitmap.height <= 0) continue;
+            if(!TEST_CHECK(!mt_bitmap_alloc(&bitmap), failures)) break;
+
+            TEST_CHECK(!mt_render_glyph(&rasterizer, &font, glyph,
+                                        sizes[i/COVERAGE_SUBPIXEL_NUM],
+                                        subpixels[n], &bitmap), failures);
+            diff = coverage_glyph(&font, glyph, sizes[i/COVERAGE_SUBPIXEL_NUM],
+                                  subpixels[n], &bitmap);
+            mt_bitmap_free(&bitmap);
+
+            if(!TEST_CHECK(diff >= 0 && diff <= COVERAGE_TOLERANCE,
+                           failures)){
+                printf("'%c' at %d px is off by %d\n", (int)c,
+                       sizes[i/COVERAGE_SUBPIXEL_NUM], diff);
+                break;
+            }
+        }
+    }
+
+    mt_rasterizer_free(&rasterizer);
+    test_font_free(&font, &reader);
+
+    return failures;
+}
@@ -0,0 +1,245 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+
+#include <mibitype/runcache.h>
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RUNCACHE_POINTS 12
+#define RUNCACHE_PHASES 4
+
+/* The FNV prime the cache multiplies its hashes with. */
+#define RUNCACHE_PRIME 16777619UL
+
+/* Not in the header, the test uses it to build a collision. */
+size_t _mt_run_cache_hash(MTFont *font, int points, int phases,
+                          const char *str, size_t len);
+
+/* Check that a run is the one mt_run_layout gives. */
+int runcache_check(MTRun *run, MTFont *font, int points, int phases,
+                   char *str) {
+    MTRun expected;
+
+    size_t i;
+
+    int failures = 0;
+
+    if(!TEST_CHECK(run != NULL, failures)) return failures;
+    if(!TEST_CHECK(!mt_run_layout(&expected, font, points, phases, str,
+                                  strlen(str)), failures)){
+        return failures;
+    }
+
+    if(TEST_CHECK(run->num == expected.num &&
+                  run->advance == expected.advance &&
+                  run->line_num == expected.line_num, failures)){
+        for(i=0;i<run->num;i++){
+            if(!TEST_CHECK(run->ids[i] == expected.ids[i] &&
+                           run->x[i] == expected.x[i] &&
+                           run->y[i] == expected.y[i] &&
+                           run->phase[i] == expected.phase[i], failures)){
+                printf("glyph %lu of \"%s\" differs\n", (unsigned long int)i,
+                       str);
+                break;
+            }
+        }
+    }
+
+    mt_run_free(&expected);
+
+    return failures;
+}
+
+/* Get a run and check it, and that it was a hit or a miss. */
+int runcache_get(MTRunCache *cache, MTFont *font, int points, int phases,
+                 char *str, int hit) {
+    MTRun *run;
+
+    unsigned long int hits = cache->stats.hits;
+    unsigned long int misses = cache->stats.misses;
+
+    int failures = 0;
+
+    run = mt_run_cache_get(cache, font, points, phases, str, strlen(str));
+    failures += runcache_check(run, font, points, phases, str);
+
+    if(!TEST_CHECK(cache->stats.hits == hits+(hit != 0) &&
+                   cache->stats.misses == misses+!hit, failures)){
+        printf("\"%s\" at %d points with %d phases should be a %s\n", str,
+               points, phases, hit ? "hit" : "miss");
+    }
+
+    return failures;
+}
+
+/* Check that the map of the cache has an item for each run of the LRU
+ * list. */
+int runcache_count(MTRunCache *cache, size_t num) {
+    size_t n, count = 0;
+
+    int failures = 0;
+
+    for(n=cache->lru_first;n!=MT_RUN_NONE;n=cache->entries[n].next){
+        count++;
+    }
+
+    TEST_CHECK(count == num && cache->map.num == num, failures);
+
+    return failures;
+}
+
+/* Find a size and a number of phases that give the same hash as
+ * RUNCACHE_POINTS and RUNCACHE_PHASES for a string. The hash ends with
+ * ((h^points)*prime^phases)*prime, so the phases that collide with another
+ * size are found by undoing the last multiplication. */
+int runcache_collision(MTFont *font, char *str, int *points, int *phases) {
+    const size_t len = strlen(str);
+    const size_t hash = _mt_run_cache_hash(font, RUNCACHE_POINTS,
+                                           RUNCACHE_PHASES, str, len);
+
+    unsigned long int inverse = RUNCACHE_PRIME;
+    unsigned long int target, other;
+
+    int i;
+
+    /* Newton's iteration doubles the number of correct bits each time. */
+    for(i=0;i<6;i++) inverse *= 2-RUNCACHE_PRIME*inverse;
+
+    target = (unsigned long int)hash*inverse;
+    for(*points=1;*points<1000;(*points)++){
+        if(*points == RUNCACHE_POINTS) continue;
+
+        other = (unsigned long int)_mt_run_cache_hash(font, *points, 0, str,
+                                                      len)*inverse;
+        if((target^other) >= 1 && (target^other) <= INT_MAX){
+            *phases = target^other;
+            if(_mt_run_cache_hash(font, *points, *phases, str,
+                                  len) == hash){
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+int test_runcache(char *file) {
+    MTReader reader, other_reader;
+    MTFont font, other;
+    MTRunCache cache;
+
+    unsigned long int evictions;
+
+    int points, phases;
+
+    int failures = 0;
+
+    if(test_font_init(&font, &reader, file)) return 1;
+    if(test_font_init(&other, &other_reader, file)){
+        test_font_free(&font, &reader);
+        return 1;
+    }
+    if(!TEST_CHECK(!mt_run_cache_init(&cache, 2), failures)){
+        test_font_free(&other, &other_reader);
+        test_font_free(&font, &reader);
+        return failures;
+    }
+
+    /* The least recently used run is evicted. */
+    failures += runcache_get(&cache, &font, RUNCACHE_POINTS, RUNCACHE_PHASES,
+                             "Hello", 0);
+    failures += runcache_get(&cache, &font, RUNCACHE_POINTS, RUNCACHE_PHASES,
+                             "World\nWide", 0);
+    failures += runcache_get(&cache, &font, RUNCACHE_POINTS, RUNCACHE_PHASES,
+                             "Hello", 1);
+    failures += runcache_get(&cache, &font, RUNCACHE_POINTS, RUNCACHE_PHASES,
+                             "", 0);
+    TEST_CHECK(cache.stats.evictions == 1, failures);
+    failures += runcache_get(&cache, &font, RUNCACHE_POINTS, RUNCACHE_PHASES,
+                             "Hello", 1);
+    failures += runcache_get(&cache, &font, RUNCACHE_POINTS, RUNCACHE_PHASES,
+                             "World\nWide", 0);
+    TEST_CHECK(cache.stats.evictions == 2, failures);
+    failures += runcache_count(&cache, 2);
+
+    /* The same string with another font, size or number of phases is
+     * another run. */
+    failures += runcache_get(&cache, &other, RUNCACHE_POINTS,
+                             RUNCACHE_PHASES, "Hello", 0);
+    failures += runcache_get(&cache, &font, RUNCACHE_POINTS+1,
+                             RUNCACHE_PHASES, "Hello", 0);
+    failures += runcache_get(&cache, &other, RUNCACHE_POINTS,
+                             RUNCACHE_PHASES, "Hello", 1);
+
+    /* Invalidating a font only removes its runs. */
+    mt_run_cache_invalidate(&cache, &font);
+    failures += runcache_count(&cache, 1);
+    failures += runcache_get(&cache, &other, RUNCACHE_POINTS,
+                             RUNCACHE_PHASES, "Hello", 1);
+    failures += runcache_get(&cache, &font, RUNCACHE_POINTS+1,
+                             RUNCACHE_PHASES, "Hello", 0);
+    mt_run_cache_invalidate(&cache, &other);
+    failures += runcache_count(&cache, 1);
+    mt_run_cache_invalidate(&cache, &font);
+    failures += runcache_count(&cache, 0);
+
+    /* A run whose hash collides with the one of another run replaces it,
+     * without being counted as an eviction. */
+    evictions = cache.stats.evictions;
+    if(TEST_CHECK(!runcache_collision(&font, "Hello", &points, &phases),
+                  failures)){
+        failures += runcache_get(&cache, &font, RUNCACHE_POINTS,
+                                 RUNCACHE_PHASES, "Hello", 0);
+        failures += runcache_get(&cache, &font, points, phases, "Hello", 0);
+        failures += runcache_count(&cache, 1);
+        failures += runcache_get(&cache, &font, points, phases, "Hello", 1);
+        failures += runcache_get(&cache, &font, RUNCACHE_POINTS,
+                                 RUNCACHE_PHASES, "Hello", 0);
+        failures += runcache_count(&cache, 1);
+        TEST_CHECK(cache.stats.evictions == evictions, failures);
+    }
+
+    mt_run_cache_clear(&cache);
+    failures += runcache_count(&cache, 0);
+
+    mt_run_cache_free(&cache);
+    test_font_free(&other, &other_reader);
+    test_font_free(&font, &reader);
+
+    return failures;
+}
@@ -0,0 +1,212 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+
+#include <mibitype/sdf.h>
+
+#include <math.h>
+#include <stdio.h>
+
+/* The distances are checked to be within one of the 256 levels of the
+ * field, i.e. spread/128 pixels, of the exact ones. */
+#define SDF_SIZE_NUM 2
+#define SDF_SPREAD 4
+
+/* The squared distance between (x, y) and a point of an edge. */
+double sdf_point_distance(MTSdfEdge *edge, double t, double x, double y) {
+    const double u = 1-t;
+
+    double dx = u*u*edge->x0+2*u*t*edge->x1+t*t*edge->x2-x;
+    double dy = u*u*edge->y0+2*u*t*edge->y1+t*t*edge->y2-y;
+
+    return dx*dx+dy*dy;
+}
+
+/* The distance between (x, y) and an edge, found independently of the
+ * generator: exactly for lines, by sampling the curves and refining the
+ * closest sample with a golden section search. */
+double sdf_edge_distance(MTSdfEdge *edge, double x, double y) {
+    const double ratio = (sqrt(5)-1)/2;
+
+    double ax, ay, len;
+    double t, best_t = 0;
+    double d, best;
+    double a, b, c1, c2;
+    int i;
+
+    if(!edge->curve){
+        ax = edge->x2-edge->x0;
+        ay = edge->y2-edge->y0;
+        len = ax*ax+ay*ay;
+        t = len > 0 ? ((x-edge->x0)*ax+(y-edge->y0)*ay)/len : 0;
+        if(t < 0) t = 0;
+        if(t > 1) t = 1;
+        ax = edge->x0+t*ax-x;
+        ay = edge->y0+t*ay-y;
+
+        return sqrt(ax*ax+ay*ay);
+    }
+
+    best = sdf_point_distance(edge, 0, x, y);
+    for(i=1;i<=64;i++){
+        t = i/64.0;
+        d = sdf_point_distance(edge, t, x, y);
+        if(d < best){
+            best = d;
+            best_t = t;
+        }
+    }
+
+    a = best_t > 1/64.0 ? best_t-1/64.0 : 0;
+    b = best_t < 1-1/64.0 ? best_t+1/64.0 : 1;
+    for(i=0;i<60;i++){
+        c1 = b-(b-a)*ratio;
+        c2 = a+(b-a)*ratio;
+        if(sdf_point_distance(edge, c1, x, y) <
+           sdf_point_distance(edge, c2, x, y)){
+            b = c2;
+        }else{
+            a = c1;
+        }
+    }
+    d = sdf_point_distance(edge, (a+b)/2, x, y);
+    if(d < best) best = d;
+
+    return sqrt(best);
+}
+
+int sdf_check_glyph(MTSdf *sdf, MTRasterizer *rasterizer, MTFont *font,
+                    MTGlyph *glyph, int size) {
+    MTBitmap field, coverage;
+
+    double d, dist, cap;
+    size_t i;
+    int x, y;
+    int rx, ry;
+    int inside;
+    int alpha;
+
+    int failures = 0;
+
+    mt_sdf_get_box(font, glyph, size, SDF_SPREAD, &field);
+    if(field.width <= 0 || field.height <= 0) return 0;
+    mt_render_get_box(font, glyph, size, 0, &coverage);
+
+    if(mt_bitmap_alloc(&field)) return 1;
+    if(mt_bitmap_alloc(&coverage)){
+        mt_bitmap_free(&field);
+        return 1;
+    }
+
+    TEST_CHECK(!mt_sdf_glyph(sdf, font, glyph, size, SDF_SPREAD, &field),
+               failures);
+    TEST_CHECK(!mt_render_glyph(rasterizer, font, glyph, size, 0, &coverage),
+               failures);
+
+    for(y=0;y<field.height && !failures;y++){
+        for(x=0;x<field.width && !failures;x++){
+            dist = HUGE_VAL;
+            for(i=0;i<sdf->edge_num;i++){
+                d = sdf_edge_distance(sdf->edges+i, x+0.5, y+0.5);
+                if(d < dist) dist = d;
+            }
+
+            inside = field.data[y*field.pitch+x] >= 128;
+            d = fabs(field.data[y*field.pitch+x]-128.0)*SDF_SPREAD/128;
+
+            /* The field is clamped to 255 inside and 0 outside. */
+            cap = inside ? SDF_SPREAD*127/128.0 : SDF_SPREAD;
+            if(dist > cap) dist = cap;
+
+            if(!TEST_CHECK(fabs(d-dist) <= SDF_SPREAD/128.0, failures)){
+                printf("pixel (%d;%d) of glyph %lu at %d px: %f instead of "
+                       "%f\n", x, y, (unsigned long int)glyph->id, size, d,
+                       dist);
+            }
+
+            /* Pixels more than a pixel away from the outline are fully in or
+             * out of the rendered glyph, which gives the sign. */
+            if(dist <= 1) continue;
+
+            rx = x+field.left-coverage.left;
+            ry = y-field.top+coverage.top;
+            alpha = rx >= 0 && ry >= 0 && rx < coverage.width &&
+                    ry < coverage.height ?
+                    coverage.data[ry*coverage.pitch+rx] : 0;
+
+            if(!TEST_CHECK(inside ? alpha == 255 : alpha == 0, failures)){
+                printf("pixel (%d;%d) of glyph %lu at %d px has the wrong "
+                       "sign\n", x, y, (unsigned long int)glyph->id, size);
+            }
+        }
+    }
+
+    mt_bitmap_free(&field);
+    mt_bitmap_free(&coverage);
+
+    return failures;
+}
+
+int test_sdf(char *file) {
+    const int sizes[SDF_SIZE_NUM] = {16, 48};
+
+    MTReader reader;
+    MTFont font;
+    MTSdf sdf;
+    MTRasterizer rasterizer;
+
+    size_t i;
+    int c;
+    int failures = 0;
+
+    if(test_font_init(&font, &reader, file)) return 1;
+
+    mt_sdf_init(&sdf);
+    mt_rasterizer_init(&rasterizer);
+
+    for(i=0;i<SDF_SIZE_NUM && !failures;i++){
+        for(c=' ';c<='~' && !failures;c++){
+            failures += sdf_check_glyph(&sdf, &rasterizer, &font,
+                                        mt_font_get_glyph(&font, c),
+                                        sizes[i]);
+        }
+    }
+
+    mt_rasterizer_free(&rasterizer);
+    mt_sdf_free(&sdf);
+    test_font_free(&font, &reader);
+
+    return failures;
+}
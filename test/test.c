@@ -0,0 +1,142 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char *name;
+    int (*run)(char *file);
+    char *description;
+} Test;
+
+Test tests[] = {
+    {"kernels", test_kernels, "the sweep kernels match the scalar one"},
+    {"coverage", test_coverage, "the coverage matches a supersampled outline"},
+    {"sdf", test_sdf, "the distance fields match a brute force search"},
+    {"arena", test_arena, "evicting glyphs gives the arena chunks back"},
+    {"utf8", test_utf8, "malformed UTF-8 is replaced by maximal subparts"},
+    {"cmap", test_cmap, "the cmap lookups match a walk over the subtables"},
+    {"map", test_map, "removals shift the probe sequences back"},
+    {"kern", test_kern, "the kern pairs of a known table are found"},
+    {"gpos", test_gpos, "the GPOS pairs of a known table are found"},
+    {"gsub", test_gsub, "the ligatures of a known table are formed"},
+    {"runcache", test_runcache, "runs are evicted and replaced on collisions"},
+    {"atlas", test_atlas, "the glyph rectangles of the atlas never overlap"}
+};
+
+#define TEST_NUM (sizeof(tests)/sizeof(tests[0]))
+
+void test_fail(char *cond, char *file, int line) {
+    printf("%s:%d: check failed: %s\n", file, line, cond);
+}
+
+unsigned long int test_random(unsigned long int *state) {
+    /* The LCG of the C standard, truncated to 32 bits. */
+    *state = (*state*1103515245UL+12345)&0xFFFFFFFFUL;
+
+    return *state>>8;
+}
+
+int test_font_init(MTFont *font, MTReader *reader, char *file) {
+    int rc;
+
+    if((rc = mt_reader_init(reader, file))){
+        printf("Failed to open %s (error %d)!\n", file, rc);
+        return rc;
+    }
+
+    if((rc = mt_font_init(font, reader, 96))){
+        printf("Failed to load %s (error %d)!\n", file, rc);
+        mt_reader_free(reader);
+        return rc;
+    }
+
+    return 0;
+}
+
+int test_font_table(MTReader *reader, char *tag, MTView *table) {
+    size_t i, num;
+    size_t pos;
+
+    MTView dir;
+
+    if(mt_reader_view(reader, 0, 12, &dir)) return 1;
+    num = MT_VIEW_U16(&dir, 4);
+    if(mt_reader_view(reader, 0, 12+num*16, &dir)) return 1;
+
+    for(i=0;i<num;i++){
+        pos = 12+i*16;
+        if(dir.data[pos] == tag[0] && dir.data[pos+1] == tag[1] &&
+           dir.data[pos+2] == tag[2] && dir.data[pos+3] == tag[3]){
+            return mt_reader_view(reader, MT_VIEW_U32(&dir, pos+8),
+                                  MT_VIEW_U32(&dir, pos+12), table) != 0;
+        }
+    }
+
+    return 1;
+}
+
+void test_font_free(MTFont *font, MTReader *reader) {
+    mt_font_free(font);
+    mt_reader_free(reader);
+}
+
+int main(int argc, char **argv) {
+    size_t i;
+    int n;
+    int failures;
+    int failed = 0;
+
+    if(argc < 2){
+        fputs("USAGE: mibitype-test FILE...\n"
+              "Runs all the tests with each font file.\n", stderr);
+
+        return EXIT_FAILURE;
+    }
+
+    for(n=1;n<argc;n++){
+        for(i=0;i<TEST_NUM;i++){
+            failures = tests[i].run(argv[n]);
+            printf("%s %s: %s (%s)\n", failures ? "FAIL" : "ok  ",
+                   tests[i].name, tests[i].description, argv[n]);
+            if(failures) failed = 1;
+        }
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
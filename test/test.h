@@ -0,0 +1,75 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <mibitype/font.h>
+
+/* Report a failed check with its location, tests count their failures. */
+#define TEST_CHECK(cond, failures) \
+    ((cond) ? 1 : (test_fail(#cond, __FILE__, __LINE__), (failures)++, 0))
+
+void test_fail(char *cond, char *file, int line);
+
+/* A small pseudo random number generator, so that failures can be
+ * reproduced. */
+unsigned long int test_random(unsigned long int *state);
+
+/* Open a font from a file, printing an error if it fails. */
+int test_font_init(MTFont *font, MTReader *reader, char *file);
+
+void test_font_free(MTFont *font, MTReader *reader);
+
+/* Get a view of the table of a font file with a four character tag, so that
+ * the tests can check the font against their own parsing of the file.
+ * Returns 1 if it isn't in the file. */
+int test_font_table(MTReader *reader, char *tag, MTView *table);
+
+/* Each test gets a font file and returns the number of checks that
+ * failed. */
+int test_kernels(char *file);
+int test_coverage(char *file);
+int test_sdf(char *file);
+int test_arena(char *file);
+int test_utf8(char *file);
+int test_cmap(char *file);
+int test_map(char *file);
+int test_kern(char *file);
+int test_gpos(char *file);
+int test_gsub(char *file);
+int test_runcache(char *file);
+int test_atlas(char *file);
+
+#endif
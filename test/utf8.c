@@ -0,0 +1,196 @@
+/* Mibitype - A small library to load fonts.
+ * by Mibi88
+ *
+ * This software is licensed under the BSD-3-Clause license:
+ *
+ * Copyright 2024 Mibi88
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+
+#include <mibitype/utf8.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/* The sequences are decoded alone, and in the middle of runs of ASCII long
+ * enough to go through the block kernels. */
+#define UTF8_PADDING 70
+#define UTF8_LEN_MAX (UTF8_PADDING*2+16)
+
+#define UTF8_RANDOM 20000
+#define UTF8_RANDOM_LEN 100
+
+#define R MT_UTF8_REPLACEMENT
+
+/* A malformed (or valid) sequence and the characters it decodes to, ending
+ * with 0. */
+typedef struct {
+    char *name;
+    char *str;
+    unsigned long int chars[12];
+} Utf8Case;
+
+Utf8Case utf8_cases[] = {
+    {"valid", "a\xc3\xa9\xe6\x96\x87\xf0\x9f\x98\x80",
+     {'a', 0xE9, 0x6587, 0x1F600, 0}},
+    {"limits", "\xc2\x80\xdf\xbf\xe0\xa0\x80\xef\xbf\xbf\xf4\x8f\xbf\xbf",
+     {0x80, 0x7FF, 0x800, 0xFFFF, 0x10FFFF, 0}},
+    {"lone continuations", "\x80\xbf" "a", {R, R, 'a', 0}},
+    {"overlong 2 bytes", "\xc0\xaf\xc1\xbf", {R, R, R, R, 0}},
+    {"overlong 3 bytes", "\xe0\x80\xaf\xe0\x9f\xbf", {R, R, R, R, R, R, 0}},
+    {"overlong 4 bytes", "\xf0\x80\x80\xaf\xf0\x8f\xbf\xbf",
+     {R, R, R, R, R, R, R, R, 0}},
+    {"surrogates", "\xed\xa0\x80\xed\xbf\xbf\xed\x9f\xbf",
+     {R, R, R, R, R, R, 0xD7FF, 0}},
+    {"above U+10FFFF", "\xf4\x90\x80\x80\xf5\x80\xff",
+     {R, R, R, R, R, R, R, 0}},
+    {"truncated 2 bytes", "\xc3" "a", {R, 'a', 0}},
+    {"truncated 3 bytes", "\xe6\x96" "a\xe6" "a", {R, 'a', R, 'a', 0}},
+    {"truncated 4 bytes", "\xf0\x9f\x98" "a\xf0\x9f" "a",
+     {R, 'a', R, 'a', 0}},
+    {"truncated at the end", "\xf0\x9f\x98", {R, 0}},
+    /* The example of maximal subparts of the Unicode standard (table
+     * 3-8). */
+    {"maximal subparts", "a\xf1\x80\x80\xe1\x80\xc2" "b\x80" "c\x80\xbf" "d",
+     {'a', R, R, R, 'b', R, 'c', R, R, 'd', 0}}
+};
+
+#define UTF8_CASE_NUM (sizeof(utf8_cases)/sizeof(utf8_cases[0]))
+
+/* Decode str with mt_utf8_next and with mt_utf8_decode, with all the output
+ * sizes, and check that they give chars. */
+int utf8_check(char *name, char *str, size_t len, unsigned long int *chars,
+               size_t char_num) {
+    unsigned long int out[UTF8_LEN_MAX+1];
+
+    size_t ends[UTF8_LEN_MAX+1];
+    size_t pos;
+    size_t i;
+    size_t num, size;
+    size_t read;
+
+    int failures = 0;
+
+    pos = 0;
+    for(i=0;pos<len;i++){
+        if(!TEST_CHECK(i < char_num, failures) ||
+           !TEST_CHECK(mt_utf8_next(str, len, &pos) == chars[i],
+                       failures)){
+            printf("%s: mt_utf8_next differs at character %lu\n", name,
+                   (unsigned long int)i);
+            return failures;
+        }
+        ends[i] = pos;
+    }
+    if(!TEST_CHECK(i == char_num, failures)){
+        printf("%s: mt_utf8_next decoded %lu characters\n", name,
+               (unsigned long int)i);
+        return failures;
+    }
+
+    for(size=1;size<=char_num;size++){
+        out[size] = 0xAA;
+
+        num = mt_utf8_decode(str, len, out, size, &read);
+
+        if(!TEST_CHECK(num == size, failures) ||
+           !TEST_CHECK(read == ends[size-1], failures) ||
+           !TEST_CHECK(!memcmp(out, chars, size*sizeof(unsigned long int)),
+                       failures) ||
+           !TEST_CHECK(out[size] == 0xAA, failures)){
+            printf("%s: mt_utf8_decode differs with room for %lu "
+                   "characters\n", name, (unsigned long int)size);
+            return failures;
+        }
+    }
+
+    return failures;
+}
+
+int test_utf8(char *file) {
+    char str[UTF8_LEN_MAX];
+    unsigned long int chars[UTF8_LEN_MAX];
+
+    unsigned long int seed = 16;
+
+    size_t i, n;
+    size_t len, pad;
+    size_t char_num;
+    size_t pos;
+
+    int failures = 0;
+
+    (void)file;
+
+    for(i=0;i<UTF8_CASE_NUM;i++){
+        for(char_num=0;utf8_cases[i].chars[char_num];char_num++);
+
+        failures += utf8_check(utf8_cases[i].name, utf8_cases[i].str,
+                               strlen(utf8_cases[i].str),
+                               utf8_cases[i].chars, char_num);
+
+        /* The same sequence between runs of ASCII. */
+        for(pad=0;pad<=UTF8_PADDING;pad+=UTF8_PADDING/2){
+            len = strlen(utf8_cases[i].str);
+
+            /* The letters change so that misplaced lanes are seen. */
+            for(n=0;n<pad;n++) str[n] = chars[n] = 'a'+n%26;
+            memcpy(str+pad, utf8_cases[i].str, len);
+            memcpy(chars+pad, utf8_cases[i].chars,
+                   char_num*sizeof(unsigned long int));
+            for(n=0;n<UTF8_PADDING;n++){
+                str[pad+len+n] = chars[pad+char_num+n] = 'A'+n%26;
+            }
+
+            failures += utf8_check(utf8_cases[i].name, str,
+                                   pad+len+UTF8_PADDING, chars,
+                                   pad+char_num+UTF8_PADDING);
+        }
+    }
+
+    /* Random bytes, mostly ASCII, must give the same characters with both
+     * decoders. */
+    for(i=0;i<UTF8_RANDOM && !failures;i++){
+        len = test_random(&seed)%UTF8_RANDOM_LEN+1;
+        for(n=0;n<len;n++){
+            str[n] = test_random(&seed)%2 ? test_random(&seed)%0x80 :
+                     test_random(&seed)%0x100;
+        }
+
+        pos = 0;
+        for(char_num=0;pos<len;char_num++){
+            chars[char_num] = mt_utf8_next(str, len, &pos);
+        }
+
+        failures += utf8_check("random", str, len, chars, char_num);
+    }
+
+    return failures;
+}